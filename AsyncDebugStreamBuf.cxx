@@ -0,0 +1,373 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief This file contains the definitions of class AsyncDebugStreamBuf.
+ */
+
+#include "sys.h"
+
+#ifdef CWDEBUG
+
+#include "AsyncDebugStreamBuf.h"
+#include "DeferredDout.h"
+#include <algorithm>
+#include <chrono>
+
+NAMESPACE_DEBUG_START
+
+//-----------------------------------------------------------------------------
+// DrainWakeup
+
+void DrainWakeup::wake_up()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_notified = true;
+  }
+  m_cv.notify_one();
+}
+
+//-----------------------------------------------------------------------------
+// DebugRing
+
+void DebugRing::copy_in(size_t pos, void const* data, size_t len)
+{
+  size_t const offset = pos & (capacity - 1);
+  size_t const first = std::min(len, capacity - offset);
+  std::memcpy(m_buffer + offset, data, first);
+  std::memcpy(m_buffer, static_cast<char const*>(data) + first, len - first);
+}
+
+void DebugRing::copy_out(size_t pos, void* data, size_t len) const
+{
+  size_t const offset = pos & (capacity - 1);
+  size_t const first = std::min(len, capacity - offset);
+  std::memcpy(data, m_buffer + offset, first);
+  std::memcpy(static_cast<char*>(data) + first, m_buffer, len - first);
+}
+
+void DebugRing::wait_for_space(size_t len)
+{
+  // This only happens when the background thread can't keep up.
+  while (free_space() < len)
+  {
+    m_wakeup->notify();
+    std::this_thread::yield();
+  }
+}
+
+void DebugRing::begin_record(uint64_t timestamp, kind_type kind, size_t payload_size)
+{
+  ASSERT(!in_record());
+  ASSERT(sizeof(RecordHeader) + payload_size <= capacity);
+  wait_for_space(sizeof(RecordHeader) + payload_size);
+  m_record = { timestamp, 0, kind };
+  m_record_start = m_write;
+  m_write += sizeof(RecordHeader);
+}
+
+void DebugRing::append(char const* data, size_t len)
+{
+  ASSERT(in_record());
+  while (len > 0)
+  {
+    size_t space = free_space();
+    if (space == 0)
+    {
+      // The record doesn't fit in the ring. Commit what we have, so that the consumer can
+      // make room, and continue with a new record with the same timestamp and kind.
+      RecordHeader const record = m_record;
+      commit();
+      begin_record(record.m_timestamp, record.m_kind);
+      continue;
+    }
+    size_t const n = std::min(len, space);
+    copy_in(m_write, data, n);
+    m_write += n;
+    data += n;
+    len -= n;
+  }
+}
+
+void DebugRing::commit()
+{
+  ASSERT(in_record());
+  m_record.m_length = m_write - m_record_start - sizeof(RecordHeader);
+  copy_in(m_record_start, &m_record, sizeof(RecordHeader));
+  m_record_start = no_record;
+  m_head.store(m_write);
+  m_wakeup->notify();
+}
+
+bool DebugRing::front(RecordHeader& header) const
+{
+  size_t const tail = m_tail.load(std::memory_order_relaxed);
+  if (tail == m_head.load(std::memory_order_acquire))
+    return false;
+  copy_out(tail, &header, sizeof(RecordHeader));
+  return true;
+}
+
+void DebugRing::pop(RecordHeader const& header, std::string& out)
+{
+  size_t const tail = m_tail.load(std::memory_order_relaxed);
+  size_t const size = out.size();
+  out.resize(size + header.m_length);
+  copy_out(tail + sizeof(RecordHeader), out.data() + size, header.m_length);
+  m_tail.store(tail + sizeof(RecordHeader) + header.m_length, std::memory_order_release);
+}
+
+//-----------------------------------------------------------------------------
+// AsyncDebugStreamBuf
+
+namespace {
+
+std::atomic<uint64_t> s_next_id{1};
+
+struct ThreadRing
+{
+  uint64_t m_owner_id = 0;              // The m_id of the AsyncDebugStreamBuf that m_ring belongs to.
+  std::shared_ptr<DebugRing> m_ring;
+
+  ~ThreadRing()
+  {
+    if (m_ring)
+      m_ring->set_thread_exited();
+  }
+};
+
+thread_local ThreadRing t_ring;
+
+} // namespace
+
+AsyncDebugStreamBuf::AsyncDebugStreamBuf(std::ostream* os) : m_os(os), m_stop(false), m_id(s_next_id++)
+{
+  setp(nullptr, nullptr);       // Make every write go through xsputn or overflow.
+  m_drain_thread = std::thread([this](){ drain_thread(); });
+}
+
+AsyncDebugStreamBuf::~AsyncDebugStreamBuf()
+{
+  m_stop = true;
+  m_wakeup.wake_up();
+  m_drain_thread.join();
+  drain();
+}
+
+//static
+uint64_t AsyncDebugStreamBuf::now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+DebugRing& AsyncDebugStreamBuf::ring()
+{
+  if (t_ring.m_owner_id != m_id) [[unlikely]]
+  {
+    // This is the first time that this thread writes to this streambuf.
+    if (t_ring.m_ring)
+      t_ring.m_ring->set_thread_exited();
+    t_ring.m_ring = std::make_shared<DebugRing>(&m_wakeup);
+    t_ring.m_owner_id = m_id;
+    std::lock_guard<std::mutex> lock(m_rings_mutex);
+    m_rings.push_back(t_ring.m_ring);
+  }
+  return *t_ring.m_ring;
+}
+
+std::streamsize AsyncDebugStreamBuf::xsputn(char const* s, std::streamsize n)
+{
+  DebugRing& r = ring();
+  char const* const end = s + n;
+  while (s < end)
+  {
+    if (!r.in_record())
+      r.begin_record(now(), DebugRing::text_record);
+    char const* newline = static_cast<char const*>(std::memchr(s, '\n', end - s));
+    char const* line_end = newline ? newline + 1 : end;
+    r.append(s, line_end - s);
+    if (newline)
+      r.commit();
+    s = line_end;
+  }
+  return n;
+}
+
+AsyncDebugStreamBuf::int_type AsyncDebugStreamBuf::overflow(int_type c)
+{
+  if (c != traits_type::eof())
+  {
+    char ch = traits_type::to_char_type(c);
+    xsputn(&ch, 1);
+  }
+  return traits_type::not_eof(c);
+}
+
+void AsyncDebugStreamBuf::drain()
+{
+  std::lock_guard<std::mutex> drain_lock(m_drain_mutex);
+  // Don't keep m_rings_mutex locked while writing to m_os, that would block threads that write their first line.
+  {
+    std::lock_guard<std::mutex> lock(m_rings_mutex);
+    m_drain_rings.assign(m_rings.begin(), m_rings.end());
+  }
+  std::string out;
+  std::string binary;
+  std::vector<DebugRing::RecordHeader> headers(m_drain_rings.size());
+  std::vector<bool> has_record(m_drain_rings.size());
+  for (size_t i = 0; i < m_drain_rings.size(); ++i)
+    has_record[i] = m_drain_rings[i]->front(headers[i]);
+  // Merge the records of all rings by timestamp.
+  for (;;)
+  {
+    size_t best = m_drain_rings.size();
+    for (size_t i = 0; i < m_drain_rings.size(); ++i)
+      if (has_record[i] && (best == m_drain_rings.size() || headers[i].m_timestamp < headers[best].m_timestamp))
+        best = i;
+    if (best == m_drain_rings.size())
+      break;
+    if (headers[best].m_kind == DebugRing::binary_record)
+    {
+      // Format the arguments of a DoutDeferred.
+      binary.clear();
+      m_drain_rings[best]->pop(headers[best], binary);
+      DeferredSite::decode(binary, out);
+    }
+    else
+      m_drain_rings[best]->pop(headers[best], out);
+    has_record[best] = m_drain_rings[best]->front(headers[best]);
+  }
+  m_drain_rings.clear();
+  if (!out.empty())
+  {
+    m_os->write(out.data(), out.size());
+    m_os->flush();
+  }
+  // Forget the rings of threads that exited, once they are empty.
+  std::lock_guard<std::mutex> lock(m_rings_mutex);
+  std::erase_if(m_rings, [](std::shared_ptr<DebugRing> const& ring){ return ring->thread_exited() && ring->empty(); });
+}
+
+bool AsyncDebugStreamBuf::has_work()
+{
+  if (m_stop)
+    return true;
+  std::lock_guard<std::mutex> lock(m_rings_mutex);
+  return std::any_of(m_rings.begin(), m_rings.end(), [](std::shared_ptr<DebugRing> const& ring){ return !ring->empty(); });
+}
+
+void AsyncDebugStreamBuf::drain_thread()
+{
+  while (!m_stop)
+  {
+    // Sleep until a record is committed (or we're stopped).
+    m_wakeup.wait([this]{ return has_work(); });
+    drain();
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+namespace {
+
+std::mutex s_async_mutex;
+std::atomic<AsyncDebugStreamBuf*> s_active_buf;
+std::ostream* s_original_ostream;
+std::unique_ptr<AsyncDebugStreamBuf> s_async_buf;
+std::unique_ptr<std::ostream> s_async_ostream;
+// Previous streambufs that were for a different ostream. Kept because other threads might still be writing to them.
+std::vector<std::pair<std::unique_ptr<AsyncDebugStreamBuf>, std::unique_ptr<std::ostream>>> s_retired;
+bool s_async_output_active;
+
+// The number of ActiveAsyncDebugStreamBuf objects of a thread.
+struct ThreadUses
+{
+  int m_depth{0};                               // The number of nested ActiveAsyncDebugStreamBuf objects. Owning thread only.
+  std::atomic<unsigned int> m_sequence{0};      // Odd while m_depth > 0. Only written by the owning thread.
+
+  ThreadUses();
+  ~ThreadUses();
+};
+
+std::mutex s_thread_uses_mutex;
+std::vector<ThreadUses*> s_thread_uses;         // Protected by s_thread_uses_mutex.
+
+ThreadUses::ThreadUses()
+{
+  std::lock_guard<std::mutex> lock(s_thread_uses_mutex);
+  s_thread_uses.push_back(this);
+}
+
+ThreadUses::~ThreadUses()
+{
+  std::lock_guard<std::mutex> lock(s_thread_uses_mutex);
+  std::erase(s_thread_uses, this);
+}
+
+thread_local ThreadUses t_uses;
+
+} // namespace
+
+ActiveAsyncDebugStreamBuf::ActiveAsyncDebugStreamBuf()
+{
+  // Sequentially consistent: either stop_async_output() sees that we're using it, or we see that there is no active buffer anymore.
+  if (t_uses.m_depth++ == 0)
+    t_uses.m_sequence.store(t_uses.m_sequence.load(std::memory_order_relaxed) + 1);
+  m_buf = s_active_buf.load();
+}
+
+ActiveAsyncDebugStreamBuf::~ActiveAsyncDebugStreamBuf()
+{
+  if (--t_uses.m_depth == 0)
+    t_uses.m_sequence.store(t_uses.m_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void start_async_output()
+{
+  std::lock_guard<std::mutex> lock(s_async_mutex);
+  if (s_async_output_active)
+    return;
+  s_original_ostream = libcwd::libcw_do.get_ostream();
+  if (!s_async_buf || s_async_buf->ostream() != s_original_ostream)
+  {
+    if (s_async_buf)
+      s_retired.emplace_back(std::move(s_async_buf), std::move(s_async_ostream));
+    s_async_buf = std::make_unique<AsyncDebugStreamBuf>(s_original_ostream);
+    s_async_ostream = std::make_unique<std::ostream>(s_async_buf.get());
+  }
+  libcwd::libcw_do.set_ostream(s_async_ostream.get());
+  s_active_buf = s_async_buf.get();
+  s_async_output_active = true;
+}
+
+void stop_async_output()
+{
+  std::lock_guard<std::mutex> lock(s_async_mutex);
+  if (!s_async_output_active)
+    return;
+  libcwd::libcw_do.set_ostream(s_original_ostream);
+  s_active_buf = nullptr;
+  s_async_output_active = false;
+  // Wait till no thread uses the streambuf anymore. A thread that is using it now will
+  // see that there is no active buffer the next time, so it suffices to wait till the
+  // sequence number changed; waiting for it to become even could take forever.
+  {
+    std::lock_guard<std::mutex> uses_lock(s_thread_uses_mutex);
+    for (ThreadUses const* uses : s_thread_uses)
+      if (unsigned int const sequence = uses->m_sequence.load(); sequence % 2 == 1)
+        while (uses->m_sequence.load() == sequence)
+          std::this_thread::yield();
+  }
+  // Write everything that is left. The streambuf itself is not destroyed: a thread that
+  // was in the middle of a Dout might still write to it (see AsyncDebugStreamBuf.h);
+  // that output is written by the background thread.
+  s_async_buf->drain();
+}
+
+NAMESPACE_DEBUG_END
+
+#endif // CWDEBUG
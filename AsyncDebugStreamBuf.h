@@ -0,0 +1,219 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief This file contains the declaration of class AsyncDebugStreamBuf.
+ */
+
+#pragma once
+
+#ifdef CWDEBUG
+
+#include "debug.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Usage:
+//
+//   Debug(NAMESPACE_DEBUG::init());
+//   Debug(NAMESPACE_DEBUG::start_async_output());
+//   ...
+//   Dout(dc::notice, "Hello");         // Only copies the formatted line into a per-thread ring buffer.
+//   ...
+//   Debug(NAMESPACE_DEBUG::stop_async_output());    // Writes everything that is left and restores the original ostream.
+//
+// While async output is active the ostream of libcw_do is replaced by one that
+// appends every complete line, with a timestamp, to a lock-free single producer,
+// single consumer ring buffer of the calling thread. A background thread drains
+// all ring buffers, merges the lines by timestamp and writes them to the
+// original ostream.
+//
+// Note that libcwd still formats the message on the calling thread; only the
+// write to the ostream is taken off the critical path.
+//
+// The AsyncDebugStreamBuf (and its background thread) is never destroyed before
+// the end of the program: a thread that was in the middle of a Dout when
+// stop_async_output() was called might still be writing to it. Such late writes
+// are still written to the original ostream; a following start_async_output()
+// for the same ostream reuses the same AsyncDebugStreamBuf.
+
+NAMESPACE_DEBUG_START
+
+// Wakes up the background thread of an AsyncDebugStreamBuf when there is something to write.
+// Producers only lock the mutex when the background thread is waiting.
+class DrainWakeup
+{
+ private:
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::atomic<bool> m_waiting;                  // Set while the background thread is (about to start) waiting.
+  bool m_notified;                              // Protected by m_mutex.
+
+ public:
+  DrainWakeup() : m_waiting(false), m_notified(false) { }
+
+  // Called by a producer after it committed a record, or when it needs space.
+  // Sequentially consistent: either the background thread sees the new record, or we see that it is waiting.
+  void notify() { if (m_waiting.load()) [[unlikely]] wake_up(); }
+
+  // Wake up the background thread, even if it isn't waiting yet.
+  void wake_up();
+
+  // Called by the background thread. Block until notified, unless has_work() returns true.
+  template<typename HasWork>
+  void wait(HasWork has_work)
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_waiting.store(true);
+    if (!has_work())
+      m_cv.wait(lock, [this]{ return m_notified; });
+    m_notified = false;
+    m_waiting.store(false, std::memory_order_relaxed);
+  }
+};
+
+// A single producer, single consumer ring buffer of records.
+// Each record consists of a RecordHeader followed by m_length bytes of payload.
+class DebugRing
+{
+ public:
+  static constexpr size_t capacity = 1 << 16;           // Must be a power of two.
+
+  enum kind_type : uint32_t
+  {
+    text_record,                // The payload is (part of) a line of text.
+    binary_record               // The payload is a site id followed by the raw arguments of a DoutDeferred (see DeferredDout.h).
+  };
+
+  struct RecordHeader
+  {
+    uint64_t m_timestamp;       // The time at which the record was started, in nanoseconds (std::chrono::steady_clock).
+    uint32_t m_length;          // The size of the payload.
+    kind_type m_kind;
+  };
+
+ private:
+  alignas(64) std::atomic<size_t> m_head;       // The end of the committed records. Written by the producer.
+  alignas(64) std::atomic<size_t> m_tail;       // The start of the first unread record. Written by the consumer.
+  alignas(64) size_t m_write;                   // Producer only: the end of the record that is being written.
+  size_t m_record_start;                        // Producer only: the start of the record that is being written, or no_record.
+  RecordHeader m_record;                        // Producer only: the header of the record that is being written.
+  std::atomic<bool> m_thread_exited;            // Set when the producing thread exited.
+  DrainWakeup* m_wakeup;                        // Notified when a record was committed or the producer is waiting for space.
+  char m_buffer[capacity];
+
+  static constexpr size_t no_record = static_cast<size_t>(-1);
+
+  void copy_in(size_t pos, void const* data, size_t len);
+  void copy_out(size_t pos, void* data, size_t len) const;
+  size_t free_space() const { return capacity - (m_write - m_tail.load(std::memory_order_acquire)); }
+  void wait_for_space(size_t len);
+
+ public:
+  DebugRing(DrainWakeup* wakeup) :
+    m_head(0), m_tail(0), m_write(0), m_record_start(no_record), m_thread_exited(false), m_wakeup(wakeup) { }
+
+  // Producer side.
+  bool in_record() const { return m_record_start != no_record; }
+  // Wait till there is room for at least a payload of payload_size bytes.
+  // The payload of a record of kind binary_record must not exceed payload_size, so that it is never split.
+  void begin_record(uint64_t timestamp, kind_type kind, size_t payload_size = 1);
+  void append(char const* data, size_t len);
+  void commit();
+  void set_thread_exited() { m_thread_exited.store(true, std::memory_order_release); }
+
+  // Consumer side.
+  // Copy the header of the first committed record into header and return true, or return false if there is none.
+  bool front(RecordHeader& header) const;
+  // Append the payload of the first committed record to out and remove it from the ring.
+  void pop(RecordHeader const& header, std::string& out);
+  bool thread_exited() const { return m_thread_exited.load(std::memory_order_acquire); }
+  // Sequentially consistent, see DrainWakeup::notify.
+  bool empty() const { return m_tail.load(std::memory_order_relaxed) == m_head.load(); }
+};
+
+// A streambuf that writes to the DebugRing of the calling thread.
+class AsyncDebugStreamBuf : public std::streambuf
+{
+ private:
+  std::ostream* m_os;                                   // The ostream that the background thread writes to.
+  std::mutex m_rings_mutex;                             // Protects m_rings.
+  std::vector<std::shared_ptr<DebugRing>> m_rings;      // One ring per thread that wrote to this streambuf; shared with a thread_local of that thread.
+  std::mutex m_drain_mutex;                             // Serializes drain(): there is only one consumer per ring.
+  std::vector<std::shared_ptr<DebugRing>> m_drain_rings; // Protected by m_drain_mutex: a copy of m_rings, so that m_rings_mutex isn't held while writing.
+  DrainWakeup m_wakeup;                                 // Wakes up the background thread.
+  std::atomic<bool> m_stop;
+  std::thread m_drain_thread;
+  uint64_t m_id;                                        // Unique per instance, to detect stale thread_local rings.
+
+ public:
+  AsyncDebugStreamBuf(std::ostream* os);
+  ~AsyncDebugStreamBuf();
+
+  // Return the ring of the calling thread, creating it if it doesn't exist yet.
+  DebugRing& ring();
+
+  // Write all committed records to m_os, merged by timestamp. Called by the background thread and by stop_async_output().
+  void drain();
+
+  // The ostream that the background thread writes to.
+  std::ostream* ostream() const { return m_os; }
+
+  static uint64_t now();
+
+ protected:
+  std::streamsize xsputn(char const* s, std::streamsize n) override;
+  int_type overflow(int_type c = traits_type::eof()) override;
+  int sync() override { return 0; }
+
+ private:
+  // Return true if there is a committed record in any ring, or if we're stopping.
+  bool has_work();
+  void drain_thread();
+};
+
+// The AsyncDebugStreamBuf that is installed by start_async_output(), if any.
+//
+// stop_async_output() doesn't write the remaining output before every thread
+// destructed the ActiveAsyncDebugStreamBuf objects that it created, so that records
+// written by DoutDeferred before stop_async_output() returned aren't left behind:
+// each thread has a sequence number that is incremented by the (outer most) constructor,
+// before reading the active AsyncDebugStreamBuf, and again by the destructor; it is odd
+// while in use. After removing the active AsyncDebugStreamBuf, stop_async_output() waits
+// until the sequence numbers of all threads are even or changed.
+class ActiveAsyncDebugStreamBuf
+{
+ private:
+  AsyncDebugStreamBuf* m_buf;
+
+ public:
+  ActiveAsyncDebugStreamBuf();
+  ~ActiveAsyncDebugStreamBuf();
+
+  ActiveAsyncDebugStreamBuf(ActiveAsyncDebugStreamBuf const&) = delete;
+  ActiveAsyncDebugStreamBuf& operator=(ActiveAsyncDebugStreamBuf const&) = delete;
+
+  // Return the active AsyncDebugStreamBuf, or nullptr if async output isn't active.
+  AsyncDebugStreamBuf* get() const { return m_buf; }
+};
+
+// Redirect the ostream of libcw_do to an AsyncDebugStreamBuf.
+void start_async_output();
+// Write all remaining output and restore the original ostream of libcw_do.
+void stop_async_output();
+
+NAMESPACE_DEBUG_END
+
+#endif // CWDEBUG
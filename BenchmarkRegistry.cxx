@@ -0,0 +1,41 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief This file contains the definitions of class BenchmarkRegistry.
+ */
+
+#include "sys.h"
+#include "BenchmarkRegistry.h"
+#include <algorithm>
+
+namespace benchmark {
+
+//static
+std::vector<RegisteredBenchmark>& BenchmarkRegistry::registry()
+{
+  // Benchmarks are registered during static initialization, possibly before anything else in this translation unit is initialized.
+  static std::vector<RegisteredBenchmark> s_registry;
+  return s_registry;
+}
+
+//static
+int BenchmarkRegistry::add(RegisteredBenchmark&& benchmark)
+{
+  auto& benchmarks = registry();
+  auto pos = std::upper_bound(benchmarks.begin(), benchmarks.end(), benchmark.m_name,
+      [](std::string const& name, RegisteredBenchmark const& b){ return name < b.m_name; });
+  benchmarks.insert(pos, std::move(benchmark));
+  return benchmarks.size();
+}
+
+//static
+std::vector<RegisteredBenchmark> const& BenchmarkRegistry::benchmarks()
+{
+  return registry();
+}
+
+} // namespace benchmark
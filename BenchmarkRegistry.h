@@ -0,0 +1,85 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief This file contains the declaration of class BenchmarkRegistry.
+ */
+
+#pragma once
+
+#include "benchmark.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+// Usage:
+//
+// Instead of writing a main() like the EXAMPLE_CODE in benchmark.h, register
+// each benchmark with REGISTER_BENCHMARK in a source file (that is compiled
+// with optimization) and link the executable with AICxx::benchmark_runner,
+// which provides main(). For example,
+//
+//   #include "sys.h"
+//   #include "cwds/BenchmarkRegistry.h"
+//
+//   REGISTER_BENCHMARK("lsb", 1000, 3, [m = uint64_t{0x0000080e70100000UL}]() mutable {
+//       uint64_t lsb;
+//       asm volatile ("" : "+r" (m));
+//       lsb = m & -m;
+//       asm volatile ("" :: "r" (lsb));
+//   });
+//
+// The runner accepts:
+//
+//   --list               Print the names of all registered benchmarks and exit.
+//   --filter <regex>     Only run the benchmarks whose name matches regex (std::regex_search).
+//   --cpu <nr>           Pin to CPU nr (default: the CPU that the runner starts on).
+//   --output <file>      Also write the results to file, see ResultSink (.csv or JSON Lines).
+//   --perf               Enable hardware performance counters, if available.
+//
+// The stopwatch overhead is calibrated once per (iterations, minimum_of) pair.
+
+namespace benchmark {
+
+struct RegisteredBenchmark
+{
+  std::string m_name;
+  unsigned int m_iterations;                            // The number of calls to the functor per measurement.
+  unsigned int m_minimum_of;                            // The number of measurements to take the minimum of.
+  std::function<MeasureResult(Stopwatch&)> m_measure;   // Calls Stopwatch::measure with the registered functor.
+};
+
+class BenchmarkRegistry
+{
+ public:
+  // Returns the registered benchmarks, sorted by name.
+  static std::vector<RegisteredBenchmark> const& benchmarks();
+
+  // Used by REGISTER_BENCHMARK. Returns the number of registered benchmarks.
+  template<int nk, class T>
+  static int add(std::string name, unsigned int iterations, unsigned int minimum_of, T const functor)
+  {
+    return add(RegisteredBenchmark{std::move(name), iterations, minimum_of,
+        [iterations, minimum_of, functor](Stopwatch& stopwatch){ return stopwatch.measure<nk>(iterations, functor, minimum_of); }});
+  }
+
+ private:
+  static std::vector<RegisteredBenchmark>& registry();
+  static int add(RegisteredBenchmark&& benchmark);
+};
+
+} // namespace benchmark
+
+#define CWDS_BENCHMARK_CONCAT_IMPL(a, b) a##b
+#define CWDS_BENCHMARK_CONCAT(a, b) CWDS_BENCHMARK_CONCAT_IMPL(a, b)
+
+// Register functor (the variadic argument, so that it may contain commas) as benchmark `name`.
+#define REGISTER_BENCHMARK_NK(name, nk, iterations, minimum_of, ...) \
+  static int const CWDS_BENCHMARK_CONCAT(cwds_registered_benchmark_, __COUNTER__) [[maybe_unused]] = \
+      ::benchmark::BenchmarkRegistry::add<nk>(name, iterations, minimum_of, __VA_ARGS__)
+
+#define REGISTER_BENCHMARK(name, iterations, minimum_of, ...) \
+  REGISTER_BENCHMARK_NK(name, 3, iterations, minimum_of, __VA_ARGS__)
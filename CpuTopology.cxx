@@ -0,0 +1,293 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief This file contains the definitions of class CpuTopology.
+ */
+
+#include "sys.h"
+#include "CpuTopology.h"
+#include "debug.h"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace benchmark {
+
+namespace {
+
+std::string const sysfs_cpu = "/sys/devices/system/cpu/";
+
+// Read the first line of a sysfs file. Returns an empty string if the file doesn't exist.
+std::string read_line(std::string const& path)
+{
+  std::ifstream file(path);
+  std::string line;
+  std::getline(file, line);
+  return line;
+}
+
+int read_int(std::string const& path, int default_value)
+{
+  std::string line = read_line(path);
+  if (line.empty())
+    return default_value;
+  return std::stoi(line);
+}
+
+// Parse a cpulist (see cpuset(7)), for example "0-3,8-11".
+std::vector<unsigned int> parse_cpu_list(std::string const& list)
+{
+  std::vector<unsigned int> cpus;
+  std::istringstream ss(list);
+  std::string range;
+  while (std::getline(ss, range, ','))
+  {
+    if (range.empty())
+      continue;
+    auto dash = range.find('-');
+    unsigned int first = std::stoul(range.substr(0, dash));
+    unsigned int last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+    for (unsigned int cpu = first; cpu <= last; ++cpu)
+      cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+// Parse a cache size, for example "32K".
+std::size_t parse_size(std::string const& size)
+{
+  if (size.empty())
+    return 0;
+  std::size_t pos;
+  std::size_t value = std::stoul(size, &pos);
+  if (pos < size.size())
+    switch (size[pos])
+    {
+      case 'K':
+        value <<= 10;
+        break;
+      case 'M':
+        value <<= 20;
+        break;
+      case 'G':
+        value <<= 30;
+        break;
+    }
+  return value;
+}
+
+} // namespace
+
+//static
+CpuTopology const& CpuTopology::instance()
+{
+  static CpuTopology const s_instance;
+  return s_instance;
+}
+
+CpuTopology::CpuTopology()
+{
+  namespace fs = std::filesystem;
+
+  std::vector<unsigned int> possible = parse_cpu_list(read_line(sysfs_cpu + "possible"));
+  m_number_of_cpus = possible.empty() ? sysconf(_SC_NPROCESSORS_CONF) : possible.back() + 1;
+
+  std::vector<unsigned int> online = parse_cpu_list(read_line(sysfs_cpu + "online"));
+  if (online.empty())
+    for (unsigned int cpu_nr = 0; cpu_nr < m_number_of_cpus; ++cpu_nr)
+      online.push_back(cpu_nr);
+
+  for (unsigned int cpu_nr : online)
+  {
+    std::string const dir = sysfs_cpu + "cpu" + std::to_string(cpu_nr) + '/';
+    Cpu cpu;
+    cpu.m_cpu = cpu_nr;
+    cpu.m_core_id = read_int(dir + "topology/core_id", cpu_nr);
+    cpu.m_package_id = read_int(dir + "topology/physical_package_id", 0);
+    cpu.m_smt_siblings = parse_cpu_list(read_line(dir + "topology/thread_siblings_list"));
+    if (cpu.m_smt_siblings.empty())
+      cpu.m_smt_siblings.push_back(cpu_nr);
+    cpu.m_numa_node = -1;
+    std::error_code ec;
+    for (auto const& entry : fs::directory_iterator(dir, ec))
+    {
+      std::string name = entry.path().filename().string();
+      if (name.size() > 4 && name.compare(0, 4, "node") == 0 && std::isdigit(name[4]))
+      {
+        cpu.m_numa_node = std::stoi(name.substr(4));
+        break;
+      }
+    }
+    for (int index = 0;; ++index)
+    {
+      std::string const cache_dir = dir + "cache/index" + std::to_string(index) + '/';
+      std::string type = read_line(cache_dir + "type");
+      if (type.empty())
+        break;
+      Cache cache;
+      cache.m_type = type == "Data" ? Cache::data : type == "Instruction" ? Cache::instruction : Cache::unified;
+      cache.m_level = read_int(cache_dir + "level", 0);
+      cache.m_size = parse_size(read_line(cache_dir + "size"));
+      cache.m_line_size = read_int(cache_dir + "coherency_line_size", 0);
+      cache.m_shared_cpus = parse_cpu_list(read_line(cache_dir + "shared_cpu_list"));
+      cpu.m_caches.push_back(std::move(cache));
+    }
+    std::stable_sort(cpu.m_caches.begin(), cpu.m_caches.end(), [](Cache const& c1, Cache const& c2){ return c1.m_level < c2.m_level; });
+    m_cpus.push_back(std::move(cpu));
+  }
+
+  // Only the first processor of /proc/cpuinfo is used; it is assumed that all processors are the same.
+  std::ifstream cpuinfo("/proc/cpuinfo");
+  std::string line;
+  while (std::getline(cpuinfo, line) && !line.empty())
+  {
+    auto colon = line.find(':');
+    if (colon == std::string::npos)
+      continue;
+    std::string key = line.substr(0, line.find_last_not_of(" \t", colon - 1) + 1);
+    std::string value = colon + 2 <= line.size() ? line.substr(colon + 2) : std::string{};
+    if (key == "vendor_id")
+      m_vendor_id = value;
+    else if (key == "model name")
+      m_model_name = value;
+    else if (key == "flags")
+    {
+      std::istringstream ss(value);
+      std::string flag;
+      while (ss >> flag)
+        m_flags.insert(flag);
+    }
+  }
+
+  Cache const* l1d = data_cache(1);
+  if (l1d && l1d->m_line_size > 0)
+    m_cache_line_size = l1d->m_line_size;
+  else
+  {
+    long line_size = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+    m_cache_line_size = line_size > 0 ? line_size : 64;
+  }
+
+  Dout(dc::notice, "CPU topology: " << *this);
+}
+
+CpuTopology::Cpu const& CpuTopology::cpu(unsigned int cpu_nr) const
+{
+  auto iter = std::lower_bound(m_cpus.begin(), m_cpus.end(), cpu_nr, [](Cpu const& cpu, unsigned int nr){ return cpu.m_cpu < nr; });
+  if (iter == m_cpus.end() || iter->m_cpu != cpu_nr)
+    throw std::out_of_range("CpuTopology::cpu: CPU " + std::to_string(cpu_nr) + " is not online");
+  return *iter;
+}
+
+std::vector<unsigned int> CpuTopology::physical_cores() const
+{
+  std::vector<unsigned int> cores;
+  for (auto&& cpu : m_cpus)
+    if (cpu.m_smt_siblings.front() == cpu.m_cpu)
+      cores.push_back(cpu.m_cpu);
+  return cores;
+}
+
+std::vector<unsigned int> CpuTopology::across_packages() const
+{
+  // Group the physical cores per package.
+  std::vector<unsigned int> const cores = physical_cores();
+  std::vector<std::vector<unsigned int>> packages;
+  std::vector<int> package_ids;
+  for (unsigned int cpu_nr : cores)
+  {
+    int package_id = cpu(cpu_nr).m_package_id;
+    auto iter = std::find(package_ids.begin(), package_ids.end(), package_id);
+    if (iter == package_ids.end())
+    {
+      package_ids.push_back(package_id);
+      packages.emplace_back();
+      iter = package_ids.end() - 1;
+    }
+    packages[iter - package_ids.begin()].push_back(cpu_nr);
+  }
+  // Round robin over the packages.
+  std::vector<unsigned int> result;
+  for (std::size_t i = 0; result.size() < cores.size(); ++i)
+    for (auto&& package : packages)
+      if (i < package.size())
+        result.push_back(package[i]);
+  return result;
+}
+
+std::vector<int> CpuTopology::numa_nodes() const
+{
+  std::vector<int> nodes;
+  for (auto&& cpu : m_cpus)
+    if (cpu.m_numa_node != -1 && std::find(nodes.begin(), nodes.end(), cpu.m_numa_node) == nodes.end())
+      nodes.push_back(cpu.m_numa_node);
+  std::sort(nodes.begin(), nodes.end());
+  return nodes;
+}
+
+std::vector<unsigned int> CpuTopology::cpus_on_node(int node) const
+{
+  std::vector<unsigned int> cpus;
+  for (auto&& cpu : m_cpus)
+    if (cpu.m_numa_node == node)
+      cpus.push_back(cpu.m_cpu);
+  return cpus;
+}
+
+CpuTopology::Cache const* CpuTopology::data_cache(int level, unsigned int cpu_nr) const
+{
+  if (m_cpus.empty())
+    return nullptr;
+  Cpu const& c = cpu_nr == cpu_any ? m_cpus.front() : cpu(cpu_nr);
+  for (auto&& cache : c.m_caches)
+    if (cache.m_level == level && cache.m_type != Cache::instruction)
+      return &cache;
+  return nullptr;
+}
+
+void CpuTopology::Cache::print_on(std::ostream& os) const
+{
+  os << "{L" << m_level << (m_type == data ? "d" : m_type == instruction ? "i" : "") <<
+    ", size:" << m_size << ", line size:" << m_line_size << ", shared by " << m_shared_cpus.size() << " CPUs}";
+}
+
+void CpuTopology::Cpu::print_on(std::ostream& os) const
+{
+  os << "{cpu:" << m_cpu << ", core:" << m_core_id << ", package:" << m_package_id << ", node:" << m_numa_node << ", siblings:{";
+  char const* prefix = "";
+  for (unsigned int sibling : m_smt_siblings)
+  {
+    os << prefix << sibling;
+    prefix = ", ";
+  }
+  os << "}}";
+}
+
+void CpuTopology::print_on(std::ostream& os) const
+{
+  os << "{model:\"" << m_model_name << "\", possible CPUs:" << m_number_of_cpus << ", online CPUs:" << m_cpus.size() <<
+    ", physical cores:" << physical_cores().size() << ", NUMA nodes:" << numa_nodes().size() << ", cache line size:" << m_cache_line_size;
+  if (!m_cpus.empty())
+  {
+    os << ", caches:{";
+    char const* prefix = "";
+    for (auto&& cache : m_cpus.front().m_caches)
+    {
+      os << prefix << cache;
+      prefix = ", ";
+    }
+    os << '}';
+  }
+  os << '}';
+}
+
+} // namespace benchmark
@@ -0,0 +1,110 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief This file contains the declaration of class CpuTopology.
+ */
+
+#pragma once
+
+#include "utils/has_print_on.h"
+#include <cstddef>
+#include <iosfwd>
+#include <set>
+#include <string>
+#include <vector>
+
+// Usage:
+//
+//   auto const& topology = benchmark::CpuTopology::instance();
+//
+//   // Run one thread per physical core (skipping SMT siblings).
+//   benchmark::ScalingBenchmark scaling(topology.physical_cores());
+//
+//   // Measure the interaction between two hardware threads of the same core.
+//   auto siblings = topology.smt_siblings(0);
+//
+//   // Spread threads over all sockets.
+//   benchmark::ScalingBenchmark across(topology.across_packages());
+//
+// The topology is read from /sys/devices/system/cpu and /proc/cpuinfo
+// once, the first time that instance() is called.
+
+namespace benchmark {
+using utils::has_print_on::operator<<;
+
+class CpuTopology
+{
+ public:
+  struct Cache
+  {
+    enum type_nt { data, instruction, unified } m_type;
+    int m_level;                                // 1 for L1, 2 for L2, etc.
+    std::size_t m_size;                         // The size of the cache in bytes.
+    unsigned int m_line_size;                   // The coherency line size in bytes.
+    std::vector<unsigned int> m_shared_cpus;    // The CPUs that share this cache.
+
+    void print_on(std::ostream& os) const;
+  };
+
+  struct Cpu
+  {
+    unsigned int m_cpu;                         // The CPU number as used by sched_setaffinity(2).
+    int m_core_id;                              // The core that this hardware thread belongs to (unique per package).
+    int m_package_id;                           // The physical package (socket).
+    int m_numa_node;                            // The NUMA node, or -1 if unknown.
+    std::vector<unsigned int> m_smt_siblings;   // All hardware threads of the same core, including this one.
+    std::vector<Cache> m_caches;                // The caches that this CPU uses, ordered by level.
+
+    void print_on(std::ostream& os) const;
+  };
+
+ private:
+  unsigned int m_number_of_cpus;                // One more than the highest possible CPU number.
+  unsigned int m_cache_line_size;               // The L1 data cache line size, in bytes.
+  std::vector<Cpu> m_cpus;                      // The online CPUs, ordered by CPU number.
+  std::string m_vendor_id;
+  std::string m_model_name;
+  std::set<std::string> m_flags;
+
+  CpuTopology();
+
+ public:
+  static constexpr unsigned int cpu_any = 0xffffffff;  // Not a CPU number: any online CPU.
+
+  static CpuTopology const& instance();
+
+  // The size to pass to CPU_ALLOC and CPU_ALLOC_SIZE.
+  unsigned int number_of_cpus() const { return m_number_of_cpus; }
+  unsigned int cache_line_size() const { return m_cache_line_size; }
+  std::string const& vendor_id() const { return m_vendor_id; }
+  std::string const& model_name() const { return m_model_name; }
+  // Return true if the flags line of /proc/cpuinfo contains flag.
+  bool has_flag(std::string const& flag) const { return m_flags.count(flag); }
+
+  std::vector<Cpu> const& cpus() const { return m_cpus; }
+  // Return the description of cpu_nr. Throws std::out_of_range if that CPU is not online.
+  Cpu const& cpu(unsigned int cpu_nr) const;
+
+  // Return the online CPUs that cpu_nr shares a core with, including cpu_nr itself.
+  std::vector<unsigned int> const& smt_siblings(unsigned int cpu_nr) const { return cpu(cpu_nr).m_smt_siblings; }
+  // Return the first hardware thread of every core.
+  std::vector<unsigned int> physical_cores() const;
+  // Same as physical_cores() but alternating between packages, so that the first N
+  // CPUs are spread as evenly as possible over all sockets.
+  std::vector<unsigned int> across_packages() const;
+  // Return the NUMA nodes that have at least one online CPU.
+  std::vector<int> numa_nodes() const;
+  // Return the online CPUs of NUMA node node.
+  std::vector<unsigned int> cpus_on_node(int node) const;
+  // Return the data (or unified) cache of level used by cpu_nr, or nullptr if there is no such cache.
+  // If cpu_nr is cpu_any then the caches of the first online CPU are used.
+  Cache const* data_cache(int level, unsigned int cpu_nr = cpu_any) const;
+
+  void print_on(std::ostream& os) const;
+};
+
+} // namespace benchmark
@@ -0,0 +1,70 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief This file contains the definitions of class DeferredSite.
+ */
+
+#include "sys.h"
+
+#ifdef CWDEBUG
+
+#include "DeferredDout.h"
+#include <deque>
+#include <sstream>
+
+NAMESPACE_DEBUG_START
+
+namespace {
+
+std::mutex s_sites_mutex;
+std::deque<DeferredSite const*> s_sites;        // The site table, indexed by site id.
+
+} // namespace
+
+// The label of a channel is padded with spaces to max_label_len_c; Dout prints the first WST_max_len
+// characters of it (the length of the longest label), so that all output lines up.
+DeferredSite::DeferredSite(DeferredSiteInfo info, char const* label, print_type print) :
+  m_info(info), m_label(label, libcwd::_private_::WST_max_len), m_print(print)
+{
+  std::lock_guard<std::mutex> lock(s_sites_mutex);
+  m_id = s_sites.size();
+  s_sites.push_back(this);
+}
+
+//static
+DeferredSite const& DeferredSite::get(uint32_t id)
+{
+  std::lock_guard<std::mutex> lock(s_sites_mutex);
+  ASSERT(id < s_sites.size());
+  return *s_sites[id];
+}
+
+//static
+void DeferredSite::decode(std::string const& payload, std::string& out)
+{
+  // The payload is the site id, the indentation and margin of libcw_do, followed by the arguments.
+  uint32_t id;
+  unsigned short indent;
+  char const* in = payload.data();
+  ASSERT(payload.size() >= sizeof(uint32_t) + sizeof(indent));
+  std::memcpy(&id, in, sizeof(uint32_t));
+  in += sizeof(uint32_t);
+  std::memcpy(&indent, in, sizeof(indent));
+  in += sizeof(indent);
+  DeferredSite const& site = get(id);
+  std::ostringstream os;
+  in = DeferredStringArg::print(in, os);
+  os << site.m_label << ": " << std::string(indent, ' ');
+  [[maybe_unused]] char const* end = site.m_print(in, os);
+  ASSERT(end == payload.data() + payload.size());
+  os << '\n';
+  out += os.str();
+}
+
+NAMESPACE_DEBUG_END
+
+#endif // CWDEBUG
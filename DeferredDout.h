@@ -0,0 +1,291 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief This file contains the declaration of DoutDeferred.
+ */
+
+#pragma once
+
+// Usage:
+//
+//   #include "cwds/DeferredDout.h"
+//
+//   Debug(NAMESPACE_DEBUG::start_async_output());
+//   ...
+//   DoutDeferred(dc::notice, "Received " << packet << " from " << peer);
+//
+// While async output is active (see AsyncDebugStreamBuf.h) DoutDeferred doesn't
+// run any operator<< on the calling thread: it only copies a site id and the raw
+// values of the arguments into a binary record in the ring buffer of the calling
+// thread. The background thread formats the record using the site table.
+//
+// How an argument is stored depends on its type:
+//   - strings (char const*, std::string, std::string_view) are copied,
+//   - trivially copyable types are copied with memcpy.
+// If any argument is of another type (a std::shared_ptr, a container, etc), the line
+// is formatted immediately (as Dout): such a value can't be copied into the ring
+// buffer byte for byte, and copying it elsewhere would cost a memory allocation
+// on the calling thread, which is at least as expensive as formatting it.
+//
+// Pointers (other than strings and void pointers) and views (like std::span) are
+// rejected at compile time: what they point to might no longer exist by the time
+// the line is formatted. Pass the pointee instead.
+//
+// The margin and indentation of libcw_do are stored in the record, so that the line
+// is printed as Dout would have printed it. The channel must be a plain channel (no
+// control flags) and stream manipulators are not supported. When async output isn't
+// active, DoutDeferred is the same as Dout.
+
+#ifndef CWDEBUG
+
+#define DoutDeferred(cntrl, ...) do { } while(0)
+
+#else // CWDEBUG
+
+#include "AsyncDebugStreamBuf.h"
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <ostream>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+NAMESPACE_DEBUG_START
+
+// How an argument of DoutDeferred is stored in, and printed from, a binary record.
+// By default an argument can't be stored: deferrable is false and the line is formatted immediately.
+template<typename T>
+struct DeferredArg
+{
+  static_assert(!std::ranges::view<T>, "DoutDeferred: the data of a view might be gone by the time it is printed; pass a copy.");
+
+  static constexpr bool deferrable = false;
+};
+
+// Trivially copyable types are stored by value.
+template<typename T>
+requires std::is_trivially_copyable_v<T>
+struct DeferredArg<T>
+{
+  static_assert(!std::is_pointer_v<T> || std::is_void_v<std::remove_pointer_t<T>>,
+      "DoutDeferred: the pointee might be gone by the time it is printed; pass the pointee (or cast to void const* to print the address).");
+  static_assert(!std::ranges::view<T>, "DoutDeferred: the data of a view might be gone by the time it is printed; pass a copy.");
+
+  static constexpr bool deferrable = true;
+
+  static size_t size(T const&) { return sizeof(T); }
+
+  static void write(DebugRing& ring, T const& value)
+  {
+    ring.append(reinterpret_cast<char const*>(&value), sizeof(T));
+  }
+
+  static char const* print(char const* in, std::ostream& os)
+  {
+    LIBCWD_USING_OSTREAM_PRELUDE;
+    alignas(T) char storage[sizeof(T)];
+    std::memcpy(storage, in, sizeof(T));
+    os << *std::launder(reinterpret_cast<T const*>(storage));
+    return in + sizeof(T);
+  }
+};
+
+// Strings are stored as a length followed by the characters.
+struct DeferredStringArg
+{
+  static constexpr uint32_t null_string = static_cast<uint32_t>(-1);
+  static constexpr bool deferrable = true;
+
+  static size_t size(char const* str, size_t len) { return sizeof(uint32_t) + (str ? len : 0); }
+
+  static void write(DebugRing& ring, char const* str, size_t len)
+  {
+    uint32_t const length = str ? static_cast<uint32_t>(len) : null_string;
+    ring.append(reinterpret_cast<char const*>(&length), sizeof(uint32_t));
+    if (str)
+      ring.append(str, len);
+  }
+
+  static char const* print(char const* in, std::ostream& os)
+  {
+    uint32_t length;
+    std::memcpy(&length, in, sizeof(uint32_t));
+    in += sizeof(uint32_t);
+    if (length == null_string)
+    {
+      os << "NULL";
+      return in;
+    }
+    os.write(in, length);
+    return in + length;
+  }
+};
+
+template<>
+struct DeferredArg<char const*> : DeferredStringArg
+{
+  static size_t size(char const* str) { return DeferredStringArg::size(str, str ? std::strlen(str) : 0); }
+  static void write(DebugRing& ring, char const* str) { DeferredStringArg::write(ring, str, str ? std::strlen(str) : 0); }
+  using DeferredStringArg::print;
+};
+
+template<>
+struct DeferredArg<char*> : DeferredArg<char const*>
+{
+};
+
+template<>
+struct DeferredArg<std::string_view> : DeferredStringArg
+{
+  static size_t size(std::string_view str) { return DeferredStringArg::size(str.data(), str.size()); }
+  static void write(DebugRing& ring, std::string_view str) { DeferredStringArg::write(ring, str.data(), str.size()); }
+  using DeferredStringArg::print;
+};
+
+template<>
+struct DeferredArg<std::string> : DeferredArg<std::string_view>
+{
+};
+
+// The arguments of a DoutDeferred, captured by reference (or, for arrays, as pointer).
+//
+// DeferredCapture<>{} << a << b << c returns a DeferredCapture<A const&, B const&, C const&>
+// without evaluating any operator<<(std::ostream&, ...).
+template<typename... Args>
+struct DeferredCapture
+{
+  std::tuple<Args...> m_args;
+
+  // False if any of the arguments must be formatted immediately.
+  static constexpr bool deferrable = (true && ... && DeferredArg<std::remove_cvref_t<Args>>::deferrable);
+
+  template<typename T>
+  auto operator<<(T const& arg) const
+  {
+    using stored_type = std::conditional_t<std::is_array_v<T>, std::decay_t<T const>, T const&>;
+    return std::apply([&](auto const&... args){
+      return DeferredCapture<Args..., stored_type>{std::tuple<Args..., stored_type>(args..., arg)};
+    }, m_args);
+  }
+
+  // The size of the serialized arguments.
+  size_t size() const
+  {
+    return std::apply([](auto const&... args){
+      return (size_t{0} + ... + DeferredArg<std::remove_cvref_t<Args>>::size(args));
+    }, m_args);
+  }
+
+  void write(DebugRing& ring) const
+  {
+    std::apply([&](auto const&... args){
+      (DeferredArg<std::remove_cvref_t<Args>>::write(ring, args), ...);
+    }, m_args);
+  }
+
+  // Print serialized arguments, starting at in, and return a pointer to the end of them.
+  static char const* print(char const* in, std::ostream& os)
+  {
+    ((in = DeferredArg<std::remove_cvref_t<Args>>::print(in, os)), ...);
+    return in;
+  }
+
+  void print_on(std::ostream& os) const
+  {
+    LIBCWD_USING_OSTREAM_PRELUDE;
+    std::apply([&](auto const&... args){ (os << ... << args); }, m_args);
+  }
+};
+
+template<typename... Args>
+std::ostream& operator<<(std::ostream& os, DeferredCapture<Args...> const& capture)
+{
+  capture.print_on(os);
+  return os;
+}
+
+struct DeferredSiteInfo
+{
+  char const* m_channel;        // The channel expression, as passed to DoutDeferred.
+  char const* m_file;
+  int m_line;
+};
+
+// A DoutDeferred call site.
+class DeferredSite
+{
+ public:
+  using print_type = char const* (*)(char const* in, std::ostream& os);
+
+ private:
+  DeferredSiteInfo m_info;
+  std::string m_label;          // The label of the channel, padded like Dout pads it.
+  print_type m_print;           // Prints the serialized arguments.
+  uint32_t m_id;                // The index into the site table.
+
+ public:
+  // Add a new site to the site table.
+  DeferredSite(DeferredSiteInfo info, char const* label, print_type print);
+
+  uint32_t id() const { return m_id; }
+  DeferredSiteInfo const& info() const { return m_info; }
+
+  // Return the site with the given id.
+  static DeferredSite const& get(uint32_t id);
+
+  // Append the formatted line of the binary record payload to out.
+  static void decode(std::string const& payload, std::string& out);
+};
+
+template<typename SiteInfo, typename Channel, typename... Args>
+void deferred_dout(SiteInfo site_info, Channel const& channel, DeferredCapture<Args...> const& capture)
+{
+  if constexpr (!DeferredCapture<Args...>::deferrable)
+    Dout(channel, capture);
+  else
+  {
+    // One site per DoutDeferred, because every SiteInfo is a different lambda.
+    static DeferredSite const site(site_info(), channel.get_label(), &DeferredCapture<Args...>::print);
+
+    {
+      // Makes stop_async_output() wait until the record is committed (but not while calling Dout).
+      ActiveAsyncDebugStreamBuf const active;
+      AsyncDebugStreamBuf* buf = active.get();
+      auto const& margin = libcwd::libcw_do.margin();
+      unsigned short const indent = libcwd::libcw_do.get_indent();
+      size_t const size = sizeof(uint32_t) + sizeof(indent) + DeferredStringArg::size(margin.c_str(), margin.size()) + capture.size();
+      // Also use Dout if this thread is in the middle of writing a line.
+      if (buf && sizeof(DebugRing::RecordHeader) + size <= DebugRing::capacity && !buf->ring().in_record()) [[likely]]
+      {
+        DebugRing& ring = buf->ring();
+        uint32_t const id = site.id();
+        ring.begin_record(AsyncDebugStreamBuf::now(), DebugRing::binary_record, size);
+        ring.append(reinterpret_cast<char const*>(&id), sizeof(uint32_t));
+        ring.append(reinterpret_cast<char const*>(&indent), sizeof(indent));
+        DeferredStringArg::write(ring, margin.c_str(), margin.size());
+        capture.write(ring);
+        ring.commit();
+        return;
+      }
+    }
+    Dout(channel, capture);
+  }
+}
+
+NAMESPACE_DEBUG_END
+
+// Like Dout, don't do anything when libcw_do is turned off (on this thread) or the channel is off.
+#define DoutDeferred(cntrl, ...) \
+  Debug(LIBCWD_TSD_DECLARATION; \
+    if (LIBCWD_DO_TSD_MEMBER_OFF(::libcwd::libcw_do) < 0 && (cntrl).is_on()) \
+      ::NAMESPACE_DEBUG::deferred_dout([]{ return ::NAMESPACE_DEBUG::DeferredSiteInfo{#cntrl, __FILE__, __LINE__}; }, \
+          cntrl, ::NAMESPACE_DEBUG::DeferredCapture<>{} << __VA_ARGS__))
+
+#endif // CWDEBUG
@@ -15,6 +15,8 @@
 #include <array>
 #include <cstdlib>
 #include <iostream>
+#include <limits>
+#include <type_traits>
 #include <debug.h>
 
 namespace eda {
@@ -26,7 +28,11 @@ struct FrequencyCounterResult
 
   enum type_nt { t999, tm1, tm2 } m_type;
 
+  double m_tsc_frequency = 0.0;         // The number of clock cycles per second, if known.
+
   operator int() const { return m_cycles; }
+  // Return m_cycles converted to nanoseconds; requires m_tsc_frequency to be set.
+  double nanoseconds() const { ASSERT(m_tsc_frequency > 0.0); return m_cycles * 1e9 / m_tsc_frequency; }
   bool is_t999() const { return m_type == t999; }
   bool is_tm1() const { return m_type == tm1; }
   bool is_tm2() const { return m_type == tm2; }
@@ -34,52 +40,98 @@ struct FrequencyCounterResult
 
 // Count the number of occurrances of type T, added to this object with FrequencyCounter<T>::add(T).
 // Keeps track of the nk most frequently occurring values of T.
-template<typename T, int nk = 1>
+//
+// The counts are stored in a dense array of `window` buckets, centered on the first value added;
+// values that fall outside of that window are stored in a std::map. Because measurements tend
+// to cluster in a narrow range, add() normally doesn't allocate memory or chase pointers.
+// If the first value was an outlier (a cold cache, an interrupt), most values end up in the
+// map; once that happened `window` times the dense window is moved to be centered on the
+// most frequent value.
+template<typename T, int nk = 1, int window = 256>
 class FrequencyCounter
 {
-  struct Data { size_t count; int k; Data(size_t count_, int k_) : count(count_), k(k_) { } };
-  using counters_type = std::map<T, Data>;
-  using iterator = typename counters_type::iterator;
+  static_assert(std::is_integral_v<T>, "FrequencyCounter requires an integral type.");
+
+  struct Data
+  {
+    T value{};          // The value that is being counted (only valid when count > 0).
+    int k = -1;         // The index into m_max when this is one of the nk most frequent values, or -1.
+    size_t count = 0;   // The number of times value was added.
+  };
+  using outliers_type = std::map<T, Data>;
 
-  counters_type m_counters;
-  iterator m_hint;
-  std::array<iterator, nk> m_max_iters;
+  std::array<Data, window> m_dense;     // The counts of the values m_offset till m_offset + window.
+  outliers_type m_outliers;             // The counts of values outside the dense window.
+  T m_offset;                           // The value that corresponds with m_dense[0].
+  bool m_empty;                         // Set when nothing was added yet (m_offset is not initialized).
+  size_t m_dense_hits;                  // The number of values added to m_dense since m_offset was last set.
+  size_t m_outlier_hits;                // The number of values added to m_outliers since m_offset was last set.
+  std::array<Data*, nk> m_max;          // The nk most frequent values, or nullptr.
   FrequencyCounterResult m_result;
 
-  size_t get_count(int k);
+  Data* find(T value);
+  static T offset_for(T center) { return center < std::numeric_limits<T>::min() + window / 2 ? std::numeric_limits<T>::min() : center - window / 2; }
+  // Move the dense window so that it is centered on center.
+  void recenter(T center);
+  size_t get_count(int k) const { return m_max[k] ? m_max[k]->count : 0; }
+
+  // Call f(data) for each value that was added, in order of increasing value.
+  template<typename F> void for_each(F f) const;
 
  public:
-  FrequencyCounter() : m_hint(m_counters.end())
-  {
-    for (int i = 0; i < nk; ++i)
-      m_max_iters[i] = m_counters.end();
-  }
+  FrequencyCounter() : m_offset{}, m_empty(true), m_dense_hits(0), m_outlier_hits(0) { m_max.fill(nullptr); }
+
+  // The dense buckets and m_max point into this object.
+  FrequencyCounter(FrequencyCounter const&) = delete;
+  FrequencyCounter& operator=(FrequencyCounter const&) = delete;
 
   bool add(T value);    // Returns true when result() became valid.
-  T most() const { return m_max_iters[0]->first; }
+  T most() const { return m_max[0]->value; }
   FrequencyCounterResult result() const { return m_result; }
   double average() const;
 
-  counters_type const& counters() const { return m_counters; }
+  // Return a value --> count map of everything that was added.
+  std::map<T, size_t> counters() const;
 
   void print_on(std::ostream& os) const;
 };
 
-template<typename T, int nk>
-void FrequencyCounter<T, nk>::print_on(std::ostream& os) const
+template<typename T, int nk, int window>
+template<typename F>
+void FrequencyCounter<T, nk, window>::for_each(F f) const
+{
+  auto outlier = m_outliers.begin();
+  for (; outlier != m_outliers.end() && outlier->first < m_offset; ++outlier)
+    f(outlier->second);
+  for (Data const& data : m_dense)
+    if (data.count > 0)
+      f(data);
+  for (; outlier != m_outliers.end(); ++outlier)
+    f(outlier->second);
+}
+
+template<typename T, int nk, int window>
+std::map<T, size_t> FrequencyCounter<T, nk, window>::counters() const
+{
+  std::map<T, size_t> result;
+  for_each([&result](Data const& data){ result.emplace_hint(result.end(), data.value, data.count); });
+  return result;
+}
+
+template<typename T, int nk, int window>
+void FrequencyCounter<T, nk, window>::print_on(std::ostream& os) const
 {
   os << "map:" << std::endl;
-  for (auto&& counter : m_counters)
-  {
-    os << "value: " << counter.first << "; data = { count = " << counter.second.count << ",  k = " << counter.second.k << "}" << std::endl;
-  }
+  for_each([&os](Data const& data){
+    os << "value: " << data.value << "; data = { count = " << data.count << ",  k = " << data.k << "}" << std::endl;
+  });
   os << "max count/value/iter";
   for (int i = 0; i < nk; ++i)
   {
-    if (m_max_iters[i] != m_counters.end())
+    if (m_max[i])
     {
-      os << " {" << m_max_iters[i]->first << ", " << m_max_iters[i]->second.count << '}';
-      ASSERT(m_max_iters[i]->second.k == i);
+      os << " {" << m_max[i]->value << ", " << m_max[i]->count << '}';
+      ASSERT(m_max[i]->k == i);
     }
     else
       os << " <empty>";
@@ -87,74 +139,131 @@ void FrequencyCounter<T, nk>::print_on(std::ostream& os) const
   os << std::endl;
 }
 
-template<typename T, int nk>
-size_t FrequencyCounter<T, nk>::get_count(int k)
+template<typename T, int nk, int window>
+void FrequencyCounter<T, nk, window>::recenter(T center)
 {
-  return m_max_iters[k] == m_counters.end() ? 0 : m_max_iters[k]->second.count;
+  m_dense_hits = m_outlier_hits = 0;
+  T const offset = offset_for(center);
+  if (offset == m_offset)
+    return;
+  // Collect everything that was counted so far and redistribute it over m_dense and m_outliers.
+  outliers_type all = std::move(m_outliers);
+  m_outliers.clear();
+  for (Data& data : m_dense)
+    if (data.count > 0)
+      all.emplace(data.value, data);
+  m_dense.fill(Data{});
+  m_offset = offset;
+  using unsigned_type = std::make_unsigned_t<T>;
+  for (auto& [value, data] : all)
+  {
+    unsigned_type const index = static_cast<unsigned_type>(value) - static_cast<unsigned_type>(m_offset);
+    Data* location;
+    if (index < static_cast<unsigned_type>(window))
+    {
+      m_dense[index] = data;
+      location = &m_dense[index];
+    }
+    else
+      location = &m_outliers.emplace_hint(m_outliers.end(), value, data)->second;
+    if (location->k != -1)
+      m_max[location->k] = location;
+  }
+}
+
+template<typename T, int nk, int window>
+typename FrequencyCounter<T, nk, window>::Data* FrequencyCounter<T, nk, window>::find(T value)
+{
+  if (m_empty) [[unlikely]]
+  {
+    m_offset = offset_for(value);
+    m_empty = false;
+  }
+  using unsigned_type = std::make_unsigned_t<T>;
+  // This also wraps around to a large value when value < m_offset.
+  unsigned_type index = static_cast<unsigned_type>(value) - static_cast<unsigned_type>(m_offset);
+  // If most values miss the dense window, then move it to where the values are.
+  if (index >= static_cast<unsigned_type>(window) &&
+      ++m_outlier_hits >= static_cast<size_t>(window) && m_outlier_hits > m_dense_hits) [[unlikely]]
+  {
+    recenter(m_max[0]->value);
+    index = static_cast<unsigned_type>(value) - static_cast<unsigned_type>(m_offset);
+  }
+  Data* data;
+  if (index < static_cast<unsigned_type>(window)) [[likely]]
+  {
+    ++m_dense_hits;
+    data = &m_dense[index];
+  }
+  else
+    data = &m_outliers[value];
+  data->value = value;
+  return data;
 }
 
-template<typename T, int nk>
-bool FrequencyCounter<T, nk>::add(T value)
+template<typename T, int nk, int window>
+bool FrequencyCounter<T, nk, window>::add(T value)
 {
-  m_hint = m_counters.emplace_hint(m_hint, value, Data{0, -1});
-  size_t count = ++(m_hint->second.count);
-  int k = m_hint->second.k;
+  Data* data = find(value);
+  size_t count = ++data->count;
+  int k = data->k;
   if (k == -1)
   {
     k = nk - 1;
     if (get_count(k) < count)
     {
-      while (k > 0 && (m_max_iters[k - 1] == m_counters.end() || m_max_iters[k - 1]->second.count == count - 1))
+      while (k > 0 && (!m_max[k - 1] || m_max[k - 1]->count == count - 1))
         --k;
-      if (m_max_iters[k] != m_counters.end())
-        m_max_iters[k]->second.k = -1;
-      m_max_iters[k] = m_hint;
-      m_hint->second.k = k;
+      if (m_max[k])
+        m_max[k]->k = -1;
+      m_max[k] = data;
+      data->k = k;
     }
   }
   else if (nk > 1)
   {
     int new_k = k;
-    while (new_k > 0 && m_max_iters[new_k - 1]->second.count == count - 1)
+    while (new_k > 0 && m_max[new_k - 1]->count == count - 1)
       --new_k;
     if (new_k != k)
     {
-      std::swap(m_max_iters[k], m_max_iters[new_k]);
-      m_max_iters[k]->second.k = k;
-      m_max_iters[new_k]->second.k = new_k;
+      std::swap(m_max[k], m_max[new_k]);
+      m_max[k]->k = k;
+      m_max[new_k]->k = new_k;
     }
   }
   int m2;
   for (int i = 0; i < nk - 1 && ((m2 = get_count(i + 1)) > 10 || get_count(i) >= 31); ++i)
   {
-    int m1 = m_max_iters[i]->second.count;
+    int m1 = m_max[i]->count;
     ASSERT(m1 >= m2);
     double test_statistic = 1.0 * (m1 - m2) * (m1 - m2) / (m1 + m2);
     if (test_statistic > 10.828)
     {
-      m_result.m_cycles = m_max_iters[0]->first;
+      m_result.m_cycles = m_max[0]->value;
       m_result.m_type = (i == 0) ? FrequencyCounterResult::t999 : (i == 1) ? FrequencyCounterResult::tm1 : FrequencyCounterResult::tm2;
       size_t sum = 0;
       for (int j = 0; j <= i; ++j)
-        sum += m_max_iters[j]->first;
+        sum += m_max[j]->value;
       m_result.m_cycles = sum / (i + 1);
       return true;
     }
-    if (std::abs(typename std::make_signed<T>::type(m_max_iters[i]->first - m_max_iters[i - 1]->first)) > 1)
+    // Only average over the next bucket too if it is adjacent to this one.
+    if (std::abs(typename std::make_signed<T>::type(m_max[i]->value - m_max[i + 1]->value)) > 1)
       break;
   }
   return false;
 }
 
-template<typename T, int nk>
-double FrequencyCounter<T, nk>::average() const
+template<typename T, int nk, int window>
+double FrequencyCounter<T, nk, window>::average() const
 {
   double avg = 0;
   size_t count = 0;
-  for (int i = 0; i < nk && m_max_iters[i] != m_counters.end(); ++i)
+  for (int i = 0; i < nk && m_max[i]; ++i)
   {
-    avg += (double)m_max_iters[i]->first * m_max_iters[i]->second.count;
-    count += m_max_iters[i]->second.count;
+    avg += (double)m_max[i]->value * m_max[i]->count;
+    count += m_max[i]->count;
   }
   return avg / count;
 }
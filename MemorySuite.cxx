@@ -0,0 +1,162 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief This file contains the definitions of class MemorySuite.
+ */
+
+#include "sys.h"
+#include "MemorySuite.h"
+#include "debug.h"
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+
+namespace benchmark {
+
+namespace {
+
+// A cache line aligned buffer.
+class Buffer
+{
+ private:
+  char* m_data;
+  std::size_t m_size;
+
+ public:
+  Buffer(std::size_t size) : m_size(size)
+  {
+    m_data = static_cast<char*>(std::aligned_alloc(4096, size));
+    if (!m_data)
+      throw std::bad_alloc();
+  }
+  ~Buffer() { std::free(m_data); }
+
+  Buffer(Buffer const&) = delete;
+  Buffer& operator=(Buffer const&) = delete;
+
+  char* data() const { return m_data; }
+  std::size_t size() const { return m_size; }
+};
+
+// Return a functor that does one dependent load per call, following a random cyclic permutation of the cache lines of a buffer of size bytes.
+auto make_pointer_chase(double size)
+{
+  std::size_t const line_size = CpuTopology::instance().cache_line_size();
+  auto buffer = std::make_shared<Buffer>(static_cast<std::size_t>(size));
+  std::size_t const lines = buffer->size() / line_size;
+  // Sattolo's algorithm: a random permutation that consists of a single cycle.
+  std::vector<std::size_t> order(lines);
+  for (std::size_t i = 0; i < lines; ++i)
+    order[i] = i;
+  std::mt19937_64 random(lines);
+  for (std::size_t i = lines - 1; i > 0; --i)
+    std::swap(order[i], order[std::uniform_int_distribution<std::size_t>(0, i - 1)(random)]);
+  for (std::size_t i = 0; i < lines; ++i)
+    *reinterpret_cast<void**>(buffer->data() + order[i] * line_size) = buffer->data() + order[(i + 1) % lines] * line_size;
+  return [buffer, p = static_cast<void*>(buffer->data())]() mutable {
+    p = *static_cast<void**>(p);
+    asm volatile ("" : "+r" (p));
+  };
+}
+
+// Return a functor that reads one cache line per call, sequentially through a buffer of size bytes.
+auto make_stream(double size)
+{
+  std::size_t const line_size = CpuTopology::instance().cache_line_size();
+  auto buffer = std::make_shared<Buffer>(static_cast<std::size_t>(size));
+  for (std::size_t i = 0; i < buffer->size(); i += sizeof(uint64_t))
+    *reinterpret_cast<uint64_t*>(buffer->data() + i) = i;
+  return [buffer, offset = std::size_t{0}, line_size]() mutable {
+    uint64_t const* line = reinterpret_cast<uint64_t const*>(buffer->data() + offset);
+    uint64_t sum = 0;
+    for (std::size_t i = 0; i < line_size / sizeof(uint64_t); ++i)
+      sum += line[i];
+    asm volatile ("" :: "r" (sum));
+    offset += line_size;
+    if (offset == buffer->size())
+      offset = 0;
+  };
+}
+
+} // namespace
+
+MemorySuite::MemorySuite(Stopwatch& stopwatch, std::size_t max_size) :
+  m_stopwatch(stopwatch), m_max_size(max_size),
+  m_latency(stopwatch, iterations, minimum_of), m_bandwidth(stopwatch, iterations, minimum_of)
+{
+  if (m_max_size == 0)
+  {
+    std::size_t llc_size = 0;
+    for (int level = 1; CpuTopology::instance().data_cache(level); ++level)
+      llc_size = CpuTopology::instance().data_cache(level)->m_size;
+    m_max_size = 4 * std::max(llc_size, std::size_t{8 << 20});
+  }
+}
+
+void MemorySuite::run()
+{
+  DoutEntering(dc::notice, "MemorySuite::run()");
+  if (m_stopwatch.get_calibrated_iterations() != iterations)
+    m_stopwatch.calibrate_overhead(iterations, minimum_of);
+  std::vector<double> const sizes = working_set_sizes();
+  m_latency.run("latency", sizes, make_pointer_chase);
+  m_bandwidth.run("bandwidth", sizes, make_stream);
+}
+
+//static
+Sweep<3>::Point const* MemorySuite::find(Sweep<3> const& sweep, double x)
+{
+  // Return the point with the largest working set size that is not larger than x.
+  Sweep<3>::Point const* result = nullptr;
+  for (auto&& point : sweep.points())
+    if (point.m_x <= x)
+      result = &point;
+  return result;
+}
+
+MemorySuite::Summary MemorySuite::summary() const
+{
+  Summary summary;
+  double const line_size = CpuTopology::instance().cache_line_size();
+  auto add_level = [&](std::string name, double x){
+    Sweep<3>::Point const* latency = find(m_latency, x);
+    Sweep<3>::Point const* bandwidth = find(m_bandwidth, x);
+    if (latency && bandwidth)
+      summary.m_levels.push_back({std::move(name), static_cast<std::size_t>(latency->m_x), latency->m_y, line_size / bandwidth->m_y});
+  };
+  CpuTopology const& topology = CpuTopology::instance();
+  for (int level = 1; topology.data_cache(level); ++level)
+  {
+    CpuTopology::Cache const* cache = topology.data_cache(level);
+    if (cache->m_size / 2 > m_max_size)
+      break;
+    add_level("L" + std::to_string(level) + (cache->m_type == CpuTopology::Cache::data ? "d" : ""), cache->m_size / 2);
+  }
+  // Only report DRAM when the largest working set size doesn't fit in the caches.
+  CpuTopology::Cache const* llc = nullptr;
+  for (int level = 1; topology.data_cache(level); ++level)
+    llc = topology.data_cache(level);
+  if (!llc || m_max_size > llc->m_size)
+    add_level("DRAM", m_max_size);
+  return summary;
+}
+
+void MemorySuite::Summary::print_on(std::ostream& os) const
+{
+  os << '{';
+  char const* prefix = "";
+  for (auto&& level : m_levels)
+  {
+    os << prefix << level.m_name << ":" << level.m_latency << " cycles, " << level.m_bandwidth << " bytes/cycle";
+    prefix = "; ";
+  }
+  os << '}';
+}
+
+} // namespace benchmark
@@ -0,0 +1,118 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief This file contains the declaration of class MemorySuite.
+ */
+
+#pragma once
+
+#include "Sweep.h"
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// Usage example
+//
+// MemorySuite measures the load latency (pointer chasing through a random
+// cyclic permutation of cache lines) and the streaming read bandwidth for
+// working set sizes from 4 kiB up to four times the size of the last level
+// cache, so that every level of the memory hierarchy, including DRAM, shows up.
+//
+#ifdef EXAMPLE_CODE        // Undefined
+
+#include "sys.h"
+#include "debug.h"
+#include "cwds/MemorySuite.h"
+#include "cwds/gnuplot_tools.h"
+
+int main()
+{
+  Debug(NAMESPACE_DEBUG::init());
+
+  benchmark::Stopwatch stopwatch;
+  benchmark::MemorySuite suite(stopwatch);
+  suite.run();
+  std::cout << suite.summary() << std::endl;    // For example {L1d:5 cycles, L2:14 cycles, L3:52 cycles, DRAM:210 cycles}
+
+  eda::Plot latency("Load latency", "working set size (bytes)", "cycles per load");
+  latency.add("set logscale x 2");
+  suite.add_latency_to(latency);
+  latency.show("yerrorlines");
+
+  eda::Plot bandwidth("Read bandwidth", "working set size (bytes)", "bytes per cycle");
+  bandwidth.add("set logscale x 2");
+  suite.add_bandwidth_to(bandwidth);
+  bandwidth.show("yerrorlines");
+}
+
+#endif // EXAMPLE_CODE
+
+namespace benchmark {
+
+class MemorySuite
+{
+ public:
+  static constexpr unsigned int iterations = 1024;      // The number of loads (cache lines) per measurement.
+  static constexpr unsigned int minimum_of = 3;
+
+  // The measured latency of each cache level, and of DRAM.
+  struct Summary
+  {
+    struct Level
+    {
+      std::string m_name;               // "L1d", "L2", ..., or "DRAM".
+      std::size_t m_working_set_size;   // The working set size that this level was measured with.
+      double m_latency;                 // In clock cycles per load.
+      double m_bandwidth;               // In bytes per clock cycle.
+    };
+    std::vector<Level> m_levels;
+
+    void print_on(std::ostream& os) const;
+  };
+
+ private:
+  Stopwatch& m_stopwatch;
+  std::size_t m_max_size;               // The largest working set size.
+  Sweep<3> m_latency;                   // Clock cycles per dependent load.
+  Sweep<3> m_bandwidth;                 // Clock cycles per streamed cache line.
+
+ public:
+  // Use working set sizes up till max_size bytes, or four times the size of the last level cache
+  // (but at least 32 MiB) if max_size is zero.
+  MemorySuite(Stopwatch& stopwatch, std::size_t max_size = 0);
+
+  // Return the working set sizes (powers of two) that run() uses.
+  std::vector<double> working_set_sizes() const { return Sweep<3>::geometric(4096, m_max_size, 2); }
+
+  // Run all measurements. Calls calibrate_overhead(iterations, minimum_of) on the stopwatch if needed.
+  void run();
+
+  // Return the latency and bandwidth at half the size of every data cache level and at the largest working set size.
+  Summary summary() const;
+
+  template<class PLOT>
+  void add_latency_to(PLOT& plot) const
+  {
+    m_latency.add_to(plot);
+  }
+
+  // Adds the bandwidth in bytes per clock cycle.
+  template<class PLOT>
+  void add_bandwidth_to(PLOT& plot) const
+  {
+    double const line_size = CpuTopology::instance().cache_line_size();
+    for (auto&& point : m_bandwidth.points())
+      plot.add_data_point(point.m_x, line_size / point.m_y, line_size * point.m_dy / (point.m_y * point.m_y), point.m_variant);
+  }
+
+ private:
+  // Return the Sweep point of sweep that belongs to working set size x.
+  static Sweep<3>::Point const* find(Sweep<3> const& sweep, double x);
+};
+
+} // namespace benchmark
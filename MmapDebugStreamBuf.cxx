@@ -0,0 +1,216 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief This file contains the definitions of class MmapDebugStreamBuf.
+ */
+
+#include "sys.h"
+
+#ifdef CWDEBUG
+
+#include "MmapDebugStreamBuf.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+NAMESPACE_DEBUG_START
+
+MmapDebugStreamBuf::MmapDebugStreamBuf(std::string const& filename, size_t capacity)
+{
+  // A multiple of the alignment, so that the header of a record never wraps around; with room for at least one record.
+  uint64_t const alignment = MmapDebugLogRecord::alignment;
+  m_capacity = std::max<uint64_t>((capacity + alignment - 1) / alignment * alignment, MmapDebugLogRecord::size(1));
+  m_mapping_size = MmapDebugLogHeader::size + m_capacity;
+  m_fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (m_fd == -1)
+    throw std::system_error(errno, std::generic_category(), "open(\"" + filename + "\")");
+  if (::ftruncate(m_fd, m_mapping_size) == -1)
+  {
+    int error = errno;
+    ::close(m_fd);
+    throw std::system_error(error, std::generic_category(), "ftruncate()");
+  }
+  void* mapping = ::mmap(nullptr, m_mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+  if (mapping == MAP_FAILED)
+  {
+    int error = errno;
+    ::close(m_fd);
+    throw std::system_error(error, std::generic_category(), "mmap()");
+  }
+  m_mapping = static_cast<char*>(mapping);
+  m_header = new (m_mapping) MmapDebugLogHeader;
+  std::memcpy(m_header->m_magic, MmapDebugLogHeader::magic_value, sizeof(m_header->m_magic));
+  m_header->m_version = MmapDebugLogHeader::current_version;
+  m_header->m_padding = 0;
+  m_header->m_capacity = m_capacity;
+  m_header->m_written.store(0, std::memory_order_release);
+  m_data = m_mapping + MmapDebugLogHeader::size;
+  setp(nullptr, nullptr);       // Make every write go through xsputn or overflow.
+}
+
+MmapDebugStreamBuf::~MmapDebugStreamBuf()
+{
+  ::munmap(m_mapping, m_mapping_size);
+  ::close(m_fd);
+}
+
+std::streamsize MmapDebugStreamBuf::xsputn(char const* s, std::streamsize n)
+{
+  // Only keep the last bytes that fit in a single record.
+  uint64_t const max_length = m_capacity - sizeof(MmapDebugLogRecord);
+  uint64_t const skip = static_cast<uint64_t>(n) > max_length ? n - max_length : 0;
+  size_t const len = n - skip;
+  // Reserve space; this makes concurrent writes by different threads safe.
+  uint64_t const start = m_header->m_written.fetch_add(MmapDebugLogRecord::size(len), std::memory_order_relaxed);
+  size_t const offset = start % m_capacity;
+  MmapDebugLogRecord* record = reinterpret_cast<MmapDebugLogRecord*>(m_data + offset);
+  record->m_length = len;
+  size_t const payload = (offset + sizeof(MmapDebugLogRecord)) % m_capacity;
+  size_t const first = std::min<size_t>(len, m_capacity - payload);
+  std::memcpy(m_data + payload, s + skip, first);
+  std::memcpy(m_data, s + skip + first, len - first);
+  // Mark the record as complete. Other threads don't wait for this: the reader skips incomplete records.
+  record->m_stamp.store(start + 1, std::memory_order_release);
+  return n;
+}
+
+MmapDebugStreamBuf::int_type MmapDebugStreamBuf::overflow(int_type c)
+{
+  if (c != traits_type::eof())
+  {
+    char ch = traits_type::to_char_type(c);
+    xsputn(&ch, 1);
+  }
+  return traits_type::not_eof(c);
+}
+
+//static
+void MmapDebugStreamBuf::read_tail(std::string const& filename, std::ostream& os)
+{
+  int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1)
+    throw std::system_error(errno, std::generic_category(), "open(\"" + filename + "\")");
+  struct stat st;
+  if (::fstat(fd, &st) == -1 || static_cast<size_t>(st.st_size) < MmapDebugLogHeader::size)
+  {
+    ::close(fd);
+    throw std::runtime_error("\"" + filename + "\" is not a debug log file");
+  }
+  void* mapping = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  int error = errno;
+  ::close(fd);
+  if (mapping == MAP_FAILED)
+    throw std::system_error(error, std::generic_category(), "mmap()");
+  struct Unmap { void* m_mapping; size_t m_size; ~Unmap() { ::munmap(m_mapping, m_size); } } unmap{mapping, static_cast<size_t>(st.st_size)};
+
+  MmapDebugLogHeader const* header = static_cast<MmapDebugLogHeader const*>(mapping);
+  if (std::memcmp(header->m_magic, MmapDebugLogHeader::magic_value, sizeof(header->m_magic)) != 0 ||
+      header->m_version != MmapDebugLogHeader::current_version ||
+      header->m_capacity != st.st_size - MmapDebugLogHeader::size)
+    throw std::runtime_error("\"" + filename + "\" is not a debug log file");
+
+  char const* data = static_cast<char const*>(mapping) + MmapDebugLogHeader::size;
+  uint64_t const capacity = header->m_capacity;
+  if (capacity % MmapDebugLogRecord::alignment != 0 || capacity < MmapDebugLogRecord::size(1))
+    throw std::runtime_error("\"" + filename + "\" is not a debug log file");
+  uint64_t const written = header->m_written.load(std::memory_order_acquire);
+  // The oldest record that might not have been overwritten yet.
+  uint64_t const begin = written > capacity ? written - capacity : 0;
+  std::string tail;
+  uint64_t pos = begin;
+  while (pos < written)
+  {
+    size_t const offset = pos % capacity;
+    MmapDebugLogRecord const* record = reinterpret_cast<MmapDebugLogRecord const*>(data + offset);
+    // Skip slots that don't start with the header of a complete record: the record is still being written
+    // (or the writer died), or the slot is part of a payload. Then try the next slot.
+    if (record->m_stamp.load(std::memory_order_acquire) != pos + 1 || record->m_length > written - pos - sizeof(MmapDebugLogRecord))
+    {
+      pos += MmapDebugLogRecord::alignment;
+      continue;
+    }
+    size_t const len = record->m_length;
+    size_t const payload = (offset + sizeof(MmapDebugLogRecord)) % capacity;
+    size_t const first = std::min<size_t>(len, capacity - payload);
+    size_t const size = tail.size();
+    tail.append(data + payload, first);
+    tail.append(data, len - first);
+    // The process might still be writing: drop the record if its space was reserved again while we copied it.
+    if (header->m_written.load(std::memory_order_acquire) > pos + capacity)
+      tail.resize(size);
+    pos += MmapDebugLogRecord::size(len);
+  }
+  // Skip the partially overwritten first line.
+  if (begin > 0)
+  {
+    size_t const newline = tail.find('\n');
+    if (newline != std::string::npos)
+      tail.erase(0, newline + 1);
+  }
+  os << tail;
+}
+
+namespace {
+
+// A file that is (or was) used by start_mmap_output().
+struct MmapOutput
+{
+  std::string m_filename;
+  std::unique_ptr<MmapDebugStreamBuf> m_buf;
+  std::unique_ptr<std::ostream> m_ostream;
+};
+
+std::mutex s_mmap_mutex;
+std::ostream* s_original_ostream;
+// Never erased, because other threads might still be writing to them (see MmapDebugStreamBuf.h).
+std::vector<MmapOutput> s_mmap_outputs;
+MmapOutput* s_active_output;
+
+} // namespace
+
+void start_mmap_output(std::string const& filename, size_t capacity)
+{
+  std::lock_guard<std::mutex> lock(s_mmap_mutex);
+  if (s_active_output)
+    return;
+  auto output = std::find_if(s_mmap_outputs.begin(), s_mmap_outputs.end(), [&](MmapOutput const& output){ return output.m_filename == filename; });
+  if (output == s_mmap_outputs.end())
+  {
+    // Reopening the file would truncate it while it is still mapped.
+    auto buf = std::make_unique<MmapDebugStreamBuf>(filename, capacity);
+    auto ostream = std::make_unique<std::ostream>(buf.get());
+    s_mmap_outputs.push_back({filename, std::move(buf), std::move(ostream)});
+    output = s_mmap_outputs.end() - 1;
+  }
+  s_active_output = &*output;
+  s_original_ostream = libcwd::libcw_do.get_ostream();
+  libcwd::libcw_do.set_ostream(s_active_output->m_ostream.get());
+}
+
+void stop_mmap_output()
+{
+  std::lock_guard<std::mutex> lock(s_mmap_mutex);
+  if (!s_active_output)
+    return;
+  libcwd::libcw_do.set_ostream(s_original_ostream);
+  s_active_output = nullptr;
+}
+
+NAMESPACE_DEBUG_END
+
+#endif // CWDEBUG
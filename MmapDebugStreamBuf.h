@@ -0,0 +1,112 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief This file contains the declaration of class MmapDebugStreamBuf.
+ */
+
+#pragma once
+
+#ifdef CWDEBUG
+
+#include "debug.h"
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <streambuf>
+#include <string>
+
+// Usage:
+//
+//   Debug(NAMESPACE_DEBUG::init());
+//   Debug(NAMESPACE_DEBUG::start_mmap_output("/tmp/myapp.dlog", 16 << 20));
+//   ...
+//   Dout(dc::notice, "Hello");         // Only a memcpy into the mapped file.
+//
+// While mmap output is active the ostream of libcw_do is replaced by one that
+// writes into a file that is mapped into memory, used as a circular buffer.
+// Writing is a memcpy, without system calls or waiting for other threads: every
+// write is a record with a header that is stored last, so that debug_log_reader
+// can skip records that were not completely written. Because the mapping is shared,
+// the most recent debug output (the last `size` bytes, including the headers)
+// ends up in the file even when the process crashes or is killed with SIGKILL.
+// Use debug_log_reader to print it in order.
+//
+// To combine this with start_async_output(), call start_mmap_output() first.
+//
+// stop_mmap_output() doesn't unmap the file: a thread that was in the middle of
+// a Dout might still be writing to it. Calling start_mmap_output() again for the
+// same file continues to write to the same circular buffer (the capacity of
+// the first call is used).
+
+NAMESPACE_DEBUG_START
+
+// The first page of the file.
+struct MmapDebugLogHeader
+{
+  static constexpr char magic_value[8] = { 'C', 'W', 'D', 'S', 'D', 'L', 'O', 'G' };
+  static constexpr uint32_t current_version = 3;
+  static constexpr size_t size = 4096;          // The size of the header in the file; the data follows.
+
+  char m_magic[8];                      // magic_value.
+  uint32_t m_version;                   // current_version.
+  uint32_t m_padding;
+  uint64_t m_capacity;                  // The size of the circular buffer, following the header; a multiple of MmapDebugLogRecord::alignment.
+  std::atomic<uint64_t> m_written;      // The total number of bytes reserved so far (the position in the stream of records).
+};
+
+// The header of a record in the circular buffer; the payload follows (and might wrap around).
+struct MmapDebugLogRecord
+{
+  static constexpr size_t alignment = 16;       // Records start at a multiple of this position in the stream.
+
+  std::atomic<uint64_t> m_stamp;        // The position of the record in the stream plus one; stored last (release).
+  uint64_t m_length;                    // The size of the payload.
+
+  // The number of bytes that a record with a payload of length bytes occupies.
+  static constexpr uint64_t size(uint64_t length) { return sizeof(MmapDebugLogRecord) + (length + alignment - 1) / alignment * alignment; }
+};
+static_assert(sizeof(MmapDebugLogRecord) == MmapDebugLogRecord::alignment);
+
+// A streambuf that writes to a memory mapped file.
+class MmapDebugStreamBuf : public std::streambuf
+{
+ private:
+  int m_fd;
+  char* m_mapping;                      // The start of the mapped file.
+  size_t m_mapping_size;                // The size of the mapped file.
+  MmapDebugLogHeader* m_header;         // Points to the start of m_mapping.
+  char* m_data;                         // The circular buffer, following the header.
+  uint64_t m_capacity;                  // Copy of m_header->m_capacity.
+
+ public:
+  // Create (or truncate) filename with a circular buffer of capacity bytes and map it into memory.
+  // Throws std::system_error if that fails.
+  MmapDebugStreamBuf(std::string const& filename, size_t capacity);
+  ~MmapDebugStreamBuf();
+
+  MmapDebugStreamBuf(MmapDebugStreamBuf const&) = delete;
+  MmapDebugStreamBuf& operator=(MmapDebugStreamBuf const&) = delete;
+
+  // Write the complete records in the circular buffer of filename, from old to new, to os.
+  // The first line is skipped when it was partially overwritten.
+  // Throws std::runtime_error if filename isn't a debug log file.
+  static void read_tail(std::string const& filename, std::ostream& os);
+
+ protected:
+  std::streamsize xsputn(char const* s, std::streamsize n) override;
+  int_type overflow(int_type c = traits_type::eof()) override;
+  int sync() override { return 0; }
+};
+
+// Redirect the ostream of libcw_do to a MmapDebugStreamBuf.
+void start_mmap_output(std::string const& filename, size_t capacity);   // The default capacity (8 MiB) is given in debug.h.
+// Restore the original ostream of libcw_do. The file remains mapped (see above).
+void stop_mmap_output();
+
+NAMESPACE_DEBUG_END
+
+#endif // CWDEBUG
@@ -0,0 +1,213 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief This file contains the definitions of class PerfEventGroup.
+ */
+
+#include "sys.h"
+#include "PerfEventGroup.h"
+#include "CpuTopology.h"
+#include "debug.h"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace benchmark {
+
+namespace {
+
+// The layout of the buffer returned by read(2) for PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING.
+struct ReadFormat
+{
+  uint64_t nr;
+  uint64_t time_enabled;
+  uint64_t time_running;
+  uint64_t values[number_of_perf_counters];
+};
+
+int perf_event_open(perf_event_attr* attr, int group_fd)
+{
+  // Measure the calling thread (pid = 0) on whatever CPU it runs (cpu = -1).
+  return syscall(SYS_perf_event_open, attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC);
+}
+
+// Fill attr for counter. Returns false if the event doesn't exist on this CPU.
+bool init_attr(perf_event_attr& attr, perf_counter_nt counter)
+{
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  switch (counter)
+  {
+    case perf_cycles:
+      attr.config = PERF_COUNT_HW_CPU_CYCLES;
+      attr.disabled = 1;        // The group leader starts disabled, so that all counters start at the same time.
+      break;
+    case perf_instructions:
+      attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+      break;
+    case perf_l1d_misses:
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      break;
+    case perf_llc_misses:
+      attr.config = PERF_COUNT_HW_CACHE_MISSES;
+      break;
+    case perf_branch_misses:
+      attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+      break;
+    case perf_uops:
+      // There is no generic event for uops; use UOPS_ISSUED.ANY (event 0x0E, umask 0x01) on Intel.
+      if (CpuTopology::instance().vendor_id() != "GenuineIntel")
+        return false;
+      attr.type = PERF_TYPE_RAW;
+      attr.config = 0x010e;
+      break;
+    case number_of_perf_counters:
+      return false;
+  }
+  return true;
+}
+
+} // namespace
+
+char const* perf_counter_name(perf_counter_nt counter)
+{
+  switch (counter)
+  {
+    case perf_cycles:
+      return "cycles";
+    case perf_instructions:
+      return "instructions";
+    case perf_l1d_misses:
+      return "L1D misses";
+    case perf_llc_misses:
+      return "LLC misses";
+    case perf_branch_misses:
+      return "branch misses";
+    case perf_uops:
+      return "uops";
+    case number_of_perf_counters:
+      break;
+  }
+  AI_NEVER_REACHED
+}
+
+PerfEventGroup::PerfEventGroup() : m_number_of_events(0), m_start{}, m_stop{}, m_minimum{}, m_sum{}, m_overhead{}, m_samples(0), m_multiplexed(false)
+{
+  DoutEntering(dc::notice, "PerfEventGroup::PerfEventGroup() [" << this << "]");
+  m_fd.fill(-1);
+  m_index.fill(-1);
+  for (int i = 0; i < number_of_perf_counters; ++i)
+  {
+    perf_counter_nt counter = static_cast<perf_counter_nt>(i);
+    perf_event_attr attr;
+    if (!init_attr(attr, counter))
+      continue;
+    int fd = perf_event_open(&attr, counter == perf_cycles ? -1 : m_fd[perf_cycles]);
+    if (fd == -1)
+    {
+      if (counter == perf_cycles)
+        throw std::system_error(errno, std::generic_category(), "perf_event_open()");
+      Dout(dc::warning, "Could not open perf event " << perf_counter_name(counter) << ": " << std::strerror(errno));
+      continue;
+    }
+    m_fd[counter] = fd;
+    m_index[counter] = m_number_of_events++;
+  }
+  char const* failed = nullptr;
+  if (ioctl(m_fd[perf_cycles], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP) == -1)
+    failed = "ioctl(PERF_EVENT_IOC_RESET)";
+  else if (ioctl(m_fd[perf_cycles], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) == -1)
+    failed = "ioctl(PERF_EVENT_IOC_ENABLE)";
+  if (failed)
+  {
+    // The destructor won't be called.
+    int const error = errno;
+    close_events();
+    throw std::system_error(error, std::generic_category(), failed);
+  }
+}
+
+PerfEventGroup::~PerfEventGroup()
+{
+  close_events();
+}
+
+void PerfEventGroup::close_events()
+{
+  // Close the group leader last.
+  for (int i = number_of_perf_counters - 1; i >= 0; --i)
+    if (m_fd[i] != -1)
+      close(m_fd[i]);
+}
+
+void PerfEventGroup::read(values_type& values)
+{
+  ReadFormat buf;
+  ssize_t len = ::read(m_fd[perf_cycles], &buf, sizeof(buf));
+  if (len == -1) [[unlikely]]
+    throw std::system_error(errno, std::generic_category(), "read(perf event group)");
+  // Don't use buf unless it contains the values of all events that we opened.
+  if (len < static_cast<ssize_t>((3 + m_number_of_events) * sizeof(uint64_t)) || buf.nr != static_cast<uint64_t>(m_number_of_events)) [[unlikely]]
+    throw std::runtime_error("read(perf event group): returned " + std::to_string(len) + " bytes for " +
+        (len >= static_cast<ssize_t>(sizeof(uint64_t)) ? std::to_string(buf.nr) : std::string("?")) + " events, expected " + std::to_string(m_number_of_events) + " events.");
+  if (buf.time_running < buf.time_enabled) [[unlikely]]
+    m_multiplexed = true;
+  for (int i = 0; i < number_of_perf_counters; ++i)
+    values[i] = m_index[i] == -1 ? 0 : buf.values[m_index[i]];
+}
+
+void PerfEventGroup::reset()
+{
+  m_sum.fill(0);
+  m_samples = 0;
+  m_multiplexed = false;
+}
+
+PerfCounters PerfEventGroup::result(unsigned int iterations) const
+{
+  PerfCounters result;
+  result.m_valid = m_samples > 0;
+  result.m_multiplexed = m_multiplexed;
+  for (int i = 0; i < number_of_perf_counters; ++i)
+  {
+    result.m_available[i] = is_available(static_cast<perf_counter_nt>(i));
+    if (result.m_valid)
+      result.m_per_iteration[i] = static_cast<double>(m_sum[i]) / m_samples / iterations;
+  }
+  Dout(dc::warning(m_multiplexed), "The perf event group was multiplexed: the counters are unreliable.");
+  return result;
+}
+
+void PerfCounters::print_on(std::ostream& os) const
+{
+  if (!m_valid)
+  {
+    os << "{not measured}";
+    return;
+  }
+  os << "{IPC:" << ipc();
+  for (int i = perf_instructions; i < number_of_perf_counters; ++i)
+    if (m_available[i])
+      os << ", " << perf_counter_name(static_cast<perf_counter_nt>(i)) << "/iteration:" << m_per_iteration[i];
+  if (m_multiplexed)
+    os << " (multiplexed)";
+  os << '}';
+}
+
+} // namespace benchmark
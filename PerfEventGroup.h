@@ -0,0 +1,152 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief This file contains the declaration of class PerfEventGroup.
+ */
+
+#pragma once
+
+#include "utils/has_print_on.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+
+// Usage:
+//
+//   benchmark::Stopwatch stopwatch(cpu);
+//   stopwatch.enable_perf_counters();     // Throws std::system_error if perf_event_open(2) isn't allowed.
+//   stopwatch.calibrate_overhead(loopsize, minimum_of);
+//   auto result = stopwatch.measure<nk>(loopsize, functor, minimum_of);
+//   std::cout << result.m_perf << std::endl;   // IPC and misses per iteration.
+//
+// The counters only count user space events of the calling thread (exclude_kernel),
+// so that /proc/sys/kernel/perf_event_paranoid may be as high as 2.
+//
+// Because the counters are read just outside the timed region, they also count the
+// instructions of Stopwatch::start() and stop() (rdtsc and fences) and the user space
+// part of reading the counters. enable_perf_counters() measures those counts for an
+// empty region and they are subtracted from every measurement (see set_overhead).
+// Like the cycle count, the counts still include the loop around the functor.
+
+namespace benchmark {
+using utils::has_print_on::operator<<;
+
+// The events that PerfEventGroup tries to open.
+enum perf_counter_nt
+{
+  perf_cycles,                  // Core clock cycles (not TSC ticks); this is the group leader.
+  perf_instructions,            // Instructions retired.
+  perf_l1d_misses,              // L1 data cache read misses.
+  perf_llc_misses,              // Last level cache misses.
+  perf_branch_misses,           // Mispredicted branches.
+  perf_uops,                    // Micro-operations issued (only available on Intel).
+  number_of_perf_counters
+};
+
+char const* perf_counter_name(perf_counter_nt counter);
+
+// The per iteration averages of the counters, as returned by Stopwatch::measure().
+struct PerfCounters
+{
+  bool m_valid = false;                                         // Set when the counters were enabled and read at least once.
+  bool m_multiplexed = false;                                   // Set when the group wasn't on the CPU all the time (the values are too low).
+  std::array<bool, number_of_perf_counters> m_available{};      // Whether or not the corresponding event could be opened.
+  std::array<double, number_of_perf_counters> m_per_iteration{}; // The average count per call to the functor.
+
+  // Instructions per (core) clock cycle, or zero if not available.
+  double ipc() const
+  {
+    return m_available[perf_cycles] && m_available[perf_instructions] && m_per_iteration[perf_cycles] > 0.0 ?
+        m_per_iteration[perf_instructions] / m_per_iteration[perf_cycles] : 0.0;
+  }
+
+  double per_iteration(perf_counter_nt counter) const { return m_per_iteration[counter]; }
+
+  void print_on(std::ostream& os) const;
+};
+
+// A group of hardware performance counters of the calling thread, read with a single read(2).
+//
+// The group is opened when constructed and counts continuously; a measurement is
+// the difference between two calls to read(). Events that the hardware or the
+// kernel don't support are skipped, but the group leader (cycles) must succeed.
+class PerfEventGroup
+{
+ public:
+  using values_type = std::array<uint64_t, number_of_perf_counters>;
+
+ private:
+  std::array<int, number_of_perf_counters> m_fd;        // The file descriptor of each event, or -1 if not available.
+  std::array<int, number_of_perf_counters> m_index;     // The index of each event in the read(2) buffer, or -1.
+  int m_number_of_events;                               // The number of successfully opened events.
+
+  values_type m_start;                                  // The values read by start().
+  values_type m_stop;                                   // The values read by stop().
+  values_type m_minimum;                                // The difference belonging to the smallest cycle count so far.
+  values_type m_sum;                                    // The sum of all m_minimum's added with add_minimum().
+  values_type m_overhead;                               // The counts of an empty measurement, subtracted by keep().
+  unsigned int m_samples;                               // The number of times add_minimum() was called since reset().
+  bool m_multiplexed;                                   // Set when read() detected that the group was multiplexed.
+
+ public:
+  // Throws std::system_error when the group leader can't be opened or enabled.
+  PerfEventGroup();
+  ~PerfEventGroup();
+
+  PerfEventGroup(PerfEventGroup const&) = delete;
+  PerfEventGroup& operator=(PerfEventGroup const&) = delete;
+
+ private:
+  void close_events();
+
+ public:
+
+  bool is_available(perf_counter_nt counter) const { return m_fd[counter] != -1; }
+
+  // Read the current value of all counters.
+  // Throws std::system_error if read(2) fails, or std::runtime_error if it doesn't return all counters.
+  void read(values_type& values);
+
+  // Called around the measured region by Stopwatch::get_minimum_of.
+  void start() { read(m_start); }
+  void stop() { read(m_stop); }
+  // Return the counts of the last measurement, without correction.
+  values_type last() const
+  {
+    values_type counts;
+    for (int i = 0; i < number_of_perf_counters; ++i)
+      counts[i] = m_stop[i] - m_start[i];
+    return counts;
+  }
+  // Remember the last measurement as the one with the smallest number of clock cycles.
+  void keep()
+  {
+    for (int i = 0; i < number_of_perf_counters; ++i)
+    {
+      uint64_t const count = m_stop[i] - m_start[i];
+      m_minimum[i] = count - std::min(count, m_overhead[i]);
+    }
+  }
+  void add_minimum()
+  {
+    for (int i = 0; i < number_of_perf_counters; ++i)
+      m_sum[i] += m_minimum[i];
+    ++m_samples;
+  }
+
+  // Forget all samples added with add_minimum().
+  void reset();
+
+  // Set the counts of an empty measurement, to be subtracted from each measurement.
+  void set_overhead(values_type const& overhead) { m_overhead = overhead; }
+
+  // Return the average of the samples, divided by iterations.
+  PerfCounters result(unsigned int iterations) const;
+};
+
+} // namespace benchmark
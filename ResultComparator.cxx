@@ -0,0 +1,414 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief This file contains the definitions of class ResultComparator.
+ */
+
+#include "sys.h"
+#include "ResultComparator.h"
+#include "debug.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace benchmark {
+
+namespace {
+
+// Minimal parser for the JSON objects that ResultSink writes.
+// Nested objects are flattened: {"histogram":{"12":3}} results in the key "histogram.12" with value "3".
+class JsonLineParser
+{
+ private:
+  std::string const& m_line;
+  size_t m_pos;
+
+ public:
+  JsonLineParser(std::string const& line) : m_line(line), m_pos(0) { }
+
+  std::map<std::string, std::string> parse()
+  {
+    std::map<std::string, std::string> values;
+    parse_object("", values);
+    skip_space();
+    if (m_pos != m_line.size())
+      error("trailing characters");
+    return values;
+  }
+
+ private:
+  [[noreturn]] void error(char const* what) const
+  {
+    throw std::runtime_error(std::string("JSON parse error (") + what + ") at column " + std::to_string(m_pos + 1));
+  }
+
+  void skip_space()
+  {
+    while (m_pos < m_line.size() && std::isspace(static_cast<unsigned char>(m_line[m_pos])))
+      ++m_pos;
+  }
+
+  void expect(char c)
+  {
+    skip_space();
+    if (m_pos >= m_line.size() || m_line[m_pos] != c)
+      error("unexpected character");
+    ++m_pos;
+  }
+
+  std::string parse_string()
+  {
+    expect('"');
+    std::string str;
+    while (m_pos < m_line.size() && m_line[m_pos] != '"')
+    {
+      char c = m_line[m_pos++];
+      if (c == '\\' && m_pos < m_line.size())
+      {
+        c = m_line[m_pos++];
+        switch (c)
+        {
+          case 'n':
+            c = '\n';
+            break;
+          case 't':
+            c = '\t';
+            break;
+          case 'u':
+            if (m_pos + 4 > m_line.size())
+              error("truncated \\u escape");
+            c = static_cast<char>(std::stoi(m_line.substr(m_pos, 4), nullptr, 16));
+            m_pos += 4;
+            break;
+        }
+      }
+      str += c;
+    }
+    expect('"');
+    return str;
+  }
+
+  void parse_object(std::string const& prefix, std::map<std::string, std::string>& values)
+  {
+    expect('{');
+    skip_space();
+    if (m_pos < m_line.size() && m_line[m_pos] == '}')
+    {
+      ++m_pos;
+      return;
+    }
+    for (;;)
+    {
+      std::string key = prefix + parse_string();
+      expect(':');
+      skip_space();
+      if (m_pos >= m_line.size())
+        error("missing value");
+      if (m_line[m_pos] == '{')
+        parse_object(key + '.', values);
+      else if (m_line[m_pos] == '"')
+        values[key] = parse_string();
+      else
+      {
+        size_t end = m_line.find_first_of(",}", m_pos);
+        if (end == std::string::npos)
+          error("unterminated value");
+        values[key] = m_line.substr(m_pos, m_line.find_last_not_of(" \t", end - 1) + 1 - m_pos);
+        m_pos = end;
+      }
+      skip_space();
+      if (m_pos < m_line.size() && m_line[m_pos] == ',')
+      {
+        ++m_pos;
+        continue;
+      }
+      expect('}');
+      return;
+    }
+  }
+};
+
+// Split a CSV line into fields.
+std::vector<std::string> split_csv(std::string const& line)
+{
+  std::vector<std::string> fields(1);
+  bool quoted = false;
+  for (size_t i = 0; i < line.size(); ++i)
+  {
+    char c = line[i];
+    if (quoted)
+    {
+      if (c == '"' && i + 1 < line.size() && line[i + 1] == '"')
+        fields.back() += line[++i];
+      else if (c == '"')
+        quoted = false;
+      else
+        fields.back() += c;
+    }
+    else if (c == '"')
+      quoted = true;
+    else if (c == ',')
+      fields.emplace_back();
+    else
+      fields.back() += c;
+  }
+  return fields;
+}
+
+eda::FrequencyCounterResult::type_nt parse_type(std::string const& type)
+{
+  if (type == "t999")
+    return eda::FrequencyCounterResult::t999;
+  if (type == "tm1")
+    return eda::FrequencyCounterResult::tm1;
+  if (type == "tm2")
+    return eda::FrequencyCounterResult::tm2;
+  throw std::runtime_error("unknown result type \"" + type + "\"");
+}
+
+std::string const& get(std::map<std::string, std::string> const& values, std::string const& key)
+{
+  auto iter = values.find(key);
+  if (iter == values.end())
+    throw std::runtime_error("missing field \"" + key + "\"");
+  return iter->second;
+}
+
+StoredResult to_result(std::map<std::string, std::string> const& values)
+{
+  StoredResult result;
+  result.m_name = get(values, "name");
+  result.m_cycles = std::stoi(get(values, "cycles"));
+  result.m_type = parse_type(get(values, "type"));
+  result.m_iterations = std::stoul(get(values, "iterations"));
+  auto iter = values.find("cpu_model");
+  if (iter != values.end())
+    result.m_cpu_model = iter->second;
+  iter = values.find("tsc_frequency");
+  result.m_tsc_frequency = iter != values.end() ? std::stod(iter->second) : 0.0;
+  return result;
+}
+
+} // namespace
+
+//static
+void ResultComparator::load(std::string const& filename, std::vector<StoredResult>& results)
+{
+  DoutEntering(dc::notice, "ResultComparator::load(\"" << filename << "\")");
+  std::ifstream file(filename);
+  if (!file)
+    throw std::runtime_error("Could not open \"" + filename + "\"");
+  bool const is_csv = filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".csv") == 0;
+  std::vector<std::string> header;
+  std::string header_line;
+  std::string line;
+  int line_nr = 0;
+  while (std::getline(file, line))
+  {
+    ++line_nr;
+    if (line.empty())
+      continue;
+    try
+    {
+      if (is_csv)
+      {
+        // The first line is the header. ResultSink writes it at the start of every new file,
+        // so it is repeated when files are concatenated; a benchmark may be called "name" though.
+        if (header.empty() || line == header_line)
+        {
+          header = split_csv(line);
+          header_line = line;
+          continue;
+        }
+        std::vector<std::string> fields = split_csv(line);
+        std::map<std::string, std::string> values;
+        for (size_t i = 0; i < fields.size() && i < header.size(); ++i)
+          values[header[i]] = fields[i];
+        StoredResult result = to_result(values);
+        std::istringstream histogram(get(values, "histogram"));
+        std::string entry;
+        while (histogram >> entry)
+        {
+          auto colon = entry.find(':');
+          if (colon == std::string::npos)
+            throw std::runtime_error("malformed histogram entry \"" + entry + "\"");
+          result.m_histogram[std::stoi(entry.substr(0, colon))] = std::stoul(entry.substr(colon + 1));
+        }
+        results.push_back(std::move(result));
+      }
+      else
+      {
+        std::map<std::string, std::string> values = JsonLineParser(line).parse();
+        StoredResult result = to_result(values);
+        std::string const prefix = "histogram.";
+        for (auto iter = values.lower_bound(prefix); iter != values.end() && iter->first.compare(0, prefix.size(), prefix) == 0; ++iter)
+          result.m_histogram[std::stoi(iter->first.substr(prefix.size()))] = std::stoul(iter->second);
+        results.push_back(std::move(result));
+      }
+    }
+    catch (std::exception const& error)
+    {
+      throw std::runtime_error(filename + ":" + std::to_string(line_nr) + ": " + error.what());
+    }
+  }
+}
+
+//static
+double ResultComparator::chi_square(StoredResult const& baseline, StoredResult const& candidate)
+{
+  // Classify all samples as being at most, or above, the midpoint between the two results.
+  double const midpoint = 0.5 * (baseline.cycles_per_iteration() + candidate.cycles_per_iteration());
+  double table[2][2] = {};
+  StoredResult const* results[2] = { &baseline, &candidate };
+  for (int r = 0; r < 2; ++r)
+  {
+    double const iterations = std::max(results[r]->m_iterations, 1U);
+    for (auto [cycles, count] : results[r]->m_histogram)
+      table[r][cycles / iterations > midpoint] += count;
+  }
+  double const row0 = table[0][0] + table[0][1];
+  double const row1 = table[1][0] + table[1][1];
+  double const col0 = table[0][0] + table[1][0];
+  double const col1 = table[0][1] + table[1][1];
+  double const total = row0 + row1;
+  if (row0 == 0 || row1 == 0 || col0 == 0 || col1 == 0)
+    return 0.0;
+  double const det = table[0][0] * table[1][1] - table[0][1] * table[1][0];
+  return total * det * det / (row0 * row1 * col0 * col1);
+}
+
+Comparison ResultComparator::compare(std::string const& name, StoredResult const* baseline, StoredResult const* candidate) const
+{
+  Comparison comparison{name, baseline, candidate, 0.0, 0.0, Comparison::insignificant};
+  if (!baseline)
+  {
+    comparison.m_verdict = Comparison::missing_baseline;
+    return comparison;
+  }
+  if (!candidate)
+  {
+    comparison.m_verdict = Comparison::missing_candidate;
+    return comparison;
+  }
+  Dout(dc::warning(baseline->m_cpu_model != candidate->m_cpu_model),
+      "Comparing \"" << name << "\" measured on different CPU models (\"" << baseline->m_cpu_model << "\" and \"" << candidate->m_cpu_model << "\").");
+  double const b = baseline->cycles_per_iteration();
+  double const c = candidate->cycles_per_iteration();
+  if (b == c)
+  {
+    comparison.m_verdict = Comparison::unchanged;
+    return comparison;
+  }
+  comparison.m_relative_change = b > 0.0 ? (c - b) / b : 1.0;
+  comparison.m_test_statistic = chi_square(*baseline, *candidate);
+  if (comparison.m_test_statistic > chi_square_threshold && std::abs(comparison.m_relative_change) >= m_threshold)
+  {
+    bool const confident = baseline->m_type == eda::FrequencyCounterResult::t999 && candidate->m_type == eda::FrequencyCounterResult::t999;
+    if (c < b)
+      comparison.m_verdict = confident ? Comparison::faster : Comparison::probably_faster;
+    else
+      comparison.m_verdict = confident ? Comparison::slower : Comparison::probably_slower;
+  }
+  return comparison;
+}
+
+std::vector<Comparison> ResultComparator::compare() const
+{
+  std::map<std::string, std::pair<StoredResult const*, StoredResult const*>> by_name;
+  for (auto&& result : m_baseline)
+    by_name[result.m_name].first = &result;
+  for (auto&& result : m_candidate)
+    by_name[result.m_name].second = &result;
+  std::vector<Comparison> comparisons;
+  for (auto&& [name, results] : by_name)
+    comparisons.push_back(compare(name, results.first, results.second));
+  return comparisons;
+}
+
+//static
+bool ResultComparator::has_regression(std::vector<Comparison> const& comparisons)
+{
+  return std::any_of(comparisons.begin(), comparisons.end(), [](Comparison const& comparison){ return comparison.is_regression(); });
+}
+
+void ResultComparator::print_report(std::ostream& os, std::vector<Comparison> const& comparisons) const
+{
+  size_t width = 4;
+  for (auto&& comparison : comparisons)
+    width = std::max(width, comparison.m_name.size());
+  os << std::left << std::setw(width) << "name" << std::right <<
+    std::setw(14) << "baseline" << std::setw(14) << "candidate" << std::setw(10) << "change" << std::setw(10) << "chi2" << "  verdict\n";
+  for (auto&& comparison : comparisons)
+  {
+    os << std::left << std::setw(width) << comparison.m_name << std::right;
+    if (comparison.m_baseline)
+      os << std::setw(10) << comparison.m_baseline->m_cycles << std::setw(4) << ResultComparator::type_suffix(comparison.m_baseline->m_type);
+    else
+      os << std::setw(14) << "-";
+    if (comparison.m_candidate)
+      os << std::setw(10) << comparison.m_candidate->m_cycles << std::setw(4) << ResultComparator::type_suffix(comparison.m_candidate->m_type);
+    else
+      os << std::setw(14) << "-";
+    std::ostringstream change;
+    change << std::showpos << std::fixed << std::setprecision(1) << (100.0 * comparison.m_relative_change) << '%';
+    std::ostringstream statistic;
+    statistic << std::fixed << std::setprecision(1) << comparison.m_test_statistic;
+    os << std::setw(10) << change.str() << std::setw(10) << statistic.str() << "  " << Comparison::verdict_name(comparison.m_verdict) << '\n';
+  }
+}
+
+//static
+char const* ResultComparator::type_suffix(eda::FrequencyCounterResult::type_nt type)
+{
+  switch (type)
+  {
+    case eda::FrequencyCounterResult::t999:
+      return "";
+    case eda::FrequencyCounterResult::tm1:
+      return " m1";
+    case eda::FrequencyCounterResult::tm2:
+      return " m2";
+  }
+  AI_NEVER_REACHED
+}
+
+//static
+char const* Comparison::verdict_name(verdict_type verdict)
+{
+  switch (verdict)
+  {
+    case unchanged:
+      return "unchanged";
+    case faster:
+      return "faster";
+    case slower:
+      return "SLOWER";
+    case probably_faster:
+      return "probably faster";
+    case probably_slower:
+      return "probably SLOWER";
+    case insignificant:
+      return "insignificant";
+    case missing_baseline:
+      return "new";
+    case missing_candidate:
+      return "removed";
+  }
+  AI_NEVER_REACHED
+}
+
+void Comparison::print_on(std::ostream& os) const
+{
+  os << "{name:\"" << m_name << "\", change:" << (100.0 * m_relative_change) << "%, chi2:" << m_test_statistic <<
+    ", verdict:" << verdict_name(m_verdict) << '}';
+}
+
+} // namespace benchmark
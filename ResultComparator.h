@@ -0,0 +1,120 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief This file contains the declaration of class ResultComparator.
+ */
+
+#pragma once
+
+#include "FrequencyCounter.h"
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+
+// Usage:
+//
+//   benchmark::ResultComparator comparator;
+//   comparator.load_baseline("baseline.jsonl");   // As written by ResultSink.
+//   comparator.load_candidate("candidate.jsonl");
+//   auto comparisons = comparator.compare();
+//   comparator.print_report(std::cout, comparisons);
+//   if (comparator.has_regression(comparisons))
+//     return 1;
+//
+// Or use the benchmark_compare executable:
+//
+//   benchmark_compare [--threshold <percentage>] baseline.jsonl candidate.jsonl
+//
+// Two results of the same benchmark are compared with the histograms of measured minima
+// that ResultSink stores. Each sample is classified as being at most or more than the
+// midpoint between the two reported cycle counts. The resulting 2x2 contingency table
+// is tested with a chi-square test with one degree of freedom. The difference counts as
+// significant if the test statistic exceeds 10.828 (p < 0.001), the same threshold that
+// FrequencyCounter::add uses. A significant difference is downgraded to "probably" when
+// either result was not classified as t999.
+
+namespace benchmark {
+using utils::has_print_on::operator<<;
+
+// A result as read back from a file written by ResultSink.
+struct StoredResult
+{
+  std::string m_name;
+  int m_cycles;
+  eda::FrequencyCounterResult::type_nt m_type;
+  unsigned int m_iterations;
+  std::string m_cpu_model;
+  double m_tsc_frequency;
+  std::map<int, size_t> m_histogram;
+
+  // The number of clock cycles per call to the benchmarked functor.
+  double cycles_per_iteration() const { return m_iterations > 0 ? static_cast<double>(m_cycles) / m_iterations : m_cycles; }
+};
+
+struct Comparison
+{
+  enum verdict_type
+  {
+    unchanged,          // The reported cycles are equal.
+    faster,             // Significantly faster and both results are t999.
+    slower,             // Significantly slower and both results are t999.
+    probably_faster,    // Significantly faster, but at least one of the results is not t999.
+    probably_slower,    // Significantly slower, but at least one of the results is not t999.
+    insignificant,      // The difference is not statistically significant, or smaller than the threshold.
+    missing_baseline,   // The benchmark only exists in the candidate set.
+    missing_candidate   // The benchmark only exists in the baseline set.
+  };
+
+  std::string m_name;
+  StoredResult const* m_baseline;       // Or nullptr.
+  StoredResult const* m_candidate;      // Or nullptr.
+  double m_relative_change;             // (candidate - baseline) / baseline, per iteration.
+  double m_test_statistic;              // The chi-square test statistic, or zero.
+  verdict_type m_verdict;
+
+  bool is_regression() const { return m_verdict == slower || m_verdict == probably_slower; }
+  static char const* verdict_name(verdict_type verdict);
+
+  void print_on(std::ostream& os) const;
+};
+
+class ResultComparator
+{
+ public:
+  static constexpr double chi_square_threshold = 10.828;        // p < 0.001 for one degree of freedom.
+
+ private:
+  std::vector<StoredResult> m_baseline;
+  std::vector<StoredResult> m_candidate;
+  double m_threshold;                   // Relative changes smaller than this are reported as insignificant.
+
+ public:
+  ResultComparator(double threshold = 0.0) : m_threshold(threshold) { }
+
+  // Load a JSON Lines file (or a CSV file if filename ends on ".csv") as written by ResultSink.
+  // Throws std::runtime_error if the file can't be read or parsed.
+  void load_baseline(std::string const& filename) { load(filename, m_baseline); }
+  void load_candidate(std::string const& filename) { load(filename, m_candidate); }
+
+  // Compare every benchmark that occurs in either set. If a name occurs more than once
+  // in the same set, the last result is used.
+  std::vector<Comparison> compare() const;
+
+  // Return the test statistic of the 2x2 chi-square test described above.
+  static double chi_square(StoredResult const& baseline, StoredResult const& candidate);
+
+  void print_report(std::ostream& os, std::vector<Comparison> const& comparisons) const;
+  static bool has_regression(std::vector<Comparison> const& comparisons);
+
+ private:
+  static void load(std::string const& filename, std::vector<StoredResult>& results);
+  static char const* type_suffix(eda::FrequencyCounterResult::type_nt type);
+  Comparison compare(std::string const& name, StoredResult const* baseline, StoredResult const* candidate) const;
+};
+
+} // namespace benchmark
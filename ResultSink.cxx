@@ -0,0 +1,209 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief This file contains the definitions of class ResultSink.
+ */
+
+#include "sys.h"
+#include "ResultSink.h"
+#include "debug.h"
+#include <cerrno>
+#include <filesystem>
+#include <iomanip>
+#include <system_error>
+
+namespace benchmark {
+
+namespace {
+
+// Write str as a JSON string, including the surrounding quotes.
+void write_json_string(std::ostream& os, std::string const& str)
+{
+  os << '"';
+  for (char c : str)
+  {
+    switch (c)
+    {
+      case '"':
+        os << "\\\"";
+        break;
+      case '\\':
+        os << "\\\\";
+        break;
+      case '\n':
+        os << "\\n";
+        break;
+      case '\t':
+        os << "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20)
+          os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec << std::setfill(' ');
+        else
+          os << c;
+    }
+  }
+  os << '"';
+}
+
+// Write str as a CSV field, quoted if necessary.
+void write_csv_string(std::ostream& os, std::string const& str)
+{
+  if (str.find_first_of(",\"\n") == std::string::npos)
+  {
+    os << str;
+    return;
+  }
+  os << '"';
+  for (char c : str)
+  {
+    if (c == '"')
+      os << '"';
+    os << c;
+  }
+  os << '"';
+}
+
+// The JSON key and CSV column name of a perf counter.
+char const* perf_key(int counter)
+{
+  static char const* const keys[number_of_perf_counters] = { "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses", "uops" };
+  return keys[counter];
+}
+
+bool ends_with(std::string const& str, std::string const& suffix)
+{
+  return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+} // namespace
+
+ResultSink::ResultSink(std::string const& filename, format_type format) : m_os(m_file), m_format(format)
+{
+  std::error_code ec;
+  bool is_new = !std::filesystem::exists(filename, ec) || std::filesystem::file_size(filename, ec) == 0;
+  m_file.open(filename, std::ios::app);
+  if (!m_file)
+    throw std::system_error(errno, std::generic_category(), "ResultSink: could not open \"" + filename + "\"");
+  if (is_new)
+    write_header();
+}
+
+ResultSink::ResultSink(std::string const& filename) : ResultSink(filename, ends_with(filename, ".csv") ? csv : jsonl)
+{
+}
+
+ResultSink::ResultSink(std::ostream& os, format_type format) : m_os(os), m_format(format)
+{
+  write_header();
+}
+
+//static
+char const* ResultSink::type_name(eda::FrequencyCounterResult::type_nt type)
+{
+  switch (type)
+  {
+    case eda::FrequencyCounterResult::t999:
+      return "t999";
+    case eda::FrequencyCounterResult::tm1:
+      return "tm1";
+    case eda::FrequencyCounterResult::tm2:
+      return "tm2";
+  }
+  AI_NEVER_REACHED
+}
+
+void ResultSink::write_header()
+{
+  if (m_format != csv)
+    return;
+  m_os << "name,cycles,type,nanoseconds,iterations,minimum_of,nk,stopwatch_overhead,iterations_overhead,cpu,cpu_model,tsc_frequency,histogram,ipc";
+  for (int i = perf_instructions; i < number_of_perf_counters; ++i)
+    m_os << ',' << perf_key(i);
+  m_os << std::endl;
+}
+
+void ResultSink::write(std::string const& name, MeasureResult const& result)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  // m_os might be a stream of the caller: restore its precision afterwards.
+  std::streamsize const precision = m_os.precision(10);
+  if (m_format == jsonl)
+    write_jsonl(name, result);
+  else
+    write_csv(name, result);
+  m_os.precision(precision);
+  m_os.flush();
+}
+
+void ResultSink::write_jsonl(std::string const& name, MeasureResult const& result)
+{
+  m_os << "{\"name\":";
+  write_json_string(m_os, name);
+  m_os << ",\"cycles\":" << result.m_cycles <<
+    ",\"type\":\"" << type_name(result.m_type) << '"';
+  if (result.m_tsc_frequency > 0.0)
+    m_os << ",\"nanoseconds\":" << result.nanoseconds();
+  m_os << ",\"iterations\":" << result.m_iterations <<
+    ",\"minimum_of\":" << result.m_minimum_of <<
+    ",\"nk\":" << result.m_nk <<
+    ",\"stopwatch_overhead\":" << result.m_stopwatch_overhead <<
+    ",\"iterations_overhead\":" << result.m_iterations_overhead <<
+    ",\"cpu\":" << result.m_cpu <<
+    ",\"cpu_model\":";
+  write_json_string(m_os, CpuTopology::instance().model_name());
+  m_os << ",\"tsc_frequency\":" << result.m_tsc_frequency << ",\"histogram\":{";
+  char const* prefix = "";
+  for (auto [cycles, count] : result.m_histogram)
+  {
+    m_os << prefix << '"' << cycles << "\":" << count;
+    prefix = ",";
+  }
+  m_os << '}';
+  if (result.m_perf.m_valid)
+  {
+    m_os << ",\"perf\":{\"ipc\":" << result.m_perf.ipc();
+    for (int i = perf_instructions; i < number_of_perf_counters; ++i)
+      if (result.m_perf.m_available[i])
+        m_os << ",\"" << perf_key(i) << "\":" << result.m_perf.m_per_iteration[i];
+    if (result.m_perf.m_multiplexed)
+      m_os << ",\"multiplexed\":true";
+    m_os << '}';
+  }
+  m_os << "}\n";
+}
+
+void ResultSink::write_csv(std::string const& name, MeasureResult const& result)
+{
+  write_csv_string(m_os, name);
+  m_os << ',' << result.m_cycles << ',' << type_name(result.m_type) << ',';
+  if (result.m_tsc_frequency > 0.0)
+    m_os << result.nanoseconds();
+  m_os << ',' << result.m_iterations << ',' << result.m_minimum_of << ',' << result.m_nk <<
+    ',' << result.m_stopwatch_overhead << ',' << result.m_iterations_overhead << ',' << result.m_cpu << ',';
+  write_csv_string(m_os, CpuTopology::instance().model_name());
+  // The histogram is written as a single field of space separated cycles:count pairs.
+  m_os << ',' << result.m_tsc_frequency << ',';
+  char const* prefix = "";
+  for (auto [cycles, count] : result.m_histogram)
+  {
+    m_os << prefix << cycles << ':' << count;
+    prefix = " ";
+  }
+  m_os << ',';
+  if (result.m_perf.m_valid)
+    m_os << result.m_perf.ipc();
+  for (int i = perf_instructions; i < number_of_perf_counters; ++i)
+  {
+    m_os << ',';
+    if (result.m_perf.m_valid && result.m_perf.m_available[i])
+      m_os << result.m_perf.m_per_iteration[i];
+  }
+  m_os << '\n';
+}
+
+} // namespace benchmark
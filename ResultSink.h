@@ -0,0 +1,68 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief This file contains the declaration of class ResultSink.
+ */
+
+#pragma once
+
+#include "benchmark.h"
+#include <fstream>
+#include <mutex>
+#include <string>
+
+// Usage:
+//
+//   benchmark::ResultSink sink("results.jsonl");         // The format is deduced from the extension.
+//   ...
+//   auto result = stopwatch.measure<nk>(loopsize, functor, minimum_of);
+//   sink.write("lsb", result);
+//
+// Every call to write() appends one line (JSON Lines) or one row (CSV) that
+// contains the measurement together with its context: iterations, minimum_of,
+// nk, the t999/tm1/tm2 classification, the subtracted overheads, the CPU model,
+// the pinned CPU, the TSC frequency, the histogram of measured minima and,
+// if enabled, the hardware performance counters.
+
+namespace benchmark {
+
+class ResultSink
+{
+ public:
+  enum format_type
+  {
+    jsonl,      // One JSON object per line.
+    csv         // Comma separated values, with a header line.
+  };
+
+ private:
+  std::ofstream m_file;                 // Only used when constructed with a filename.
+  std::ostream& m_os;
+  format_type m_format;
+  std::mutex m_mutex;                   // Protects m_os, so that write() may be called from multiple threads.
+
+ public:
+  // Append to filename. If the file is new and format is csv, a header line is written first.
+  // Throws std::system_error if the file can't be opened.
+  ResultSink(std::string const& filename, format_type format);
+  // Same, but use csv if filename ends on ".csv" and jsonl otherwise.
+  ResultSink(std::string const& filename);
+  // Write to an existing stream. The csv header is written immediately.
+  ResultSink(std::ostream& os, format_type format);
+
+  void write(std::string const& name, MeasureResult const& result);
+
+  // Return "t999", "tm1" or "tm2".
+  static char const* type_name(eda::FrequencyCounterResult::type_nt type);
+
+ private:
+  void write_header();
+  void write_jsonl(std::string const& name, MeasureResult const& result);
+  void write_csv(std::string const& name, MeasureResult const& result);
+};
+
+} // namespace benchmark
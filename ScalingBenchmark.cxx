@@ -0,0 +1,122 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief This file contains the definitions of class ScalingBenchmark.
+ */
+
+#include "sys.h"
+#include "ScalingBenchmark.h"
+#include "debug.h"
+#include <iostream>
+#include <sched.h>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+namespace benchmark {
+
+ScalingBenchmark::ScalingBenchmark() : m_calibrated_iterations(0), m_iterations_overhead(0), m_single_thread_throughput(0.0)
+{
+  unsigned int const number_of_cpus = CpuTopology::instance().number_of_cpus();
+  size_t const cpu_set_size = CPU_ALLOC_SIZE(number_of_cpus);
+  cpu_set_t* cpuset = CPU_ALLOC(number_of_cpus);
+  if (sched_getaffinity(0, cpu_set_size, cpuset) == -1)
+  {
+    int err_num = errno;
+    CPU_FREE(cpuset);
+    throw std::system_error(err_num, std::generic_category(), "sched_getaffinity()");
+  }
+  for (unsigned int cpu = 0; cpu < number_of_cpus; ++cpu)
+    if (CPU_ISSET_S(cpu, cpu_set_size, cpuset))
+      m_cpus.push_back(cpu);
+  CPU_FREE(cpuset);
+}
+
+ScalingBenchmark::ScalingBenchmark(std::vector<unsigned int> cpus) :
+  m_cpus(std::move(cpus)), m_calibrated_iterations(0), m_iterations_overhead(0), m_single_thread_throughput(0.0)
+{
+  if (m_cpus.empty())
+    throw std::invalid_argument("ScalingBenchmark: the list of CPUs to run on is empty.");
+}
+
+void ScalingBenchmark::calibrate_overhead(unsigned int iterations, unsigned int minimum_of)
+{
+  // Run the calibration in a separate thread, so that the calling thread doesn't get pinned.
+  std::exception_ptr error;
+  std::thread calibration([&](){
+    try
+    {
+      Stopwatch stopwatch(m_cpus[0]);
+      stopwatch.calibrate_overhead(iterations, minimum_of);
+      m_calibrated_iterations = stopwatch.get_calibrated_iterations();
+      m_iterations_overhead = stopwatch.get_iterations_overhead();
+    }
+    catch (...)
+    {
+      error = std::current_exception();
+    }
+  });
+  calibration.join();
+  if (error)
+    std::rethrow_exception(error);
+}
+
+void ScalingBenchmark::check_measure(unsigned int number_of_threads) const
+{
+  // Without calibration the overhead of the wrong number of iterations would be subtracted.
+  if (m_calibrated_iterations == 0)
+    throw std::logic_error("ScalingBenchmark::measure: call calibrate_overhead() before measuring.");
+  if (number_of_threads == 0 || number_of_threads > m_cpus.size())
+    throw std::out_of_range("ScalingBenchmark::measure: number_of_threads is " + std::to_string(number_of_threads) +
+        ", it must be in the range [1, " + std::to_string(m_cpus.size()) + "].");
+}
+
+void ScalingBenchmark::finish(ScalingResult& result, std::vector<std::exception_ptr> const& errors)
+{
+  for (auto&& error : errors)
+    if (error)
+      std::rethrow_exception(error);
+
+  result.m_throughput = 0.0;
+  for (auto&& cycles : result.m_per_thread)
+    if (cycles.m_cycles > 0)
+      result.m_throughput += static_cast<double>(result.m_iterations) / cycles.m_cycles;
+
+  if (result.m_number_of_threads == 1)
+    m_single_thread_throughput = result.m_throughput;
+  result.m_efficiency = m_single_thread_throughput > 0.0 ?
+      result.m_throughput / (result.m_number_of_threads * m_single_thread_throughput) : 0.0;
+
+  Dout(dc::notice, "Measured " << result);
+}
+
+//static
+std::vector<unsigned int> ScalingBenchmark::thread_counts(unsigned int max)
+{
+  std::vector<unsigned int> counts;
+  for (unsigned int n = 1; n < max; n *= 2)
+    counts.push_back(n);
+  counts.push_back(max);
+  return counts;
+}
+
+void ScalingResult::print_on(std::ostream& os) const
+{
+  os << "{threads:" << m_number_of_threads << ", cycles per thread:{";
+  char const* prefix = "";
+  for (unsigned int t = 0; t < m_number_of_threads; ++t)
+  {
+    os << prefix << "CPU " << m_cpus[t] << ": " << m_per_thread[t].m_cycles;
+    prefix = ", ";
+  }
+  os << "}, throughput:" << m_throughput << " calls/cycle";
+  if (m_efficiency > 0.0)
+    os << ", efficiency:" << (100.0 * m_efficiency) << '%';
+  os << '}';
+}
+
+} // namespace benchmark
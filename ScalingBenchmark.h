@@ -0,0 +1,177 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief This file contains the declaration of class ScalingBenchmark.
+ */
+
+#pragma once
+
+#include "benchmark.h"
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+#include <iosfwd>
+
+// Usage example
+//
+// ScalingBenchmark runs the same functor on N threads at once, each thread pinned
+// to its own CPU with a Stopwatch, and reports the number of clock cycles that
+// each thread needed, the aggregated throughput and the scaling efficiency
+// relative to the single threaded throughput.
+//
+#ifdef EXAMPLE_CODE        // Undefined
+
+#include "sys.h"
+#include "debug.h"
+#include "cwds/ScalingBenchmark.h"
+
+int main()
+{
+  Debug(NAMESPACE_DEBUG::init());
+
+  benchmark::ScalingBenchmark scaling;          // Use all CPUs that this process may run on.
+  scaling.calibrate_overhead(1000, 3);
+
+  SomeLockFreeQueue queue;
+  auto results = scaling.measure_scaling<3>(1000, [&queue](){ queue.push(1); queue.pop(); }, 3);
+  for (auto&& result : results)
+    std::cout << result << std::endl;
+}
+
+#endif // EXAMPLE_CODE
+
+namespace benchmark {
+using utils::has_print_on::operator<<;
+
+// The result of running the same functor on a number of threads at once.
+struct ScalingResult
+{
+  unsigned int m_number_of_threads;                             // The number of threads that ran functor() concurrently.
+  unsigned int m_iterations;                                    // The number of times functor() is called per measurement.
+  std::vector<unsigned int> m_cpus;                             // The CPU that each thread was pinned to.
+  std::vector<eda::FrequencyCounterResult> m_per_thread;        // The measured number of clock cycles, per thread.
+  double m_throughput;                                          // The aggregated number of calls to functor() per clock cycle.
+  double m_efficiency;                                          // m_throughput / (m_number_of_threads * single threaded throughput), or zero if unknown.
+
+  void print_on(std::ostream& os) const;
+};
+
+class ScalingBenchmark
+{
+ private:
+  std::vector<unsigned int> m_cpus;     // The CPUs to pin the threads to; thread t runs on m_cpus[t].
+  unsigned int m_calibrated_iterations; // The iterations value last passed to calibrate_overhead().
+  uint32_t m_iterations_overhead;       // The overhead when using m_calibrated_iterations, in clock cycles.
+  double m_single_thread_throughput;    // The throughput of the last measurement with a single thread, or zero.
+
+ public:
+  // Use every CPU that the current thread is allowed to run on.
+  ScalingBenchmark();
+  // Use the given CPUs, in this order. For example CpuTopology::instance().physical_cores().
+  ScalingBenchmark(std::vector<unsigned int> cpus);
+
+  unsigned int max_threads() const { return m_cpus.size(); }
+
+  // Same as Stopwatch::calibrate_overhead; the calibration runs on the first CPU.
+  void calibrate_overhead(unsigned int iterations, unsigned int minimum_of);
+
+  // Run functor() on the first number_of_threads CPUs at the same time.
+  // Throws std::logic_error if calibrate_overhead() wasn't called first and
+  // std::out_of_range if number_of_threads isn't in the range [1, max_threads()].
+  template<int nk = 3, class T>
+  ScalingResult measure(unsigned int number_of_threads, unsigned int iterations, T const functor, unsigned int minimum_of = 3);
+
+  // Call measure() for 1, 2, 4, ... threads, up till and including max_threads().
+  template<int nk = 3, class T>
+  std::vector<ScalingResult> measure_scaling(unsigned int iterations, T const functor, unsigned int minimum_of = 3);
+
+  // Return 1, 2, 4, ..., up till and including max.
+  static std::vector<unsigned int> thread_counts(unsigned int max);
+
+ private:
+  // Block until `number_of_threads` threads called this function.
+  static void start_together(std::atomic<unsigned int>& ready, unsigned int number_of_threads)
+  {
+    ready.fetch_add(1);
+    while (ready.load(std::memory_order_relaxed) < number_of_threads)
+      __builtin_ia32_pause();
+  }
+
+  // Throw if measure() can't be called with these arguments.
+  void check_measure(unsigned int number_of_threads) const;
+
+  void finish(ScalingResult& result, std::vector<std::exception_ptr> const& errors);
+};
+
+template<int nk, class T>
+ScalingResult ScalingBenchmark::measure(unsigned int number_of_threads, unsigned int iterations, T const functor, unsigned int minimum_of)
+{
+  check_measure(number_of_threads);
+  ScalingResult result;
+  result.m_number_of_threads = number_of_threads;
+  result.m_iterations = iterations;
+  result.m_cpus.assign(m_cpus.begin(), m_cpus.begin() + number_of_threads);
+  result.m_per_thread.resize(number_of_threads);
+  std::vector<std::exception_ptr> errors(number_of_threads);
+
+  std::atomic<unsigned int> ready{0};           // The number of threads that are pinned and ready to start measuring.
+  std::atomic<unsigned int> converged{0};       // The number of threads that have a valid result.
+  std::vector<std::thread> threads;
+  threads.reserve(number_of_threads);
+  for (unsigned int t = 0; t < number_of_threads; ++t)
+    threads.emplace_back([&, t](){
+      bool started = false;
+      bool done = false;                        // Set when this thread incremented converged.
+      try
+      {
+        Stopwatch stopwatch(result.m_cpus[t]);
+        stopwatch.set_iterations_overhead(m_calibrated_iterations, m_iterations_overhead);
+        started = true;
+        start_together(ready, number_of_threads);
+        eda::FrequencyCounter<int, nk> fc;
+        // Keep measuring after our own result became valid until every thread has a valid result,
+        // so that the load on the other CPUs stays the same while they are still measuring.
+        do
+        {
+          if (fc.add(stopwatch.get_minimum_of(iterations, functor, minimum_of)) && !done)
+          {
+            result.m_per_thread[t] = fc.result();
+            done = true;
+            converged.fetch_add(1);
+          }
+        }
+        while (!done || converged.load(std::memory_order_relaxed) < number_of_threads);
+        stopwatch.subtract_overhead(result.m_per_thread[t], iterations);
+      }
+      catch (...)
+      {
+        errors[t] = std::current_exception();
+        // Don't let the other threads wait for us forever.
+        if (!started)
+          start_together(ready, number_of_threads);
+        if (!done)
+          converged.fetch_add(1);
+      }
+    });
+  for (auto&& thread : threads)
+    thread.join();
+
+  finish(result, errors);
+  return result;
+}
+
+template<int nk, class T>
+std::vector<ScalingResult> ScalingBenchmark::measure_scaling(unsigned int iterations, T const functor, unsigned int minimum_of)
+{
+  std::vector<ScalingResult> results;
+  for (unsigned int number_of_threads : thread_counts(max_threads()))
+    results.push_back(measure<nk>(number_of_threads, iterations, functor, minimum_of));
+  return results;
+}
+
+} // namespace benchmark
@@ -0,0 +1,205 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief This file contains the declaration of class Sweep.
+ */
+
+#pragma once
+
+#include "benchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+// Usage example
+//
+// A Sweep measures the same kind of benchmark for a range of x values (for
+// example the working set size) and for a number of variants (for example
+// different container types or template parameters). Every variant becomes
+// one curve when the results are added to an eda::Plot.
+//
+#ifdef EXAMPLE_CODE        // Undefined
+
+#include "sys.h"
+#include "debug.h"
+#include "cwds/Sweep.h"
+#include "cwds/gnuplot_tools.h"
+
+template<typename Map>
+auto make_lookup(double size)
+{
+  // The returned functor owns its state; it is constructed once per x value.
+  auto map = std::make_shared<Map>();
+  for (int i = 0; i < size; ++i)
+    (*map)[i * 7] = i;
+  return [map, key = 0, size = static_cast<int>(size)]() mutable {
+    asm volatile ("" :: "r" (map->find(key)->second));
+    key = (key + 7) % (7 * size);
+  };
+}
+
+int main()
+{
+  Debug(NAMESPACE_DEBUG::init());
+
+  benchmark::Stopwatch stopwatch;
+  stopwatch.calibrate_overhead(1000, 3);
+
+  benchmark::Sweep<> sweep(stopwatch, 1000, 3);
+  auto sizes = benchmark::Sweep<>::geometric(16, 1 << 20, 2);
+  sweep.run("std::map", sizes, make_lookup<std::map<int, int>>);
+  sweep.run("std::unordered_map", sizes, make_lookup<std::unordered_map<int, int>>);
+
+  eda::Plot plot("Lookup", "size", "cycles per lookup");
+  plot.add("set logscale x 2");
+  sweep.add_to(plot);
+  plot.show("yerrorlines");
+}
+
+#endif // EXAMPLE_CODE
+
+namespace benchmark {
+
+template<int nk = 3>
+class Sweep
+{
+ public:
+  struct Point
+  {
+    std::string m_variant;      // The curve that this point belongs to.
+    double m_x;                 // The x value that was passed to make_benchmark.
+    double m_y;                 // The average of the measurements, per iteration.
+    double m_dy;                // The standard deviation of the measurements, per iteration.
+    unsigned int m_converged;   // The number of measurements that converged; the others are the median of max_attempts minima.
+  };
+
+  static constexpr unsigned int default_max_attempts = 256;
+
+ private:
+  Stopwatch& m_stopwatch;
+  unsigned int m_iterations;    // Passed to Stopwatch::measure; call calibrate_overhead with the same value first.
+  unsigned int m_minimum_of;    // Passed to Stopwatch::measure.
+  unsigned int m_repeats;       // The number of measurements per point; used to determine m_dy.
+  unsigned int m_max_attempts;  // The maximum number of calls to Stopwatch::get_minimum_of per measurement.
+  bool m_nanoseconds;           // Set when y must be in nanoseconds instead of clock cycles.
+  std::vector<Point> m_points;
+
+  // Measure functor like Stopwatch::measure does, but give up after m_max_attempts calls to get_minimum_of
+  // and use the median of those instead: the FrequencyCounter doesn't converge when the measurements vary
+  // a lot, which is the case for working sets that don't fit in the cache. Sets converged accordingly.
+  // Returns the number of clock cycles of m_iterations calls, corrected for overhead.
+  template<class T>
+  int measure(T const& functor, bool& converged);
+
+ public:
+  Sweep(Stopwatch& stopwatch, unsigned int iterations, unsigned int minimum_of = 3, unsigned int repeats = 3) :
+    m_stopwatch(stopwatch), m_iterations(iterations), m_minimum_of(minimum_of), m_repeats(repeats), m_max_attempts(default_max_attempts), m_nanoseconds(false)
+  {
+    ASSERT(repeats > 0);
+  }
+
+  // Report y in nanoseconds per iteration instead of clock cycles per iteration.
+  void use_nanoseconds(bool nanoseconds = true) { m_nanoseconds = nanoseconds; }
+
+  // Set the maximum number of calls to Stopwatch::get_minimum_of per measurement.
+  void set_max_attempts(unsigned int max_attempts) { ASSERT(max_attempts > 0); m_max_attempts = max_attempts; }
+
+  // For each x in xs, call make_benchmark(x) and measure the returned functor.
+  // The functor is constructed before, and destructed after, its measurements
+  // so that its construction (for example filling a container) isn't measured.
+  template<class F>
+  void run(std::string const& variant, std::vector<double> const& xs, F make_benchmark);
+
+  std::vector<Point> const& points() const { return m_points; }
+
+  // Add all points to plot, with one curve per variant. PLOT is normally eda::Plot.
+  template<class PLOT>
+  void add_to(PLOT& plot) const
+  {
+    for (auto&& point : m_points)
+      plot.add_data_point(point.m_x, point.m_y, point.m_dy, point.m_variant);
+  }
+
+  // Return from, from * factor, from * factor^2, ... up till and including to.
+  static std::vector<double> geometric(double from, double to, double factor)
+  {
+    ASSERT(from > 0.0 && factor > 1.0);
+    std::vector<double> xs;
+    for (double x = from; x <= to * (1.0 + 1e-9); x *= factor)
+      xs.push_back(x);
+    return xs;
+  }
+
+  // Return from, from + step, from + 2 * step, ... up till and including to.
+  static std::vector<double> linear(double from, double to, double step)
+  {
+    ASSERT(step > 0.0);
+    std::vector<double> xs;
+    for (int i = 0; from + i * step <= to + 1e-9 * step; ++i)
+      xs.push_back(from + i * step);
+    return xs;
+  }
+};
+
+template<int nk>
+template<class T>
+int Sweep<nk>::measure(T const& functor, bool& converged)
+{
+  eda::FrequencyCounter<int, nk> fc;
+  std::vector<int> minima;
+  minima.reserve(m_max_attempts);
+  converged = false;
+  while (!converged && minima.size() < m_max_attempts)
+  {
+    minima.push_back(m_stopwatch.get_minimum_of(m_iterations, functor, m_minimum_of));
+    converged = fc.add(minima.back());
+  }
+  int cycles;
+  if (converged)
+    cycles = fc.result().m_cycles;
+  else
+  {
+    auto median = minima.begin() + minima.size() / 2;
+    std::nth_element(minima.begin(), median, minima.end());
+    cycles = *median;
+  }
+  return std::max(cycles - m_stopwatch.overhead(m_iterations), 0);
+}
+
+template<int nk>
+template<class F>
+void Sweep<nk>::run(std::string const& variant, std::vector<double> const& xs, F make_benchmark)
+{
+  DoutEntering(dc::notice, "Sweep<" << nk << ">::run(\"" << variant << "\", " << xs.size() << " points)");
+  for (double x : xs)
+  {
+    auto functor = make_benchmark(x);
+    // Measure a lambda that refers to functor, so that it isn't copied by get_minimum_of().
+    auto benchmark_code = [&functor]() mutable { functor(); };
+    double sum = 0.0;
+    double sum_of_squares = 0.0;
+    unsigned int number_converged = 0;
+    for (unsigned int r = 0; r < m_repeats; ++r)
+    {
+      bool converged;
+      double const cycles = measure(benchmark_code, converged);
+      double const y = (m_nanoseconds ? cycles * 1e9 / Stopwatch::tsc_frequency() : cycles) / m_iterations;
+      sum += y;
+      sum_of_squares += y * y;
+      if (converged)
+        ++number_converged;
+    }
+    double const mean = sum / m_repeats;
+    double const variance = m_repeats > 1 ? (sum_of_squares - m_repeats * mean * mean) / (m_repeats - 1) : 0.0;
+    m_points.push_back(Point{variant, x, mean, std::sqrt(std::max(variance, 0.0)), number_converged});
+    Dout(dc::notice, variant << ": x = " << x << ", y = " << mean << " +/- " << m_points.back().m_dy <<
+        (number_converged < m_repeats ? " (used the median for measurements that didn't converge)" : ""));
+  }
+}
+
+} // namespace benchmark
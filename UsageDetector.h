@@ -7,6 +7,18 @@
 #if __cplusplus >= 202101L
 
 #include "utils/Array.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <set>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 #include <debug.h>
 
@@ -14,8 +26,1028 @@ NAMESPACE_DEBUG_CHANNELS_START
 extern Channel usage_detector;
 NAMESPACE_DEBUG_CHANNELS_END
 
+// The output of every single access; removed at compile time in profile mode.
+#if CWDS_CHANNEL_USAGE_DETECTOR && !CWDS_USAGE_DETECTOR_PROFILE
+#define CWDS_USAGE_DETECTOR_TRACE 1
+#else
+#define CWDS_USAGE_DETECTOR_TRACE 0
+#endif
+
 NAMESPACE_DEBUG_START
 
+#if CWDS_USAGE_DETECTOR_PROFILE
+// The number of the calling thread: threads are numbered 1, 2, ... in the order
+// in which they first access a UsageDetector. Zero means not numbered yet.
+inline std::atomic<int> s_next_thread_number{1};
+inline thread_local int t_thread_number;
+
+inline int thread_number()
+{
+  if (t_thread_number == 0) [[unlikely]]
+    t_thread_number = s_next_thread_number.fetch_add(1, std::memory_order_relaxed);
+  return t_thread_number;
+}
+
+// The bookkeeping of a profile, with one instance per thread.
+//
+// Several threads may call const member functions of a container at the same time.
+// In order to record those accesses without a lock, and without the threads writing
+// to the same memory, every thread claims one of max_threads slots (lock-free, like
+// ThreadProfile) and records into an instance of T that only it writes to. Threads
+// beyond the first max_threads share one more instance, protected by a spin lock.
+//
+// The instances are combined with T::merge when the summary is printed, upon
+// destruction of the container (after all accesses).
+template<typename T>
+class PerThread
+{
+ public:
+  static constexpr int max_threads = 16;
+
+ private:
+  struct Slot
+  {
+    std::atomic<int> m_thread{0};                       // The thread number that owns this slot, or 0 when it is free.
+    std::unique_ptr<T> m_data;                          // Allocated by the owning thread.
+  };
+
+  std::array<Slot, max_threads> m_slots;
+  std::atomic_flag m_others_lock;
+  T m_others;                                           // Used by threads that didn't get a slot.
+
+ public:
+  PerThread() = default;
+  // A copy is a different container, with its own history.
+  PerThread(PerThread const&) : PerThread() { }
+
+  // Call update(data) with the instance of the calling thread.
+  template<typename F>
+  void update(F const& update)
+  {
+    int const thread = thread_number();
+    for (Slot& slot : m_slots)
+    {
+      int owner = slot.m_thread.load(std::memory_order_relaxed);
+      if (owner == 0 && slot.m_thread.compare_exchange_strong(owner, thread, std::memory_order_relaxed))
+      {
+        slot.m_data = std::make_unique<T>();
+        owner = thread;
+      }
+      if (owner == thread)
+      {
+        update(*slot.m_data);
+        return;
+      }
+    }
+    while (m_others_lock.test_and_set(std::memory_order_acquire))
+      m_others_lock.wait(true, std::memory_order_relaxed);
+    update(m_others);
+    m_others_lock.clear(std::memory_order_release);
+    m_others_lock.notify_one();
+  }
+
+  // Return the sum of the instances of all threads.
+  T merged() const
+  {
+    T total = m_others;
+    for (Slot const& slot : m_slots)
+    {
+      if (!slot.m_data)
+        break;
+      total.merge(*slot.m_data);
+    }
+    return total;
+  }
+};
+
+// Profile mode (CwdsUsageDetectorProfile=ON).
+//
+// Instead of printing every access, UsageDetector counts the accesses per index
+// (or key) and prints a summary to dc::usage_detector when it is destructed:
+// the total number of reads and writes, the hottest indices, and, for containers
+// with an integral index, a coarse heatmap over the used index range and the
+// histogram of the difference between indices that are accessed consecutively by
+// the same thread (the stride).
+//
+// A read is an access through a const UsageDetector (marked READ-ACCESS in the
+// normal output) or a lookup (find, count, contains). Accesses that return a
+// non-const reference, insertions and erasures count as writes.
+//
+// Only sequence containers pass SequenceIndex as Compare: their keys are indices
+// into the container and are counted in a vector, so that the heatmap and the
+// stride histogram can be printed. Any other Key (including the integral keys of
+// a std::map or std::set) is counted in a table of at most max_keys keys per
+// thread, using the space-saving algorithm: when the table is full, a new key
+// replaces the least accessed key and inherits its counts. The counts of a hot
+// key are then an upper bound, off by at most the printed error, while the
+// memory used doesn't grow with the number of different keys (for example,
+// lookups of keys that are not in the container).
+// Keys are compared with Compare; for unordered containers pass Hash, in which
+// case Compare is the key equality predicate.
+struct SequenceIndex { };
+
+template<typename Key, typename Compare = std::less<Key>, typename Hash = void>
+class UsageProfile
+{
+ private:
+  struct Counts
+  {
+    std::uint64_t reads = 0;
+    std::uint64_t writes = 0;
+  };
+
+  static constexpr bool is_index = std::is_same_v<Compare, SequenceIndex>;
+  static_assert(!is_index || (std::is_integral_v<Key> && std::is_void_v<Hash>), "SequenceIndex requires an integral index type.");
+  static constexpr int number_of_hot_keys = 8;          // The number of hottest indices that are printed.
+  static constexpr int number_of_strides = 8;           // The number of most frequent strides that are printed.
+  static constexpr std::size_t heatmap_buckets = 16;
+  static constexpr std::size_t max_keys = 64;           // The maximum number of keys that are counted per thread.
+
+  struct KeyCounts
+  {
+    Key key;
+    Counts counts;
+    std::uint64_t error;                                // The part of counts that might be accesses of other keys.
+  };
+
+  static bool equal(Key const& key1, Key const& key2)
+  {
+    if constexpr (std::is_void_v<Hash>)
+      return !Compare{}(key1, key2) && !Compare{}(key2, key1);
+    else
+      return Compare{}(key1, key2);
+  }
+
+  // The accesses of one thread. The strides are those between consecutive accesses by the same thread.
+  struct Data
+  {
+    // Indices are counted in a vector, keys in a table of at most max_keys entries.
+    std::conditional_t<is_index, std::vector<Counts>, std::vector<KeyCounts>> m_counts;
+    bool m_replaced = false;                            // Set when a key was replaced because m_counts was full.
+    std::unordered_map<std::int64_t, std::uint64_t> m_strides;  // Stride : number of times.
+    std::int64_t m_last_index = 0;
+    std::uint64_t m_reads = 0;
+    std::uint64_t m_writes = 0;
+
+    void record(Key const& key, bool write);
+    void merge(Data const& data);
+
+   private:
+    KeyCounts& find_or_replace(Key const& key);
+  };
+
+  PerThread<Data> m_data;
+
+ public:
+  void read(Key const& key) { m_data.update([&key](Data& data){ data.record(key, false); }); }
+  void write(Key const& key) { m_data.update([&key](Data& data){ data.record(key, true); }); }
+
+  void print_summary(char const* debug_name) const;
+};
+
+template<typename Key, typename Compare, typename Hash>
+void UsageProfile<Key, Compare, Hash>::Data::record(Key const& key, bool write)
+{
+  Counts* counts;
+  if constexpr (is_index)
+  {
+    std::size_t const index = key;
+    if (index >= m_counts.size())
+      m_counts.resize(index + 1);
+    counts = &m_counts[index];
+    if (m_reads + m_writes > 0)
+      ++m_strides[static_cast<std::int64_t>(index) - m_last_index];
+    m_last_index = index;
+  }
+  else
+    counts = &find_or_replace(key).counts;
+  if (write)
+  {
+    ++counts->writes;
+    ++m_writes;
+  }
+  else
+  {
+    ++counts->reads;
+    ++m_reads;
+  }
+}
+
+template<typename Key, typename Compare, typename Hash>
+typename UsageProfile<Key, Compare, Hash>::KeyCounts& UsageProfile<Key, Compare, Hash>::Data::find_or_replace(Key const& key)
+{
+  for (KeyCounts& key_counts : m_counts)
+    if (equal(key_counts.key, key))
+      return key_counts;
+  if (m_counts.size() < max_keys)
+  {
+    if (m_counts.empty())
+      m_counts.reserve(max_keys);
+    return m_counts.emplace_back(key, Counts{}, 0);
+  }
+  // Replace the least accessed key; the new key inherits its counts, as error.
+  KeyCounts& least = *std::min_element(m_counts.begin(), m_counts.end(),
+      [](KeyCounts const& kc1, KeyCounts const& kc2){ return kc1.counts.reads + kc1.counts.writes < kc2.counts.reads + kc2.counts.writes; });
+  least.key = key;
+  least.error = least.counts.reads + least.counts.writes;
+  m_replaced = true;
+  return least;
+}
+
+template<typename Key, typename Compare, typename Hash>
+void UsageProfile<Key, Compare, Hash>::Data::merge(Data const& data)
+{
+  if constexpr (is_index)
+  {
+    if (data.m_counts.size() > m_counts.size())
+      m_counts.resize(data.m_counts.size());
+    for (std::size_t index = 0; index < data.m_counts.size(); ++index)
+    {
+      m_counts[index].reads += data.m_counts[index].reads;
+      m_counts[index].writes += data.m_counts[index].writes;
+    }
+  }
+  else
+  {
+    for (KeyCounts const& key_counts : data.m_counts)
+    {
+      KeyCounts& total = find_or_replace(key_counts.key);
+      total.counts.reads += key_counts.counts.reads;
+      total.counts.writes += key_counts.counts.writes;
+      total.error += key_counts.error;
+    }
+    m_replaced |= data.m_replaced;
+  }
+  for (auto const& [stride, times] : data.m_strides)
+    m_strides[stride] += times;
+  m_reads += data.m_reads;
+  m_writes += data.m_writes;
+}
+
+template<typename Key, typename Compare, typename Hash>
+void UsageProfile<Key, Compare, Hash>::print_summary([[maybe_unused]] char const* debug_name) const
+{
+  Data const data = m_data.merged();
+  if (data.m_reads + data.m_writes == 0)
+  {
+    DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::usage_detector, debug_name << ": no accesses.");
+    return;
+  }
+
+  std::vector<KeyCounts> hot;                  // All accessed indices (counted keys), hottest first after sorting.
+  if constexpr (is_index)
+  {
+    for (std::size_t index = 0; index < data.m_counts.size(); ++index)
+      if (data.m_counts[index].reads + data.m_counts[index].writes > 0)
+        hot.emplace_back(index, data.m_counts[index], 0);
+  }
+  else
+    hot.assign(data.m_counts.begin(), data.m_counts.end());
+  std::size_t const used = hot.size();
+  auto hotter = [](KeyCounts const& kc1, KeyCounts const& kc2){ return kc1.counts.reads + kc1.counts.writes > kc2.counts.reads + kc2.counts.writes; };
+  std::size_t const number_of_hot = std::min<std::size_t>(number_of_hot_keys, hot.size());
+  std::partial_sort(hot.begin(), hot.begin() + number_of_hot, hot.end(), hotter);
+
+  DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::usage_detector, debug_name << ": " << data.m_reads << " reads, " << data.m_writes << " writes (" <<
+      (100.0 * data.m_reads / (data.m_reads + data.m_writes)) << "% reads) on " << (data.m_replaced ? "more than " : "") << used <<
+      (is_index ? " different indices." : " different keys."));
+  DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::usage_detector|continued_cf, debug_name << ": hottest:");
+  for (std::size_t i = 0; i < number_of_hot; ++i)
+  {
+    DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::continued, " [" << hot[i].key << "] " << hot[i].counts.reads << "r/" << hot[i].counts.writes << "w");
+    if (hot[i].error > 0)
+      DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::continued, " (error <= " << hot[i].error << ')');
+  }
+  DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::finish, "");
+
+  if constexpr (is_index)
+  {
+    // Heatmap: the number of accesses per 1/heatmap_buckets of the used index range.
+    std::size_t const bucket_size = (data.m_counts.size() + heatmap_buckets - 1) / heatmap_buckets;
+    std::vector<std::uint64_t> heatmap((data.m_counts.size() + bucket_size - 1) / bucket_size);
+    for (std::size_t index = 0; index < data.m_counts.size(); ++index)
+      heatmap[index / bucket_size] += data.m_counts[index].reads + data.m_counts[index].writes;
+    DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::usage_detector|continued_cf, debug_name << ": heatmap (" << bucket_size << " indices per bucket):");
+    for (std::uint64_t accesses : heatmap)
+      DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::continued, ' ' << accesses);
+    DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::finish, "");
+
+    std::vector<std::pair<std::int64_t, std::uint64_t>> strides(data.m_strides.begin(), data.m_strides.end());
+    std::size_t const number_of_frequent = std::min<std::size_t>(number_of_strides, strides.size());
+    std::partial_sort(strides.begin(), strides.begin() + number_of_frequent, strides.end(),
+        [](auto const& s1, auto const& s2){ return s1.second > s2.second; });
+    std::uint64_t transitions = 0;
+    for (auto const& stride : strides)
+      transitions += stride.second;
+    DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::usage_detector|continued_cf, debug_name << ": strides:");
+    for (std::size_t i = 0; i < number_of_frequent; ++i)
+      DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::continued, ' ' << std::showpos << strides[i].first << std::noshowpos << " (" << (100.0 * strides[i].second / transitions) << "%)");
+    DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::finish, "");
+  }
+}
+
+// The operations that are counted by MapProfile.
+enum class MapOperation
+{
+  lookup,       // at, find, count, contains, and operator[], insert, emplace, try_emplace or insert_or_assign of an existing key.
+  insert,       // operator[], insert, emplace, try_emplace and insert_or_assign of a new key.
+  erase,        // erase, extract.
+  ordered,      // lower_bound, upper_bound, equal_range.
+  iterate,      // begin, rbegin (assumed to be followed by a full traversal).
+  merge,
+  number_of_operations
+};
+
+// The operation mix and size profile of a UsageDetector<std::map>, used to recommend a layout.
+//
+// Each operation is counted together with the size of the map at that moment.
+// Upon destruction the total estimated cost of the recorded operations is printed
+// for each of the alternative layouts, followed by a recommendation.
+//
+// The cost model is deliberately simple; the units are roughly nanoseconds:
+//
+//                 std::map            sorted vector            open addressing hash   small (linear, inline)
+//   lookup        log n (miss + cmp)  log n (cmp + miss / 2)   hash + miss + cmp      n / 2 cmp
+//   insert/erase  lookup + alloc      lookup + n / 2 move      lookup + move          lookup + n / 2 move
+//   ordered       lookup              lookup                   not possible           lookup
+//   iterate       n miss              n move                   n move (unordered)     n move
+//
+// A small map is only possible if the map never grows beyond small_map_capacity elements.
+class MapProfile
+{
+ public:
+  static constexpr double cache_miss = 10.0;
+  static constexpr double compare = 1.0;
+  static constexpr double move = 1.0;
+  static constexpr double allocation = 25.0;
+  static constexpr double hash = 3.0;
+  static constexpr std::size_t small_map_capacity = 16;
+
+ private:
+  struct Counts
+  {
+    std::uint64_t calls = 0;
+    std::uint64_t sum_size = 0;         // The sum of the size of the map at each call.
+    std::uint64_t sum_log_size = 0;     // The sum of ceil(log2(size + 1)) at each call.
+  };
+
+  // The operations of one thread.
+  struct Data
+  {
+    std::array<Counts, static_cast<std::size_t>(MapOperation::number_of_operations)> m_counts;
+    std::size_t m_max_size = 0;
+
+    void merge(Data const& data)
+    {
+      for (std::size_t op = 0; op < m_counts.size(); ++op)
+      {
+        m_counts[op].calls += data.m_counts[op].calls;
+        m_counts[op].sum_size += data.m_counts[op].sum_size;
+        m_counts[op].sum_log_size += data.m_counts[op].sum_log_size;
+      }
+      m_max_size = std::max(m_max_size, data.m_max_size);
+    }
+  };
+
+  PerThread<Data> m_data;
+
+ public:
+  void record(MapOperation operation, std::size_t size)
+  {
+    m_data.update([operation, size](Data& data){
+      Counts& counts = data.m_counts[static_cast<std::size_t>(operation)];
+      ++counts.calls;
+      counts.sum_size += size;
+      counts.sum_log_size += std::bit_width(size);
+      data.m_max_size = std::max(data.m_max_size, size);
+    });
+  }
+
+  void print_recommendation(char const* debug_name) const;
+};
+
+inline void MapProfile::print_recommendation([[maybe_unused]] char const* debug_name) const
+{
+  Data const data = m_data.merged();
+  auto calls = [&data](MapOperation op){ return static_cast<double>(data.m_counts[static_cast<std::size_t>(op)].calls); };
+  auto sum_n = [&data](MapOperation op){ return static_cast<double>(data.m_counts[static_cast<std::size_t>(op)].sum_size); };
+  auto sum_log = [&data](MapOperation op){ return static_cast<double>(data.m_counts[static_cast<std::size_t>(op)].sum_log_size); };
+
+  using enum MapOperation;
+  std::uint64_t total_calls = 0;
+  for (Counts const& counts : data.m_counts)
+    total_calls += counts.calls;
+  if (total_calls == 0)
+    return;
+
+  double const lookups = calls(lookup) + calls(insert) + calls(erase) + calls(ordered);
+  double const lookup_log = sum_log(lookup) + sum_log(insert) + sum_log(erase) + sum_log(ordered);
+  double const lookup_n = sum_n(lookup) + sum_n(insert) + sum_n(erase) + sum_n(ordered);
+  double const traversed = sum_n(iterate) + sum_n(merge);
+  double const modifications = calls(insert) + calls(erase);
+  double const modified_n = sum_n(insert) + sum_n(erase);
+
+  struct Layout
+  {
+    char const* name;
+    double cost;
+    bool possible;
+  };
+  std::array<Layout, 4> layouts = {{
+    { "std::map", lookup_log * (cache_miss + compare) + modifications * allocation + traversed * cache_miss, true },
+    { "sorted vector", lookup_log * (compare + cache_miss / 2) + modified_n / 2 * move + traversed * move, true },
+    { "hash map with open addressing", lookups * (hash + cache_miss + compare) + modifications * move + traversed * move, calls(ordered) == 0 },
+    { "small map", lookup_n / 2 * compare + modified_n / 2 * move + traversed * move, data.m_max_size <= small_map_capacity }
+  }};
+
+  DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::usage_detector, debug_name << ": " << calls(lookup) << " lookups, " << calls(insert) << " inserts, " <<
+      calls(erase) << " erases, " << calls(ordered) << " ordered lookups, " << calls(iterate) << " iterations, " << calls(merge) << " merges; " <<
+      "average size " << (lookup_n + traversed) / std::max(1.0, lookups + calls(iterate) + calls(merge)) << ", maximum size " << data.m_max_size << ".");
+  Layout const* best = &layouts[0];
+  for (Layout const& layout : layouts)
+  {
+    if (!layout.possible)
+    {
+      DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::usage_detector, debug_name << ": " << layout.name << ": not possible.");
+      continue;
+    }
+    DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::usage_detector, debug_name << ": " << layout.name << ": estimated cost " << layout.cost << " (" <<
+        (100.0 * layout.cost / layouts[0].cost) << "% of std::map).");
+    if (layout.cost < best->cost)
+      best = &layout;
+  }
+  if (best == &layouts[0])
+    DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::usage_detector, debug_name << ": recommendation: keep std::map.");
+  else
+    DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::usage_detector, debug_name << ": recommendation: use a " << best->name << " instead" <<
+        (best == &layouts[2] && calls(iterate) > 0 ? " (if the iteration order doesn't matter)." : "."));
+}
+// The operations of a UsageDetector<std::vector> or UsageDetector<utils::Vector> that can reallocate.
+enum class VectorOperation
+{
+  append,       // push_back, emplace_back.
+  reserve,
+  shrink_to_fit,
+  resize,
+  insert,       // insert, emplace.
+  assign,
+  number_of_operations
+};
+
+// Records the reallocations of a std::vector or utils::Vector.
+//
+// A Scope is created on the stack around each operation that can reallocate; it
+// compares the capacity before and after the operation. A reallocation relocates
+// all elements that were in the vector before the operation (the first allocation
+// of an empty vector is not counted). Upon destruction, the number of reallocations
+// and bytes moved are printed per operation, together with the peak size and the
+// final capacity. If push_back / emplace_back caused at least
+// append_reallocations_threshold reallocations, a reserve is suggested.
+template<typename T>
+class ReallocationProfile
+{
+ public:
+  static constexpr std::uint64_t append_reallocations_threshold = 4;
+
+ private:
+  struct Counts
+  {
+    std::uint64_t calls = 0;
+    std::uint64_t reallocations = 0;
+    std::uint64_t moved_bytes = 0;
+  };
+
+  std::array<Counts, static_cast<std::size_t>(VectorOperation::number_of_operations)> m_counts;
+  std::size_t m_peak_size = 0;
+  std::size_t m_peak_capacity = 0;
+
+ public:
+  template<typename Vector>
+  class Scope
+  {
+   private:
+    ReallocationProfile& m_profile;
+    Vector const& m_vector;
+    VectorOperation m_operation;
+    std::size_t m_size;                 // The size before the operation.
+    std::size_t m_capacity;             // The capacity before the operation.
+
+   public:
+    Scope(ReallocationProfile& profile, VectorOperation operation, Vector const& vector) :
+      m_profile(profile), m_vector(vector), m_operation(operation), m_size(vector.size()), m_capacity(vector.capacity()) { }
+    ~Scope() { m_profile.record(m_operation, m_size, m_capacity, m_vector.size(), m_vector.capacity()); }
+  };
+
+  template<typename Vector>
+  Scope<Vector> scope(VectorOperation operation, Vector const& vector) { return { *this, operation, vector }; }
+
+  void record(VectorOperation operation, std::size_t old_size, std::size_t old_capacity, std::size_t new_size, std::size_t new_capacity)
+  {
+    Counts& counts = m_counts[static_cast<std::size_t>(operation)];
+    ++counts.calls;
+    if (new_capacity != old_capacity && old_capacity > 0)
+    {
+      ++counts.reallocations;
+      counts.moved_bytes += old_size * sizeof(T);
+    }
+    m_peak_size = std::max(m_peak_size, new_size);
+    m_peak_capacity = std::max(m_peak_capacity, new_capacity);
+  }
+
+  void print_summary(char const* debug_name, std::size_t size, std::size_t capacity) const;
+};
+
+template<typename T>
+void ReallocationProfile<T>::print_summary([[maybe_unused]] char const* debug_name, std::size_t size, std::size_t capacity) const
+{
+  static constexpr std::array<char const*, static_cast<std::size_t>(VectorOperation::number_of_operations)> operation_names = {
+    "push_back/emplace_back", "reserve", "shrink_to_fit", "resize", "insert/emplace", "assign"
+  };
+
+  std::size_t const peak_size = std::max(m_peak_size, size);
+  if (peak_size == 0 && capacity == 0)
+    return;
+
+  std::uint64_t reallocations = 0;
+  std::uint64_t moved_bytes = 0;
+  for (Counts const& counts : m_counts)
+  {
+    reallocations += counts.reallocations;
+    moved_bytes += counts.moved_bytes;
+  }
+  DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::usage_detector, debug_name << ": " << reallocations << " reallocations, " << moved_bytes << " bytes moved; peak size " <<
+      peak_size << ", peak capacity " << m_peak_capacity << ", final size " << size << ", final capacity " << capacity << ".");
+  for (std::size_t op = 0; op < m_counts.size(); ++op)
+    if (m_counts[op].reallocations > 0)
+      DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::usage_detector, debug_name << ": " << operation_names[op] << ": " << m_counts[op].calls << " calls, " <<
+          m_counts[op].reallocations << " reallocations, " << m_counts[op].moved_bytes << " bytes moved.");
+  if (capacity > peak_size)
+    DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::usage_detector, debug_name << ": " << (capacity - peak_size) << " elements (" << ((capacity - peak_size) * sizeof(T)) <<
+        " bytes) of the final capacity were never used.");
+  Counts const& appends = m_counts[static_cast<std::size_t>(VectorOperation::append)];
+  if (appends.reallocations >= append_reallocations_threshold)
+    DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::usage_detector, debug_name << ": push_back/emplace_back caused " << appends.reallocations << " reallocations (" <<
+        appends.moved_bytes << " bytes moved); consider calling reserve(" << peak_size << ") first.");
+}
+// Hash table statistics of a UsageDetector<std::unordered_map>.
+//
+// Every keyed lookup (at, operator[], find, count, contains, try_emplace,
+// insert_or_assign and erase of a key) records the length of the bucket that the key
+// hashes to: the number of elements that have to be compared in the worst case.
+// Every modification is wrapped in a Scope that detects rehashes (a change of the
+// bucket count) and samples the load factor. Upon destruction the number of rehashes,
+// the load factor over time, the histogram of the bucket lengths seen by lookups and
+// the bucket lengths of the final table are printed.
+class HashProfile
+{
+ public:
+  static constexpr std::size_t long_bucket = 8;         // Buckets with this many elements or more are counted together.
+  static constexpr std::size_t max_samples = 64;        // The maximum number of load factor samples that are kept.
+
+ private:
+  // The bucket lengths seen by the lookups of one thread.
+  struct LookupBucketLengths
+  {
+    std::array<std::uint64_t, long_bucket + 1> m_counts{};
+
+    void merge(LookupBucketLengths const& lengths)
+    {
+      for (std::size_t length = 0; length <= long_bucket; ++length)
+        m_counts[length] += lengths.m_counts[length];
+    }
+  };
+
+  PerThread<LookupBucketLengths> m_lookup_bucket_lengths;
+  std::uint64_t m_rehashes = 0;
+  std::uint64_t m_modifications = 0;
+  std::uint64_t m_sample_interval = 1;                  // Sample the load factor once every m_sample_interval modifications.
+  std::vector<float> m_load_factors;
+  float m_peak_load_factor = 0.0f;
+
+ public:
+  template<typename Container>
+  class Scope
+  {
+   private:
+    HashProfile& m_profile;
+    Container const& m_container;
+    std::size_t m_bucket_count;         // The bucket count before the operation.
+
+   public:
+    Scope(HashProfile& profile, Container const& container) : m_profile(profile), m_container(container), m_bucket_count(container.bucket_count()) { }
+    ~Scope() { m_profile.record(m_bucket_count, m_container.bucket_count(), m_container.load_factor()); }
+  };
+
+  template<typename Container>
+  Scope<Container> scope(Container const& container) { return { *this, container }; }
+
+  template<typename Container>
+  void lookup(Container const& container, typename Container::key_type const& key)
+  {
+    std::size_t const length = std::min(container.bucket_size(container.bucket(key)), long_bucket);
+    m_lookup_bucket_lengths.update([length](LookupBucketLengths& lengths){ ++lengths.m_counts[length]; });
+  }
+
+  void record(std::size_t old_bucket_count, std::size_t new_bucket_count, float load_factor)
+  {
+    if (new_bucket_count != old_bucket_count)
+      ++m_rehashes;
+    m_peak_load_factor = std::max(m_peak_load_factor, load_factor);
+    if (m_modifications++ % m_sample_interval != 0)
+      return;
+    if (m_load_factors.size() == max_samples)
+    {
+      // Keep every other sample and halve the sample rate.
+      for (std::size_t i = 1; i < max_samples / 2; ++i)
+        m_load_factors[i] = m_load_factors[2 * i];
+      m_load_factors.resize(max_samples / 2);
+      m_sample_interval *= 2;
+      if ((m_modifications - 1) % m_sample_interval != 0)
+        return;
+    }
+    m_load_factors.push_back(load_factor);
+  }
+
+  template<typename Container>
+  void print_summary(char const* debug_name, Container const& container) const;
+};
+
+template<typename Container>
+void HashProfile::print_summary([[maybe_unused]] char const* debug_name, Container const& container) const
+{
+  if (m_modifications == 0)
+    return;
+
+  DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::usage_detector, debug_name << ": " << m_rehashes << " rehashes in " << m_modifications << " modifications; final bucket count " <<
+      container.bucket_count() << ", final load factor " << container.load_factor() << " (max_load_factor " << container.max_load_factor() <<
+      "), peak load factor " << m_peak_load_factor << ".");
+  DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::usage_detector|continued_cf, debug_name << ": load factor over time (every " << m_sample_interval << " modifications):");
+  for (float load_factor : m_load_factors)
+    DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::continued, ' ' << load_factor);
+  DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::finish, "");
+
+  std::array<std::uint64_t, long_bucket + 1> const lookup_bucket_lengths = m_lookup_bucket_lengths.merged().m_counts;
+  std::uint64_t lookups = 0;
+  std::uint64_t compares = 0;
+  for (std::size_t length = 0; length <= long_bucket; ++length)
+  {
+    lookups += lookup_bucket_lengths[length];
+    compares += length * lookup_bucket_lengths[length];
+  }
+  if (lookups > 0)
+  {
+    DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::usage_detector|continued_cf, debug_name << ": bucket length at lookup (average " <<
+        (static_cast<double>(compares) / lookups) << "):");
+    for (std::size_t length = 0; length <= long_bucket; ++length)
+      if (lookup_bucket_lengths[length] > 0)
+        DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::continued, ' ' << length << (length == long_bucket ? "+" : "") << ':' <<
+            (100.0 * lookup_bucket_lengths[length] / lookups) << '%');
+    DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::finish, "");
+  }
+
+  // The bucket lengths of the final table.
+  std::size_t empty_buckets = 0;
+  std::size_t longest = 0;
+  std::size_t colliding = 0;            // The number of elements that share their bucket with another element.
+  for (std::size_t bucket = 0; bucket < container.bucket_count(); ++bucket)
+  {
+    std::size_t const length = container.bucket_size(bucket);
+    if (length == 0)
+      ++empty_buckets;
+    else if (length > 1)
+      colliding += length;
+    longest = std::max(longest, length);
+  }
+  if (!container.empty())
+    DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::usage_detector, debug_name << ": final table: " << empty_buckets << " empty buckets, longest bucket " << longest <<
+        ", " << (100.0 * colliding / container.size()) << "% of the elements share a bucket.");
+}
+// Which threads access a UsageDetector, and when.
+//
+// Every member function of a UsageDetector runs inside a Scope that records the
+// calling thread in one of max_threads slots (claimed lock-free, like the buffers
+// of signal_safe_trace): the number of accesses and writes, the time of the first
+// and last access, and the time of the first and last write. Reads and writes are
+// classified like UsageProfile does: lookups, iteration and other accesses through
+// a const UsageDetector are reads; accesses that return a non-const reference,
+// insertions, erasures and other changes to the container are writes. Calling, for
+// example, find() or end() on a non-const UsageDetector is a read. It also counts handovers
+// (an access by a different thread than the previous access) and, much like
+// OneThreadAtATime, detects that another thread was inside a member function at the
+// same time: a concurrent access if at least one of the two is a write, otherwise a
+// concurrent read (which is safe).
+//
+// Upon destruction, if more than one thread accessed the container, the accesses
+// per thread are printed together with the time windows during which two or more
+// threads were using it (their first-to-last access windows overlap), followed by
+// a verdict:
+//
+// - Only one thread: a lock around this container is not needed.
+// - Concurrent accesses: the container is not protected by a lock (everywhere).
+// - Several threads but their windows don't overlap: ownership is handed over;
+//   a lock is only needed for the handover.
+// - Overlapping windows, but no thread wrote to it while another thread was using
+//   it: it is only read at the same time, which doesn't need a lock.
+// - Otherwise the lock is needed; if the threads interleave closely, consider
+//   sharding the container per thread.
+//
+// Note that only the member function calls themselves are observed, not the use
+// of references and iterators that they return.
+class ThreadProfile
+{
+ public:
+  static constexpr int max_threads = 16;                // The number of threads that are recorded separately.
+  static constexpr std::size_t max_windows = 8;         // The maximum number of overlap windows that are printed.
+  static constexpr double close_interleaving = 4.0;     // Fewer accesses per handover than this is considered to be close interleaving.
+
+ private:
+  using clock_type = std::chrono::steady_clock;
+
+  // Apart from m_thread, only written by the owning thread.
+  struct Slot
+  {
+    std::atomic<int> m_thread{0};                       // The thread number that owns this slot, or 0 when it is free.
+    std::atomic<std::uint64_t> m_accesses{0};
+    std::atomic<std::uint64_t> m_writes{0};
+    std::atomic<std::int64_t> m_first{0};               // The time of the first access in nanoseconds since m_start.
+    std::atomic<std::int64_t> m_last{0};                // The time of the last access in nanoseconds since m_start.
+    std::atomic<std::int64_t> m_first_write{0};         // The time of the first write in nanoseconds since m_start.
+    std::atomic<std::int64_t> m_last_write{0};          // The time of the last write in nanoseconds since m_start.
+  };
+
+  clock_type::time_point const m_start;
+  std::array<Slot, max_threads> m_slots;
+  std::atomic<std::uint64_t> m_other_accesses{0};       // Accesses by threads that didn't get a slot.
+  std::atomic<int> m_last_thread{0};                    // The thread of the previous access.
+  std::atomic<std::uint64_t> m_handovers{0};
+  std::atomic<int> m_writers{0};                        // The number of threads that are inside a member function that writes.
+  std::atomic<int> m_readers{0};                        // The number of threads that are inside a member function that only reads.
+  std::atomic<std::uint64_t> m_concurrent{0};           // Accesses that overlapped with another access, at least one of them a write.
+  std::atomic<std::uint64_t> m_concurrent_reads{0};     // Reads that only overlapped with other reads.
+
+  void enter(int thread, bool write)
+  {
+    std::int64_t const now = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - m_start).count();
+    Slot* slot = nullptr;
+    for (Slot& candidate : m_slots)
+    {
+      int owner = candidate.m_thread.load(std::memory_order_relaxed);
+      if (owner == 0 && candidate.m_thread.compare_exchange_strong(owner, thread, std::memory_order_relaxed))
+      {
+        candidate.m_first.store(now, std::memory_order_relaxed);
+        owner = thread;
+      }
+      if (owner == thread)
+      {
+        slot = &candidate;
+        break;
+      }
+    }
+    if (slot)
+    {
+      slot->m_accesses.store(slot->m_accesses.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      slot->m_last.store(now, std::memory_order_relaxed);
+      if (write)
+      {
+        std::uint64_t const writes = slot->m_writes.load(std::memory_order_relaxed);
+        if (writes == 0)
+          slot->m_first_write.store(now, std::memory_order_relaxed);
+        slot->m_writes.store(writes + 1, std::memory_order_relaxed);
+        slot->m_last_write.store(now, std::memory_order_relaxed);
+      }
+    }
+    else
+      m_other_accesses.fetch_add(1, std::memory_order_relaxed);
+    int const last_thread = m_last_thread.load(std::memory_order_relaxed);
+    if (last_thread != thread)
+    {
+      m_last_thread.store(thread, std::memory_order_relaxed);
+      if (last_thread != 0)
+        m_handovers.fetch_add(1, std::memory_order_relaxed);
+    }
+    // Sequentially consistent, so that of two overlapping accesses at least one sees the other.
+    if (write)
+    {
+      int const writers = m_writers.fetch_add(1);
+      if (writers > 0 || m_readers.load() > 0)
+        m_concurrent.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+      int const readers = m_readers.fetch_add(1);
+      if (m_writers.load() > 0)
+        m_concurrent.fetch_add(1, std::memory_order_relaxed);
+      else if (readers > 0)
+        m_concurrent_reads.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  void leave(bool write)
+  {
+    (write ? m_writers : m_readers).fetch_sub(1, std::memory_order_release);
+  }
+
+ public:
+  ThreadProfile() : m_start(clock_type::now()) { }
+  // A copy is a different container, with its own history.
+  ThreadProfile(ThreadProfile const&) : ThreadProfile() { }
+
+  class Scope
+  {
+   private:
+    ThreadProfile& m_profile;
+    bool m_write;
+
+   public:
+    Scope(ThreadProfile& profile, bool write) : m_profile(profile), m_write(write) { m_profile.enter(thread_number(), write); }
+    ~Scope() { m_profile.leave(m_write); }
+  };
+
+  // Call one of these at the start of every member function of the container.
+  Scope read_scope() { return { *this, false }; }
+  Scope write_scope() { return { *this, true }; }
+
+  void print_summary(char const* debug_name) const;
+};
+
+inline void ThreadProfile::print_summary([[maybe_unused]] char const* debug_name) const
+{
+  struct ThreadAccesses
+  {
+    int thread;
+    std::uint64_t accesses;
+    std::uint64_t writes;
+    std::int64_t first;
+    std::int64_t last;
+    std::int64_t first_write;
+    std::int64_t last_write;
+  };
+  std::vector<ThreadAccesses> threads;
+  std::uint64_t const other_accesses = m_other_accesses.load(std::memory_order_relaxed);
+  std::uint64_t total = other_accesses;
+  for (Slot const& slot : m_slots)
+  {
+    int const thread = slot.m_thread.load(std::memory_order_relaxed);
+    if (thread == 0)
+      break;
+    threads.push_back({ thread, slot.m_accesses.load(std::memory_order_relaxed), slot.m_writes.load(std::memory_order_relaxed),
+        slot.m_first.load(std::memory_order_relaxed), slot.m_last.load(std::memory_order_relaxed),
+        slot.m_first_write.load(std::memory_order_relaxed), slot.m_last_write.load(std::memory_order_relaxed) });
+    total += threads.back().accesses;
+  }
+  if (total == 0)
+    return;
+  if (threads.size() == 1 && other_accesses == 0)
+  {
+    DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::usage_detector, debug_name << ": only accessed by thread #" << threads[0].thread << ": no lock is needed.");
+    return;
+  }
+
+  auto ms = [](std::int64_t ns){ return ns / 1e6; };
+  std::uint64_t const handovers = m_handovers.load(std::memory_order_relaxed);
+  std::uint64_t const concurrent = m_concurrent.load(std::memory_order_relaxed);
+  std::uint64_t const concurrent_reads = m_concurrent_reads.load(std::memory_order_relaxed);
+  DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::usage_detector, debug_name << ": accessed by " << (threads.size() + (other_accesses > 0 ? 1 : 0)) << (other_accesses > 0 ? " or more" : "") <<
+      " threads; " << total << " accesses, " << handovers << " handovers, " << concurrent << " concurrent accesses involving a write, " <<
+      concurrent_reads << " concurrent reads.");
+  for (ThreadAccesses const& ta : threads)
+    DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::usage_detector, debug_name << ": thread #" << ta.thread << ": " << ta.accesses << " accesses (" << (100.0 * ta.accesses / total) <<
+        "%), of which " << ta.writes << " writes, between " << ms(ta.first) << " ms and " << ms(ta.last) << " ms.");
+  if (other_accesses > 0)
+    DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::usage_detector, debug_name << ": " << other_accesses << " accesses by threads beyond the first " << max_threads << ".");
+
+  // Find the time windows during which the first-to-last access windows of two or more threads overlap.
+  std::vector<std::pair<std::int64_t, int>> events;     // Time, +1 for the first access of a thread, -1 for the last.
+  for (ThreadAccesses const& ta : threads)
+  {
+    events.emplace_back(ta.first, 1);
+    events.emplace_back(ta.last, -1);
+  }
+  // At equal times, process the starts first, so that touching windows count as overlapping.
+  std::sort(events.begin(), events.end(), [](auto const& e1, auto const& e2){ return e1.first < e2.first || (e1.first == e2.first && e1.second > e2.second); });
+  std::vector<std::pair<std::int64_t, std::int64_t>> windows;
+  std::int64_t overlap_time = 0;
+  int active = 0;
+  std::int64_t window_start = 0;
+  for (auto const& [time, delta] : events)
+  {
+    if (delta > 0 && ++active == 2)
+      window_start = time;
+    else if (delta < 0 && active-- == 2)
+    {
+      windows.emplace_back(window_start, time);
+      overlap_time += time - window_start;
+    }
+  }
+  if (!windows.empty())
+  {
+    DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::usage_detector|continued_cf, debug_name << ": " << windows.size() << " overlap windows (" << ms(overlap_time) << " ms in total):");
+    for (std::size_t i = 0; i < std::min(windows.size(), max_windows); ++i)
+      DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::continued, " [" << ms(windows[i].first) << ", " << ms(windows[i].second) << "] ms");
+    DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::finish, (windows.size() > max_windows ? " ..." : ""));
+  }
+
+  // Did a thread write to the container while another thread was using it (their windows overlap)?
+  bool shared_writes = other_accesses > 0;      // Assume the worst for the threads that weren't recorded.
+  for (ThreadAccesses const& writer : threads)
+  {
+    if (writer.writes == 0)
+      continue;
+    for (ThreadAccesses const& ta : threads)
+      if (&ta != &writer && writer.first_write <= ta.last && ta.first <= writer.last_write)
+        shared_writes = true;
+  }
+
+  double const run_length = static_cast<double>(total) / (handovers + 1);       // The average number of accesses by the same thread in a row.
+  if (concurrent > 0)
+    DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::usage_detector, debug_name << ": " << concurrent << " accesses happened while another thread was accessing it, "
+        "at least one of them writing: it is not protected by a lock (everywhere); add one, or shard it per thread.");
+  else if (windows.empty())
+    DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::usage_detector, debug_name << ": used by one thread at a time: ownership is handed over, a lock is only needed for the handover.");
+  else if (!shared_writes)
+    DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::usage_detector, debug_name << ": only read while shared by several threads (" << concurrent_reads << " concurrent reads): "
+        "no lock is needed as long as nobody writes to it at the same time.");
+  else if (run_length < close_interleaving)
+    DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::usage_detector, debug_name << ": threads interleave closely (" << run_length << " accesses per handover on average): "
+        "the lock is needed and likely contended; consider sharding it per thread.");
+  else
+    DoutIf(CWDS_CHANNEL_USAGE_DETECTOR, dc::usage_detector, debug_name << ": shared by several threads at the same time (" << run_length << " accesses per handover on average): "
+        "the lock is needed.");
+}
+#else
+// Not in profile mode: nothing is recorded.
+struct SequenceIndex { };
+
+template<typename Key, typename Compare = std::less<Key>, typename Hash = void>
+class UsageProfile
+{
+ public:
+  void read(Key const&) { }
+  void write(Key const&) { }
+  void print_summary(char const*) const { }
+};
+
+enum class MapOperation { lookup, insert, erase, ordered, iterate, merge };
+
+class MapProfile
+{
+ public:
+  void record(MapOperation, std::size_t) { }
+  void print_recommendation(char const*) const { }
+};
+
+enum class VectorOperation { append, reserve, shrink_to_fit, resize, insert, assign };
+
+template<typename T>
+class ReallocationProfile
+{
+ public:
+  template<typename Vector>
+  struct Scope
+  {
+    ~Scope() { }                        // Not trivial, so that an unused Scope doesn't cause a warning.
+  };
+
+  template<typename Vector>
+  Scope<Vector> scope(VectorOperation, Vector const&) { return {}; }
+
+  void print_summary(char const*, std::size_t, std::size_t) const { }
+};
+
+class HashProfile
+{
+ public:
+  template<typename Container>
+  struct Scope
+  {
+    ~Scope() { }
+  };
+
+  template<typename Container>
+  Scope<Container> scope(Container const&) { return {}; }
+
+  template<typename Container>
+  void lookup(Container const&, typename Container::key_type const&) { }
+
+  template<typename Container>
+  void print_summary(char const*, Container const&) const { }
+};
+
+class ThreadProfile
+{
+ public:
+  struct Scope
+  {
+    ~Scope() { }
+  };
+
+  Scope read_scope() { return {}; }
+  Scope write_scope() { return {}; }
+
+  void print_summary(char const*) const { }
+};
+#endif
+
 // Usage:
 //
 // NAMESPACE_DEBUG::UsageDetector<TheType> my_type;
@@ -42,6 +1074,8 @@ class UsageDetector<utils::Array<T, N, _Index>> : protected utils::Array<T, N, _
 {
  private:
   char const* m_debug_name;
+  [[no_unique_address]] mutable ThreadProfile m_threads;                 // Only used in profile mode.
+  [[no_unique_address]] mutable UsageProfile<std::size_t, SequenceIndex> m_profile;   // Only used in profile mode.
 
  protected:
   using _UDBase = utils::Array<T, N, _Index>;
@@ -53,55 +1087,70 @@ class UsageDetector<utils::Array<T, N, _Index>> : protected utils::Array<T, N, _
 
   UsageDetector(char const* debug_name) : _UDBase(), m_debug_name(debug_name)
   {
-    DoutEntering(dc::usage_detector, libcwd::type_info_of<_UDBase>().demangled_name() << "::Array() [" << debug_name << "] [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, libcwd::type_info_of<_UDBase>().demangled_name() << "::Array() [" << debug_name << "] [" << this << "]");
   }
 
   ~UsageDetector()
   {
+    m_profile.print_summary(m_debug_name);
+    m_threads.print_summary(m_debug_name);
     for (_Index i = ibegin(); i != iend(); ++i)
       Dout(dc::always, m_debug_name << "[" << i << "] = " << this->operator[](i));
-    DoutEntering(dc::usage_detector, libcwd::type_info_of<_UDBase>().demangled_name() << "::~Array() [" << m_debug_name << "] [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, libcwd::type_info_of<_UDBase>().demangled_name() << "::~Array() [" << m_debug_name << "] [" << this << "]");
   }
 
   reference operator[](index_type __n) _GLIBCXX_NOEXCEPT
   {
-    DoutEntering(dc::usage_detector, m_debug_name << "[" << __n << "] [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << "[" << __n << "] [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(__n.get_value());
     return _UDBase::operator[](__n);
   }
 
   const_reference operator[](index_type __n) const _GLIBCXX_NOEXCEPT
   {
-    DoutEntering(dc::usage_detector, m_debug_name << "[" << __n << "] [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << "[" << __n << "] [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_profile.read(__n.get_value());
     return _UDBase::operator[](__n);
   }
 
   reference at(index_type __n)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".at(" << __n << ") [" << this << "]");
-    return _UDBase::at(__n);
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".at(" << __n << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    reference result = _UDBase::at(__n);        // Throws if out of range; record the access afterwards.
+    m_profile.write(__n.get_value());
+    return result;
   }
 
   const_reference at(index_type __n) const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".at(" << __n << ") [" << this << "] READ-ACCESS");
-    return _UDBase::at(__n);
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".at(" << __n << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    const_reference result = _UDBase::at(__n);        // Throws if out of range; record the access afterwards.
+    m_profile.read(__n.get_value());
+    return result;
   }
 
   index_type ibegin() const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".ibegin() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".ibegin() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::ibegin();
   }
 
   index_type iend() const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".iend() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".iend() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::iend();
   }
 
   _UDBase const& base_class() const
   {
-    DoutEntering(dc::usage_detector, "base_class() [" << m_debug_name << "] [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, "base_class() [" << m_debug_name << "] [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return *(static_cast<_UDBase const*>(this));
   }
 };
@@ -114,6 +1163,9 @@ class UsageDetector<std::vector<T, Allocator>> : protected std::vector<T, Alloca
   using _UDBase = std::vector<T, Allocator>;
 
   char const* m_debug_name;
+  [[no_unique_address]] mutable ThreadProfile m_threads;                 // Only used in profile mode.
+  [[no_unique_address]] mutable UsageProfile<typename _UDBase::size_type, SequenceIndex> m_profile;   // Only used in profile mode.
+  [[no_unique_address]] ReallocationProfile<T> m_reallocations;           // Only used in profile mode.
 
  public:
   using value_type = typename _UDBase::value_type;
@@ -132,7 +1184,7 @@ class UsageDetector<std::vector<T, Allocator>> : protected std::vector<T, Alloca
   // Constructors
   constexpr UsageDetector(char const* debug_name) noexcept(noexcept(Allocator())) : _UDBase(), m_debug_name(debug_name)
   {
-    DoutEntering(dc::usage_detector, libcwd::type_info_of<_UDBase>().demangled_name() << "::vector() [" << debug_name << "] [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, libcwd::type_info_of<_UDBase>().demangled_name() << "::vector() [" << debug_name << "] [" << this << "]");
   }
 
 #if 0
@@ -177,7 +1229,10 @@ class UsageDetector<std::vector<T, Allocator>> : protected std::vector<T, Alloca
   // Destructor
   constexpr ~UsageDetector()
   {
-    DoutEntering(dc::usage_detector, libcwd::type_info_of<_UDBase>().demangled_name() << "::~vector() [" << m_debug_name << "] [" << this << "]");
+    m_profile.print_summary(m_debug_name);
+    m_threads.print_summary(m_debug_name);
+    m_reallocations.print_summary(m_debug_name, _UDBase::size(), _UDBase::capacity());
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, libcwd::type_info_of<_UDBase>().demangled_name() << "::~vector() [" << m_debug_name << "] [" << this << "]");
   }
 
 #if 0
@@ -204,293 +1259,369 @@ class UsageDetector<std::vector<T, Allocator>> : protected std::vector<T, Alloca
 
   constexpr void assign(size_type count, T const& value)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".assign(" << count << ", " << value << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".assign(" << count << ", " << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::assign, *static_cast<_UDBase const*>(this));
     _UDBase::assign(count, value);
   }
 
   template<class InputIt>
   constexpr void assign(InputIt first, InputIt last)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".assign(" << first << ", " << last << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".assign(" << first << ", " << last << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::assign, *static_cast<_UDBase const*>(this));
     _UDBase::assign(first, last);
   }
 
   constexpr void assign(std::initializer_list<T> ilist)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".assign(" << ilist << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".assign(" << ilist << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::assign, *static_cast<_UDBase const*>(this));
     _UDBase::assign(ilist);
   }
 
   constexpr allocator_type get_allocator() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".get_allocator() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".get_allocator() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::get_allocator();
   }
 
   constexpr reference at(size_type pos)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".at(" << pos << ") [" << this << "]");
-    return _UDBase::at(pos);
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".at(" << pos << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    reference result = _UDBase::at(pos);        // Throws if out of range; record the access afterwards.
+    m_profile.write(pos);
+    return result;
   }
 
   constexpr const_reference at(size_type pos) const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".at(" << pos << ") [" << this << "] READ-ACCESS");
-    return _UDBase::at(pos);
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".at(" << pos << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    const_reference result = _UDBase::at(pos);        // Throws if out of range; record the access afterwards.
+    m_profile.read(pos);
+    return result;
   }
 
   constexpr reference operator[](size_type pos)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << "[" << pos << "] [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << "[" << pos << "] [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(pos);
     return _UDBase::operator[](pos);
   }
 
   constexpr const_reference operator[](size_type pos) const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << "[" << pos << "] [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << "[" << pos << "] [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_profile.read(pos);
     return _UDBase::operator[](pos);
   }
 
   constexpr reference front()
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".front() [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".front() [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(0);
     return _UDBase::front();
   }
 
   constexpr const_reference front() const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".front() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".front() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_profile.read(0);
     return _UDBase::front();
   }
 
   constexpr reference back()
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".back() [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".back() [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(_UDBase::size() - 1);
     return _UDBase::back();
   }
 
   constexpr const_reference back() const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".back() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".back() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_profile.read(_UDBase::size() - 1);
     return _UDBase::back();
   }
 
   constexpr T* data() noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".data() [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".data() [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::data();
   }
 
   constexpr T const* data() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".data() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".data() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::data();
   }
 
   constexpr iterator begin() noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".begin() [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".begin() [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::begin();
   }
 
   constexpr const_iterator begin() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".begin() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".begin() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::begin();
   }
 
   constexpr const_iterator cbegin() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".cbegin() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".cbegin() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::cbegin();
   }
 
   constexpr iterator end() noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".end() [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".end() [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::end();
   }
 
   constexpr const_iterator end() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".end() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".end() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::end();
   }
 
   constexpr const_iterator cend() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".cend() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".cend() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::cend();
   }
 
   constexpr reverse_iterator rbegin() noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".rbegin() [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".rbegin() [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::rbegin();
   }
 
   constexpr const_reverse_iterator rbegin() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".rbegin() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".rbegin() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::rbegin();
   }
 
   constexpr const_reverse_iterator crbegin() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".crbegin() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".crbegin() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::crbegin();
   }
 
   constexpr reverse_iterator rend() noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".rend() [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".rend() [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::rend();
   }
 
   constexpr const_reverse_iterator rend() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".rend() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".rend() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::rend();
   }
 
   constexpr const_reverse_iterator crend() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".crend() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".crend() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::crend();
   }
 
   [[nodiscard]] constexpr bool empty() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".empty() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".empty() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::empty();
   }
 
   constexpr size_type size() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".size() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".size() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::size();
   }
 
   constexpr size_type max_size() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".max_size() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".max_size() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::max_size();
   }
 
   constexpr void reserve(size_type new_cap)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".reserve(" << new_cap << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".reserve(" << new_cap << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::reserve, *static_cast<_UDBase const*>(this));
     _UDBase::reserve(new_cap);
   }
 
   constexpr size_type capacity() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".capacity() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".capacity() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::capacity();
   }
 
   constexpr void shrink_to_fit()
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".shrink_to_fit() [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".shrink_to_fit() [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::shrink_to_fit, *static_cast<_UDBase const*>(this));
     _UDBase::shrink_to_fit();
   }
 
   constexpr void clear() noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".clear() [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".clear() [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
     _UDBase::clear();
   }
 
   constexpr iterator insert(const_iterator pos, T const& value)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << value << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::insert, *static_cast<_UDBase const*>(this));
     return _UDBase::insert(pos, value);
   }
 
   constexpr iterator insert(const_iterator pos, T&& value)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << value << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::insert, *static_cast<_UDBase const*>(this));
     return _UDBase::insert(pos, std::move(value));
   }
 
   template<class InputIt>
   constexpr iterator insert(const_iterator pos, InputIt first, InputIt last)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << first << ", " << last << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << first << ", " << last << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::insert, *static_cast<_UDBase const*>(this));
     return _UDBase::insert(pos, first, last);
   }
 
   constexpr iterator insert(const_iterator pos, std::initializer_list<T> ilist)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << ilist << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << ilist << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::insert, *static_cast<_UDBase const*>(this));
     return _UDBase::insert(pos, ilist);
   }
 
   template<class... Args>
   constexpr iterator emplace(const_iterator pos, Args&&... args)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".emplace(" << pos << ", " << join(", ", args...) << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".emplace(" << pos << ", " << join(", ", args...) << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::insert, *static_cast<_UDBase const*>(this));
     return _UDBase::emplace(pos, std::forward<Args>(args)...);
   }
 
   constexpr iterator erase(const_iterator pos)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".erase(" << pos << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".erase(" << pos << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
     return _UDBase::erase(pos);
   }
 
   constexpr iterator erase(const_iterator first, const_iterator last)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".erase(" << first << ", " << last << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".erase(" << first << ", " << last << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
     return _UDBase::erase(first, last);
   }
 
   constexpr void push_back(T const& value)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".push_back(" << value << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".push_back(" << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(_UDBase::size());
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::append, *static_cast<_UDBase const*>(this));
     _UDBase::push_back(value);
   }
 
   constexpr void push_back(T&& value)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".push_back(" << value << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".push_back(" << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(_UDBase::size());
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::append, *static_cast<_UDBase const*>(this));
     _UDBase::push_back(std::move(value));
   }
 
   template< class... Args >
   constexpr reference emplace_back(Args&&... args)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".emplace_back(" << join(", ", args...) << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".emplace_back(" << join(", ", args...) << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(_UDBase::size());
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::append, *static_cast<_UDBase const*>(this));
     return _UDBase::emplace_back(std::forward<Args>(args)...);
   }
 
   constexpr void pop_back()
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".pop_back() [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".pop_back() [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
     _UDBase::pop_back();
   }
 
   constexpr void resize(size_type count)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".resize(" << count << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".resize(" << count << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::resize, *static_cast<_UDBase const*>(this));
     _UDBase::resize(count);
   }
 
   constexpr void resize(size_type count, const value_type& value)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".resize(" << count << ", " << value << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".resize(" << count << ", " << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::resize, *static_cast<_UDBase const*>(this));
     _UDBase::resize(count, value);
   }
 
   constexpr void swap(UsageDetector& other) noexcept(std::allocator_traits<Allocator>::propagate_on_container_move_assignment::value)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".swap(" << other << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".swap(" << other << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
     _UDBase::swap(other);
   }
 
   _UDBase const& base_class() const
   {
-    DoutEntering(dc::usage_detector, "base_class() [" << m_debug_name << "] [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, "base_class() [" << m_debug_name << "] [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return *(static_cast<_UDBase const*>(this));
   }
 };
@@ -503,6 +1634,9 @@ class UsageDetector<utils::Vector<T, _Index, _Alloc>> : protected utils::Vector<
   using _UDBase = utils::Vector<T, _Index, _Alloc>;
 
   char const* m_debug_name;
+  [[no_unique_address]] mutable ThreadProfile m_threads;                 // Only used in profile mode.
+  [[no_unique_address]] mutable UsageProfile<std::size_t, SequenceIndex> m_profile;   // Only used in profile mode.
+  [[no_unique_address]] ReallocationProfile<T> m_reallocations;           // Only used in profile mode.
 
  public:
   using value_type = typename _UDBase::value_type;
@@ -522,7 +1656,7 @@ class UsageDetector<utils::Vector<T, _Index, _Alloc>> : protected utils::Vector<
   // Constructors
   constexpr UsageDetector(char const* debug_name) noexcept(noexcept(_Alloc())) : _UDBase(), m_debug_name(debug_name)
   {
-    DoutEntering(dc::usage_detector, libcwd::type_info_of<_UDBase>().demangled_name() << "::Vector() [" << debug_name << "] [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, libcwd::type_info_of<_UDBase>().demangled_name() << "::Vector() [" << debug_name << "] [" << this << "]");
   }
 
 #if 0
@@ -567,7 +1701,10 @@ class UsageDetector<utils::Vector<T, _Index, _Alloc>> : protected utils::Vector<
   // Destructor
   constexpr ~UsageDetector()
   {
-    DoutEntering(dc::usage_detector, libcwd::type_info_of<_UDBase>().demangled_name() << "::~Vector() [" << m_debug_name << "] [" << this << "]");
+    m_profile.print_summary(m_debug_name);
+    m_threads.print_summary(m_debug_name);
+    m_reallocations.print_summary(m_debug_name, _UDBase::size(), _UDBase::capacity());
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, libcwd::type_info_of<_UDBase>().demangled_name() << "::~Vector() [" << m_debug_name << "] [" << this << "]");
   }
 
 #if 0
@@ -594,345 +1731,399 @@ class UsageDetector<utils::Vector<T, _Index, _Alloc>> : protected utils::Vector<
 
   constexpr void assign(size_type count, T const& value)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".assign(" << count << ", " << value << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".assign(" << count << ", " << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::assign, *static_cast<_UDBase const*>(this));
     _UDBase::assign(count, value);
   }
 
   template<class InputIt>
   constexpr void assign(InputIt first, InputIt last)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".assign(" << first << ", " << last << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".assign(" << first << ", " << last << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::assign, *static_cast<_UDBase const*>(this));
     _UDBase::assign(first, last);
   }
 
   constexpr void assign(std::initializer_list<T> ilist)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".assign(" << ilist << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".assign(" << ilist << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::assign, *static_cast<_UDBase const*>(this));
     _UDBase::assign(ilist);
   }
 
   constexpr allocator_type get_allocator() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".get_allocator() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".get_allocator() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::get_allocator();
   }
 
   constexpr reference front()
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".front() [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".front() [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(0);
     return _UDBase::front();
   }
 
   constexpr const_reference front() const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".front() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".front() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_profile.read(0);
     return _UDBase::front();
   }
 
   constexpr reference back()
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".back() [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".back() [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(_UDBase::size() - 1);
     return _UDBase::back();
   }
 
   constexpr const_reference back() const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".back() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".back() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_profile.read(_UDBase::size() - 1);
     return _UDBase::back();
   }
 
   constexpr T* data() noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".data() [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".data() [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::data();
   }
 
   constexpr T const* data() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".data() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".data() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::data();
   }
 
   constexpr iterator begin() noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".begin() [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".begin() [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::begin();
   }
 
   constexpr const_iterator begin() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".begin() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".begin() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::begin();
   }
 
   constexpr const_iterator cbegin() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".cbegin() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".cbegin() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::cbegin();
   }
 
   constexpr iterator end() noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".end() [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".end() [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::end();
   }
 
   constexpr const_iterator end() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".end() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".end() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::end();
   }
 
   constexpr const_iterator cend() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".cend() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".cend() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::cend();
   }
 
   constexpr reverse_iterator rbegin() noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".rbegin() [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".rbegin() [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::rbegin();
   }
 
   constexpr const_reverse_iterator rbegin() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".rbegin() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".rbegin() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::rbegin();
   }
 
   constexpr const_reverse_iterator crbegin() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".crbegin() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".crbegin() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::crbegin();
   }
 
   constexpr reverse_iterator rend() noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".rend() [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".rend() [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::rend();
   }
 
   constexpr const_reverse_iterator rend() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".rend() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".rend() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::rend();
   }
 
   constexpr const_reverse_iterator crend() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".crend() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".crend() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::crend();
   }
 
   [[nodiscard]] constexpr bool empty() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".empty() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".empty() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::empty();
   }
 
   constexpr size_type size() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".size() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".size() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::size();
   }
 
   constexpr size_type max_size() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".max_size() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".max_size() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::max_size();
   }
 
   constexpr void reserve(size_type new_cap)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".reserve(" << new_cap << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".reserve(" << new_cap << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::reserve, *static_cast<_UDBase const*>(this));
     _UDBase::reserve(new_cap);
   }
 
   constexpr size_type capacity() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".capacity() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".capacity() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::capacity();
   }
 
   constexpr void shrink_to_fit()
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".shrink_to_fit() [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".shrink_to_fit() [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::shrink_to_fit, *static_cast<_UDBase const*>(this));
     _UDBase::shrink_to_fit();
   }
 
   constexpr void clear() noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".clear() [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".clear() [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
     _UDBase::clear();
   }
 
   constexpr iterator insert(const_iterator pos, T const& value)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << value << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::insert, *static_cast<_UDBase const*>(this));
     return _UDBase::insert(pos, value);
   }
 
   constexpr iterator insert(const_iterator pos, T&& value)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << value << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::insert, *static_cast<_UDBase const*>(this));
     return _UDBase::insert(pos, std::move(value));
   }
 
   template<class InputIt>
   constexpr iterator insert(const_iterator pos, InputIt first, InputIt last)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << first << ", " << last << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << first << ", " << last << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::insert, *static_cast<_UDBase const*>(this));
     return _UDBase::insert(pos, first, last);
   }
 
   constexpr iterator insert(const_iterator pos, std::initializer_list<T> ilist)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << ilist << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << ilist << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::insert, *static_cast<_UDBase const*>(this));
     return _UDBase::insert(pos, ilist);
   }
 
   template<class... Args>
   constexpr iterator emplace(const_iterator pos, Args&&... args)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".emplace(" << pos << ", " << join(", ", args...) << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".emplace(" << pos << ", " << join(", ", args...) << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::insert, *static_cast<_UDBase const*>(this));
     return _UDBase::emplace(pos, std::forward<Args>(args)...);
   }
 
   constexpr iterator erase(const_iterator pos)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".erase(" << pos << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".erase(" << pos << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
     return _UDBase::erase(pos);
   }
 
   constexpr iterator erase(const_iterator first, const_iterator last)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".erase(" << first << ", " << last << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".erase(" << first << ", " << last << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
     return _UDBase::erase(first, last);
   }
 
   constexpr void push_back(T const& value)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".push_back(" << value << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".push_back(" << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(_UDBase::size());
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::append, *static_cast<_UDBase const*>(this));
     _UDBase::push_back(value);
   }
 
   constexpr void push_back(T&& value)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".push_back(" << value << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".push_back(" << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(_UDBase::size());
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::append, *static_cast<_UDBase const*>(this));
     _UDBase::push_back(std::move(value));
   }
 
   template< class... Args >
   constexpr reference emplace_back(Args&&... args)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".emplace_back(" << join(", ", args...) << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".emplace_back(" << join(", ", args...) << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(_UDBase::size());
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::append, *static_cast<_UDBase const*>(this));
     return _UDBase::emplace_back(std::forward<Args>(args)...);
   }
 
   constexpr void pop_back()
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".pop_back() [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".pop_back() [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
     _UDBase::pop_back();
   }
 
   constexpr void resize(size_type count)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".resize(" << count << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".resize(" << count << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::resize, *static_cast<_UDBase const*>(this));
     _UDBase::resize(count);
   }
 
   constexpr void resize(size_type count, const value_type& value)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".resize(" << count << ", " << value << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".resize(" << count << ", " << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const reallocation_scope = m_reallocations.scope(VectorOperation::resize, *static_cast<_UDBase const*>(this));
     _UDBase::resize(count, value);
   }
 
   constexpr void swap(UsageDetector& other) noexcept(std::allocator_traits<_Alloc>::propagate_on_container_move_assignment::value)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".swap(" << other << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".swap(" << other << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
     _UDBase::swap(other);
   }
 
   reference operator[](index_type __n) _GLIBCXX_NOEXCEPT
   {
-    DoutEntering(dc::usage_detector, m_debug_name << "[" << __n << "] [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << "[" << __n << "] [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(__n.get_value());
     return _UDBase::operator[](__n);
   }
 
   const_reference operator[](index_type __n) const _GLIBCXX_NOEXCEPT
   {
-    DoutEntering(dc::usage_detector, m_debug_name << "[" << __n << "] [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << "[" << __n << "] [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_profile.read(__n.get_value());
     return _UDBase::operator[](__n);
   }
 
   reference at(index_type __n)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".at(" << __n << ") [" << this << "]");
-    return _UDBase::at(__n);
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".at(" << __n << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    reference result = _UDBase::at(__n);        // Throws if out of range; record the access afterwards.
+    m_profile.write(__n.get_value());
+    return result;
   }
 
   const_reference at(index_type __n) const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".at(" << __n << ") [" << this << "] READ-ACCESS");
-    return _UDBase::at(__n);
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".at(" << __n << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    const_reference result = _UDBase::at(__n);        // Throws if out of range; record the access afterwards.
+    m_profile.read(__n.get_value());
+    return result;
   }
 
   index_type ibegin() const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".ibegin() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".ibegin() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::ibegin();
   }
 
   index_type iend() const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".iend() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".iend() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::iend();
   }
 
   _UDBase const& base_class() const
   {
-    DoutEntering(dc::usage_detector, "base_class() [" << m_debug_name << "] [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, "base_class() [" << m_debug_name << "] [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return *(static_cast<_UDBase const*>(this));
   }
 };
 
-template<class Iter>
-struct IbpMap
-{
-  std::pair<Iter, bool> m_ibp;
-
-  Iter& first{m_ibp.first};
-  bool& second{m_ibp.second};
-
-  IbpMap(std::pair<Iter, bool> const& ibp) : m_ibp(ibp)
-  {
-    Dout(dc::usage_detector, "Creation of an ibp");
-  }
-
-  void operator=(std::pair<Iter, bool> const& ibp)
-  {
-    Dout(dc::usage_detector, "Assignment of an ibp");
-    m_ibp = ibp;
-  }
-};
-
-// Specialization for std::map.
-template<class Key, class T, class Compare, class Allocator>
-class UsageDetector<std::map<Key, T, Compare, Allocator>> : protected std::map<Key, T, Compare, Allocator>
+// Specialization for std::deque.
+template<class T, class Allocator>
+class UsageDetector<std::deque<T, Allocator>> : protected std::deque<T, Allocator>
 {
  private:
-  using _UDBase = std::map<Key, T, Compare, Allocator>;
-  using _ibp_t = IbpMap<typename _UDBase::iterator>;
+  using _UDBase = std::deque<T, Allocator>;
 
   char const* m_debug_name;
+  [[no_unique_address]] mutable ThreadProfile m_threads;                 // Only used in profile mode.
+  [[no_unique_address]] mutable UsageProfile<typename _UDBase::size_type, SequenceIndex> m_profile;   // Only used in profile mode.
 
  public:
-  using key_type = typename _UDBase::key_type;
-  using mapped_type = typename _UDBase::mapped_type;
-  using key_compare = typename _UDBase::key_compare;
-  using node_type = typename _UDBase::node_type;
-  using insert_return_type = typename _UDBase::insert_return_type;
   using value_type = typename _UDBase::value_type;
   using allocator_type = typename _UDBase::allocator_type;
   using size_type = typename _UDBase::size_type;
@@ -949,502 +2140,2394 @@ class UsageDetector<std::map<Key, T, Compare, Allocator>> : protected std::map<K
   // Constructors
   UsageDetector(char const* debug_name) : _UDBase(), m_debug_name(debug_name)
   {
-    DoutEntering(dc::usage_detector, libcwd::type_info_of<_UDBase>().demangled_name() << "::map() [" << debug_name << "] [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, libcwd::type_info_of<_UDBase>().demangled_name() << "::deque() [" << debug_name << "] [" << this << "]");
   }
 
   // Destructor
-  constexpr ~UsageDetector()
+  ~UsageDetector()
   {
-    DoutEntering(dc::usage_detector, libcwd::type_info_of<_UDBase>().demangled_name() << "::~map() [" << m_debug_name << "] [" << this << "]");
+    m_profile.print_summary(m_debug_name);
+    m_threads.print_summary(m_debug_name);
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, libcwd::type_info_of<_UDBase>().demangled_name() << "::~deque() [" << m_debug_name << "] [" << this << "]");
   }
 
-#if 0
-  constexpr UsageDetector& operator=(UsageDetector const& other)
+  UsageDetector& operator=(UsageDetector const& other) = delete;
+
+  void assign(size_type count, T const& value)
   {
-    _UDBase::operator=(other);
-    return *this;
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".assign(" << count << ", " << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    _UDBase::assign(count, value);
   }
 
-  constexpr UsageDetector& operator=(UsageDetector&& other) noexcept(std::allocator_traits<Allocator>::is_always_equal::value
-&& std::is_nothrow_move_assignable<Compare>::value)
+  template<class InputIt>
+  void assign(InputIt first, InputIt last)
   {
-    _UDBase::operator=(std::move(other));
-    return *this;
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".assign(" << first << ", " << last << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    _UDBase::assign(first, last);
   }
 
-  constexpr UsageDetector& operator=(std::initializer_list<T> ilist)
+  void assign(std::initializer_list<T> ilist)
   {
-    _UDBase::operator=(ilist);
-    return *this;
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".assign(" << ilist << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    _UDBase::assign(ilist);
   }
-#else
-  UsageDetector& operator=(UsageDetector const& other) = delete;
-#endif
 
   allocator_type get_allocator() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".get_allocator() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".get_allocator() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::get_allocator();
   }
 
-  T& at(size_type pos)
+  reference at(size_type pos)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".at(" << pos << ") [" << this << "]");
-    return _UDBase::at(pos);
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".at(" << pos << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    reference result = _UDBase::at(pos);        // Throws if out of range; record the access afterwards.
+    m_profile.write(pos);
+    return result;
   }
 
-  T const& at(size_type pos) const
+  const_reference at(size_type pos) const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".at(" << pos << ") [" << this << "] READ-ACCESS");
-    return _UDBase::at(pos);
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".at(" << pos << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    const_reference result = _UDBase::at(pos);        // Throws if out of range; record the access afterwards.
+    m_profile.read(pos);
+    return result;
   }
 
-  T& operator[](Key const& key)
+  reference operator[](size_type pos)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << "[" << key << "] [" << this << "]");
-    return _UDBase::operator[](key);
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << "[" << pos << "] [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(pos);
+    return _UDBase::operator[](pos);
   }
 
-  T& operator[](Key&& key)
+  const_reference operator[](size_type pos) const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << "[" << key << "] [" << this << "]");
-    return _UDBase::operator[](std::move(key));
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << "[" << pos << "] [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_profile.read(pos);
+    return _UDBase::operator[](pos);
+  }
+
+  reference front()
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".front() [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(0);
+    return _UDBase::front();
+  }
+
+  const_reference front() const
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".front() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_profile.read(0);
+    return _UDBase::front();
+  }
+
+  reference back()
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".back() [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(_UDBase::size() - 1);
+    return _UDBase::back();
+  }
+
+  const_reference back() const
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".back() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_profile.read(_UDBase::size() - 1);
+    return _UDBase::back();
   }
 
   iterator begin() noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".begin() [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".begin() [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::begin();
   }
 
   const_iterator begin() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".begin() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".begin() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::begin();
   }
 
   const_iterator cbegin() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".cbegin() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".cbegin() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::cbegin();
   }
 
   iterator end() noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".end() [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".end() [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::end();
   }
 
   const_iterator end() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".end() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".end() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::end();
   }
 
   const_iterator cend() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".cend() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".cend() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::cend();
   }
 
   reverse_iterator rbegin() noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".rbegin() [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".rbegin() [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::rbegin();
   }
 
   const_reverse_iterator rbegin() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".rbegin() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".rbegin() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::rbegin();
   }
 
   const_reverse_iterator crbegin() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".crbegin() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".crbegin() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::crbegin();
   }
 
   reverse_iterator rend() noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".rend() [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".rend() [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::rend();
   }
 
   const_reverse_iterator rend() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".rend() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".rend() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::rend();
   }
 
   const_reverse_iterator crend() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".crend() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".crend() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::crend();
   }
 
   [[nodiscard]] bool empty() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".empty() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".empty() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::empty();
   }
 
   size_type size() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".size() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".size() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::size();
   }
 
   size_type max_size() const noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".max_size() [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".max_size() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::max_size();
   }
 
+  void shrink_to_fit()
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".shrink_to_fit() [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    _UDBase::shrink_to_fit();
+  }
+
   void clear() noexcept
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".clear() [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".clear() [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
     _UDBase::clear();
   }
 
-  _ibp_t insert(value_type const& value)
+  iterator insert(const_iterator pos, T const& value)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".insert(" << value << ") [" << this << "]");
-    return _UDBase::insert(value);
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    return _UDBase::insert(pos, value);
   }
 
-  template<class P>
+  iterator insert(const_iterator pos, T&& value)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    return _UDBase::insert(pos, std::move(value));
+  }
+
+  iterator insert(const_iterator pos, size_type count, T const& value)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << count << ", " << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    return _UDBase::insert(pos, count, value);
+  }
+
+  template<class InputIt>
+  iterator insert(const_iterator pos, InputIt first, InputIt last)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << first << ", " << last << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    return _UDBase::insert(pos, first, last);
+  }
+
+  iterator insert(const_iterator pos, std::initializer_list<T> ilist)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << ilist << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    return _UDBase::insert(pos, ilist);
+  }
+
+  template<class... Args>
+  iterator emplace(const_iterator pos, Args&&... args)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".emplace(" << pos << ", " << join(", ", args...) << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    return _UDBase::emplace(pos, std::forward<Args>(args)...);
+  }
+
+  iterator erase(const_iterator pos)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".erase(" << pos << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    return _UDBase::erase(pos);
+  }
+
+  iterator erase(const_iterator first, const_iterator last)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".erase(" << first << ", " << last << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    return _UDBase::erase(first, last);
+  }
+
+  void push_back(T const& value)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".push_back(" << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(_UDBase::size());
+    _UDBase::push_back(value);
+  }
+
+  void push_back(T&& value)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".push_back(" << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(_UDBase::size());
+    _UDBase::push_back(std::move(value));
+  }
+
+  template<class... Args>
+  reference emplace_back(Args&&... args)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".emplace_back(" << join(", ", args...) << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(_UDBase::size());
+    return _UDBase::emplace_back(std::forward<Args>(args)...);
+  }
+
+  void pop_back()
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".pop_back() [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    _UDBase::pop_back();
+  }
+
+  void push_front(T const& value)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".push_front(" << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(0);
+    _UDBase::push_front(value);
+  }
+
+  void push_front(T&& value)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".push_front(" << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(0);
+    _UDBase::push_front(std::move(value));
+  }
+
+  template<class... Args>
+  reference emplace_front(Args&&... args)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".emplace_front(" << join(", ", args...) << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(0);
+    return _UDBase::emplace_front(std::forward<Args>(args)...);
+  }
+
+  void pop_front()
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".pop_front() [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    _UDBase::pop_front();
+  }
+
+  void resize(size_type count)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".resize(" << count << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    _UDBase::resize(count);
+  }
+
+  void resize(size_type count, value_type const& value)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".resize(" << count << ", " << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    _UDBase::resize(count, value);
+  }
+
+  void swap(UsageDetector& other) noexcept(std::allocator_traits<Allocator>::is_always_equal::value)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".swap(" << other << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    _UDBase::swap(other);
+  }
+
+  _UDBase const& base_class() const
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, "base_class() [" << m_debug_name << "] [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return *(static_cast<_UDBase const*>(this));
+  }
+};
+
+template<class Iter>
+struct IbpMap
+{
+  std::pair<Iter, bool> m_ibp;
+
+  Iter& first{m_ibp.first};
+  bool& second{m_ibp.second};
+
+  IbpMap(std::pair<Iter, bool> const& ibp) : m_ibp(ibp)
+  {
+    DoutIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, "Creation of an ibp");
+  }
+
+  void operator=(std::pair<Iter, bool> const& ibp)
+  {
+    DoutIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, "Assignment of an ibp");
+    m_ibp = ibp;
+  }
+};
+
+// Specialization for std::map.
+template<class Key, class T, class Compare, class Allocator>
+class UsageDetector<std::map<Key, T, Compare, Allocator>> : protected std::map<Key, T, Compare, Allocator>
+{
+ private:
+  using _UDBase = std::map<Key, T, Compare, Allocator>;
+  using _ibp_t = IbpMap<typename _UDBase::iterator>;
+
+  char const* m_debug_name;
+  [[no_unique_address]] mutable ThreadProfile m_threads;                 // Only used in profile mode.
+  [[no_unique_address]] mutable MapProfile m_operations;             // Only used in profile mode.
+  [[no_unique_address]] mutable UsageProfile<Key, Compare> m_profile;     // Only used in profile mode.
+
+ public:
+  using key_type = typename _UDBase::key_type;
+  using mapped_type = typename _UDBase::mapped_type;
+  using key_compare = typename _UDBase::key_compare;
+  using node_type = typename _UDBase::node_type;
+  using insert_return_type = typename _UDBase::insert_return_type;
+  using value_type = typename _UDBase::value_type;
+  using allocator_type = typename _UDBase::allocator_type;
+  using size_type = typename _UDBase::size_type;
+  using difference_type = typename _UDBase::difference_type;
+  using reference = typename _UDBase::reference;
+  using const_reference = typename _UDBase::const_reference;
+  using pointer = typename _UDBase::pointer;
+  using const_pointer = typename _UDBase::const_pointer;
+  using iterator = typename _UDBase::iterator;
+  using const_iterator = typename _UDBase::const_iterator;
+  using reverse_iterator = typename _UDBase::reverse_iterator;
+  using const_reverse_iterator = typename _UDBase::const_reverse_iterator;
+
+  // Constructors
+  UsageDetector(char const* debug_name) : _UDBase(), m_debug_name(debug_name)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, libcwd::type_info_of<_UDBase>().demangled_name() << "::map() [" << debug_name << "] [" << this << "]");
+  }
+
+  // Destructor
+  constexpr ~UsageDetector()
+  {
+    m_profile.print_summary(m_debug_name);
+    m_threads.print_summary(m_debug_name);
+    m_operations.print_recommendation(m_debug_name);
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, libcwd::type_info_of<_UDBase>().demangled_name() << "::~map() [" << m_debug_name << "] [" << this << "]");
+  }
+
+#if 0
+  constexpr UsageDetector& operator=(UsageDetector const& other)
+  {
+    _UDBase::operator=(other);
+    return *this;
+  }
+
+  constexpr UsageDetector& operator=(UsageDetector&& other) noexcept(std::allocator_traits<Allocator>::is_always_equal::value
+&& std::is_nothrow_move_assignable<Compare>::value)
+  {
+    _UDBase::operator=(std::move(other));
+    return *this;
+  }
+
+  constexpr UsageDetector& operator=(std::initializer_list<T> ilist)
+  {
+    _UDBase::operator=(ilist);
+    return *this;
+  }
+#else
+  UsageDetector& operator=(UsageDetector const& other) = delete;
+#endif
+
+  allocator_type get_allocator() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".get_allocator() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::get_allocator();
+  }
+
+  T& at(Key const& key)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".at(" << key << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(key);
+    m_operations.record(MapOperation::lookup, _UDBase::size());
+    return _UDBase::at(key);
+  }
+
+  T const& at(Key const& key) const
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".at(" << key << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_profile.read(key);
+    m_operations.record(MapOperation::lookup, _UDBase::size());
+    return _UDBase::at(key);
+  }
+
+  T& operator[](Key const& key)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << "[" << key << "] [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(key);
+    size_type const size = _UDBase::size();
+    T& result = _UDBase::operator[](key);
+    m_operations.record(_UDBase::size() == size ? MapOperation::lookup : MapOperation::insert, size);
+    return result;
+  }
+
+  T& operator[](Key&& key)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << "[" << key << "] [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(key);
+    size_type const size = _UDBase::size();
+    T& result = _UDBase::operator[](std::move(key));
+    m_operations.record(_UDBase::size() == size ? MapOperation::lookup : MapOperation::insert, size);
+    return result;
+  }
+
+  iterator begin() noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".begin() [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
+    m_operations.record(MapOperation::iterate, _UDBase::size());
+    return _UDBase::begin();
+  }
+
+  const_iterator begin() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".begin() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_operations.record(MapOperation::iterate, _UDBase::size());
+    return _UDBase::begin();
+  }
+
+  const_iterator cbegin() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".cbegin() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_operations.record(MapOperation::iterate, _UDBase::size());
+    return _UDBase::cbegin();
+  }
+
+  iterator end() noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".end() [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::end();
+  }
+
+  const_iterator end() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".end() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::end();
+  }
+
+  const_iterator cend() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".cend() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::cend();
+  }
+
+  reverse_iterator rbegin() noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".rbegin() [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
+    m_operations.record(MapOperation::iterate, _UDBase::size());
+    return _UDBase::rbegin();
+  }
+
+  const_reverse_iterator rbegin() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".rbegin() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_operations.record(MapOperation::iterate, _UDBase::size());
+    return _UDBase::rbegin();
+  }
+
+  const_reverse_iterator crbegin() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".crbegin() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_operations.record(MapOperation::iterate, _UDBase::size());
+    return _UDBase::crbegin();
+  }
+
+  reverse_iterator rend() noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".rend() [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::rend();
+  }
+
+  const_reverse_iterator rend() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".rend() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::rend();
+  }
+
+  const_reverse_iterator crend() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".crend() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::crend();
+  }
+
+  [[nodiscard]] bool empty() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".empty() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::empty();
+  }
+
+  size_type size() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".size() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::size();
+  }
+
+  size_type max_size() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".max_size() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::max_size();
+  }
+
+  void clear() noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".clear() [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    _UDBase::clear();
+  }
+
+  _ibp_t insert(value_type const& value)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(value.first);
+    size_type const size = _UDBase::size();
+    auto const result = _UDBase::insert(value);
+    m_operations.record(_UDBase::size() == size ? MapOperation::lookup : MapOperation::insert, size);
+    return result;
+  }
+
+  template<class P>
+  _ibp_t insert(P&& value)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    size_type const size = _UDBase::size();
+    auto const result = _UDBase::insert(std::forward<P>(value));
+    m_profile.write(result.first->first);
+    m_operations.record(_UDBase::size() == size ? MapOperation::lookup : MapOperation::insert, size);
+    return result;
+  }
+
+  _ibp_t insert(value_type&& value)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(value.first);
+    size_type const size = _UDBase::size();
+    auto const result = _UDBase::insert(std::move(value));
+    m_operations.record(_UDBase::size() == size ? MapOperation::lookup : MapOperation::insert, size);
+    return result;
+  }
+
+  iterator insert(const_iterator pos, value_type const& value)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(value.first);
+    size_type const size = _UDBase::size();
+    auto const result = _UDBase::insert(pos, value);
+    m_operations.record(_UDBase::size() == size ? MapOperation::lookup : MapOperation::insert, size);
+    return result;
+  }
+
+  template<class P>
+  iterator insert(const_iterator pos, P&& value)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    size_type const size = _UDBase::size();
+    iterator const result = _UDBase::insert(pos, std::forward<P>(value));
+    m_profile.write(result->first);
+    m_operations.record(_UDBase::size() == size ? MapOperation::lookup : MapOperation::insert, size);
+    return result;
+  }
+
+  iterator insert(const_iterator pos, value_type&& value)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(value.first);
+    size_type const size = _UDBase::size();
+    auto const result = _UDBase::insert(pos, std::move(value));
+    m_operations.record(_UDBase::size() == size ? MapOperation::lookup : MapOperation::insert, size);
+    return result;
+  }
+
+  template<class InputIt>
+  void insert(InputIt first, InputIt last)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << first << ", " << last << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    size_type const size = _UDBase::size();
+    // Insert one by one (with the same hint as the range insert uses), so that each key can be recorded.
+    for (; first != last; ++first)
+      m_profile.write(_UDBase::insert(_UDBase::cend(), *first)->first);
+    m_operations.record(_UDBase::size() == size ? MapOperation::lookup : MapOperation::insert, size);
+  }
+
+  void insert(std::initializer_list<value_type> ilist)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << ilist << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    size_type const size = _UDBase::size();
+    for (value_type const& value : ilist)
+      m_profile.write(value.first);
+    _UDBase::insert(ilist);
+    m_operations.record(_UDBase::size() == size ? MapOperation::lookup : MapOperation::insert, size);
+  }
+
+  insert_return_type insert(node_type&& nh)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << nh << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    size_type const size = _UDBase::size();
+    insert_return_type result = _UDBase::insert(std::move(nh));
+    if (result.position != _UDBase::end())     // nh was empty.
+      m_profile.write(result.position->first);
+    m_operations.record(_UDBase::size() == size ? MapOperation::lookup : MapOperation::insert, size);
+    return result;
+  }
+
+  iterator insert(const_iterator pos, node_type&& nh)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << nh << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    size_type const size = _UDBase::size();
+    iterator const result = _UDBase::insert(pos, std::move(nh));
+    if (result != _UDBase::end())               // nh was empty.
+      m_profile.write(result->first);
+    m_operations.record(_UDBase::size() == size ? MapOperation::lookup : MapOperation::insert, size);
+    return result;
+  }
+
+  template<class M>
+  _ibp_t insert_or_assign(Key const& k, M&& obj)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert_or_assign(" << k << ", " << obj << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(k);
+    size_type const size = _UDBase::size();
+    auto const result = _UDBase::insert_or_assign(k, std::move(obj));
+    m_operations.record(_UDBase::size() == size ? MapOperation::lookup : MapOperation::insert, size);
+    return result;
+  }
+
+  template<class M>
+  _ibp_t insert_or_assign(Key&& k, M&& obj)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert_or_assign(" << k << ", " << obj << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(k);
+    size_type const size = _UDBase::size();
+    auto const result = _UDBase::insert_or_assign(std::move(k), std::move(obj));
+    m_operations.record(_UDBase::size() == size ? MapOperation::lookup : MapOperation::insert, size);
+    return result;
+  }
+
+  template<class M>
+  iterator insert_or_assign(const_iterator hint, Key const& k, M&& obj)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert_or_assign(" << hint << ", " << k << ", " << obj << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(k);
+    size_type const size = _UDBase::size();
+    auto const result = _UDBase::insert_or_assign(hint, k, std::move(obj));
+    m_operations.record(_UDBase::size() == size ? MapOperation::lookup : MapOperation::insert, size);
+    return result;
+  }
+
+  template<class M>
+  iterator insert_or_assign(const_iterator hint, Key&& k, M&& obj)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert_or_assign(" << hint << ", " << k << ", " << obj << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(k);
+    size_type const size = _UDBase::size();
+    auto const result = _UDBase::insert_or_assign(hint, std::move(k), std::move(obj));
+    m_operations.record(_UDBase::size() == size ? MapOperation::lookup : MapOperation::insert, size);
+    return result;
+  }
+
+  template<class... Args>
+  _ibp_t emplace(Args&&... args)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".emplace(" << join(", ", args...) << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    size_type const size = _UDBase::size();
+    auto const result = _UDBase::emplace(std::forward<Args>(args)...);
+    m_profile.write(result.first->first);
+    m_operations.record(_UDBase::size() == size ? MapOperation::lookup : MapOperation::insert, size);
+    return result;
+  }
+
+  template<class... Args>
+  iterator emplace_hint(const_iterator hint, Args&&... args)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".emplace_hint(" << hint << ", " << join(", ", args...) << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    size_type const size = _UDBase::size();
+    iterator const result = _UDBase::emplace_hint(hint, std::forward<Args>(args)...);
+    m_profile.write(result->first);
+    m_operations.record(_UDBase::size() == size ? MapOperation::lookup : MapOperation::insert, size);
+    return result;
+  }
+
+  template<class... Args>
+  _ibp_t try_emplace(Key const& k, Args&&... args)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".try_emplace(" << k << ", " << join(", ", args...) << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(k);
+    size_type const size = _UDBase::size();
+    auto const result = _UDBase::try_emplace(k, std::forward<Args>(args)...);
+    m_operations.record(_UDBase::size() == size ? MapOperation::lookup : MapOperation::insert, size);
+    return result;
+  }
+
+  template<class... Args>
+  _ibp_t try_emplace(Key&& k, Args&&... args)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".try_emplace(" << k << ", " << join(", ", args...) << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(k);
+    size_type const size = _UDBase::size();
+    auto const result = _UDBase::try_emplace(std::move(k), std::forward<Args>(args)...);
+    m_operations.record(_UDBase::size() == size ? MapOperation::lookup : MapOperation::insert, size);
+    return result;
+  }
+
+  template<class... Args>
+  iterator try_emplace(const_iterator hint, Key const& k, Args&&... args)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".try_emplace(" << hint << ", " << k << ", " << join(", ", args...) << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(k);
+    size_type const size = _UDBase::size();
+    auto const result = _UDBase::try_emplace(hint, k, std::forward<Args>(args)...);
+    m_operations.record(_UDBase::size() == size ? MapOperation::lookup : MapOperation::insert, size);
+    return result;
+  }
+
+  template<class... Args>
+  iterator try_emplace(const_iterator hint, Key&& k, Args&&... args)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".try_emplace(" << hint << ", " << k << ", " << join(", ", args...) << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(k);
+    size_type const size = _UDBase::size();
+    auto const result = _UDBase::try_emplace(hint, k, std::forward<Args>(args)...);
+    m_operations.record(_UDBase::size() == size ? MapOperation::lookup : MapOperation::insert, size);
+    return result;
+  }
+
+  iterator erase(iterator pos)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".erase(" << pos << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(pos->first);
+    m_operations.record(MapOperation::erase, _UDBase::size());
+    return _UDBase::erase(pos);
+  }
+
+  iterator erase(const_iterator pos)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".erase(" << pos << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(pos->first);
+    m_operations.record(MapOperation::erase, _UDBase::size());
+    return _UDBase::erase(pos);
+  }
+
+  iterator erase(const_iterator first, const_iterator last)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".erase(" << first << ", " << last << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    for (const_iterator element = first; element != last; ++element)
+      m_profile.write(element->first);
+    m_operations.record(MapOperation::erase, _UDBase::size());
+    return _UDBase::erase(first, last);
+  }
+
+  size_type erase(Key const& key)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".erase(" << key << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(key);
+    m_operations.record(MapOperation::erase, _UDBase::size());
+    return _UDBase::erase(key);
+  }
+
+  void swap(UsageDetector& other) noexcept(std::allocator_traits<Allocator>::is_always_equal::value && std::is_nothrow_swappable<Compare>::value)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".swap(" << other << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    _UDBase::swap(other);
+  }
+
+  node_type extract(const_iterator position)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".extract(" << position << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(position->first);
+    m_operations.record(MapOperation::erase, _UDBase::size());
+    return _UDBase::extract(position);
+  }
+
+  node_type extract(Key const& k)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".extract(" << k << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(k);
+    m_operations.record(MapOperation::erase, _UDBase::size());
+    return _UDBase::extract(k);
+  }
+
+  template<class C2>
+  void merge(UsageDetector<std::map<Key, T, C2, Allocator>>& source)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".merge(" << source << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_operations.record(MapOperation::merge, _UDBase::size());
+    _UDBase::merge(source.base_class());
+  }
+
+  template<class C2>
+  void merge(UsageDetector<std::map<Key, T, C2, Allocator>>&& source)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".merge(" << source << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_operations.record(MapOperation::merge, _UDBase::size());
+    _UDBase::merge(std::move(source).base_class());
+  }
+
+#if 0
+  template<class C2>
+  void merge(std::multimap<Key, T, C2, Allocator>& source)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << "merge(" << source << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_operations.record(MapOperation::merge, _UDBase::size());
+    _UDBase::merge(source);
+  }
+
+  template<class C2>
+  void merge(std::multimap<Key, T, C2, Allocator>&& source)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".merge(" << source << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_operations.record(MapOperation::merge, _UDBase::size());
+    _UDBase::merge(std::move(source));
+  }
+#endif
+
+  size_type count(Key const& key) const
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".count(" << key << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_profile.read(key);
+    m_operations.record(MapOperation::lookup, _UDBase::size());
+    return _UDBase::count(key);
+  }
+
+  template<class K>
+  size_type count(K const& x) const
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".count(" << x << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_operations.record(MapOperation::lookup, _UDBase::size());
+    return _UDBase::count(x);
+  }
+
+  iterator find(Key const& key)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".find(" << key << ") [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
+    m_profile.read(key);
+    m_operations.record(MapOperation::lookup, _UDBase::size());
+    return _UDBase::find(key);
+  }
+
+  const_iterator find(Key const& key) const
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".find(" << key << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_profile.read(key);
+    m_operations.record(MapOperation::lookup, _UDBase::size());
+    return _UDBase::find(key);
+  }
+
+  template<class K>
+  iterator find(K const& x)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".find(" << x << ") [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
+    m_operations.record(MapOperation::lookup, _UDBase::size());
+    return _UDBase::find(x);
+  }
+
+  template<class K>
+  const_iterator find(K const& x) const
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".find(" << x << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_operations.record(MapOperation::lookup, _UDBase::size());
+    return _UDBase::find(x);
+  }
+
+  bool contains(Key const& key) const
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".contains(" << key << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_profile.read(key);
+    m_operations.record(MapOperation::lookup, _UDBase::size());
+    return _UDBase::contains(key);
+  }
+
+  template<class K>
+  bool contains(K const& x) const
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".contains(" << x << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_operations.record(MapOperation::lookup, _UDBase::size());
+    return _UDBase::contains(x);
+  }
+
+  std::pair<iterator,iterator> equal_range(Key const& key)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".equal_range(" << key << ") [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
+    m_operations.record(MapOperation::ordered, _UDBase::size());
+    return _UDBase::equal_range(key);
+  }
+
+  std::pair<const_iterator,const_iterator> equal_range(Key const& key) const
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".equal_range(" << key << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_operations.record(MapOperation::ordered, _UDBase::size());
+    return _UDBase::equal_range(key);
+  }
+
+  template<class K>
+  std::pair<iterator,iterator> equal_range(K const& x)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".equal_range(" << x << ") [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
+    m_operations.record(MapOperation::ordered, _UDBase::size());
+    return _UDBase::equal_range(x);
+  }
+
+  template<class K>
+  std::pair<const_iterator,const_iterator> equal_range(K const& x) const
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".equal_range(" << x << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_operations.record(MapOperation::ordered, _UDBase::size());
+    return _UDBase::equal_range(x);
+  }
+
+  iterator lower_bound(Key const& key)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".lower_bound(" << key << ") [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
+    m_operations.record(MapOperation::ordered, _UDBase::size());
+    return _UDBase::lower_bound(key);
+  }
+
+  const_iterator lower_bound(Key const& key) const
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".lower_bound(" << key << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_operations.record(MapOperation::ordered, _UDBase::size());
+    return _UDBase::lower_bound(key);
+  }
+
+  template<class K>
+  iterator lower_bound(K const& x)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".lower_bound(" << x << ") [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
+    m_operations.record(MapOperation::ordered, _UDBase::size());
+    return _UDBase::lower_bound(x);
+  }
+
+  template<class K>
+  const_iterator lower_bound(K const& x) const
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".lower_bound(" << x << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_operations.record(MapOperation::ordered, _UDBase::size());
+    return _UDBase::lower_bound(x);
+  }
+
+  iterator upper_bound(Key const& key)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".upper_bound(" << key << ") [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
+    m_operations.record(MapOperation::ordered, _UDBase::size());
+    return _UDBase::upper_bound(key);
+  }
+
+  const_iterator upper_bound(Key const& key) const
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".upper_bound(" << key << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_operations.record(MapOperation::ordered, _UDBase::size());
+    return _UDBase::upper_bound(key);
+  }
+
+  template<class K>
+  iterator upper_bound(K const& x)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".upper_bound(" << x << ") [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
+    m_operations.record(MapOperation::ordered, _UDBase::size());
+    return _UDBase::upper_bound(x);
+  }
+
+  template<class K>
+  const_iterator upper_bound(K const& x) const
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".upper_bound(" << x << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_operations.record(MapOperation::ordered, _UDBase::size());
+    return _UDBase::upper_bound(x);
+  }
+
+  _UDBase const& base_class() const
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, "base_class() [" << m_debug_name << "] [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return *(static_cast<_UDBase const*>(this));
+  }
+
+  char const* debug_name() const
+  {
+    return m_debug_name;
+  }
+};
+
+template<class Key, class T, class Compare, class Alloc>
+void swap(UsageDetector<std::map<Key, T, Compare, Alloc>>& lhs,
+          UsageDetector<std::map<Key, T, Compare, Alloc>>& rhs) noexcept(noexcept(lhs.swap(rhs)))
+{
+  DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, "swap(" << lhs.debug_name() << " [" << &lhs << "], " << rhs.debug_name() << " [" << &rhs << "])");
+  std::swap(lhs.base_class(), rhs.base_class());
+}
+
+template<class Key, class T, class Compare, class Alloc, class Pred>
+typename std::map<Key, T, Compare, Alloc>::size_type erase_if(UsageDetector<std::map<Key, T, Compare, Alloc>>& c, Pred pred)
+{
+  DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, "erase_if(" << c.debug_name() << " [" << &c << "], pred)");
+  return std::erase_if(c.base_class(), pred);
+}
+
+// Specialization for std::unordered_map.
+template<class Key, class T, class Hash, class KeyEqual, class Allocator>
+class UsageDetector<std::unordered_map<Key, T, Hash, KeyEqual, Allocator>> : protected std::unordered_map<Key, T, Hash, KeyEqual, Allocator>
+{
+ private:
+  using _UDBase = std::unordered_map<Key, T, Hash, KeyEqual, Allocator>;
+  using _ibp_t = IbpMap<typename _UDBase::iterator>;
+
+  template<typename> friend class UsageDetector;      // For merge.
+
+  char const* m_debug_name;
+  [[no_unique_address]] mutable ThreadProfile m_threads;                 // Only used in profile mode.
+  [[no_unique_address]] mutable HashProfile m_hash;                         // Only used in profile mode.
+  [[no_unique_address]] mutable UsageProfile<Key, KeyEqual, Hash> m_profile;  // Only used in profile mode.
+
+ public:
+  using key_type = typename _UDBase::key_type;
+  using mapped_type = typename _UDBase::mapped_type;
+  using hasher = typename _UDBase::hasher;
+  using key_equal = typename _UDBase::key_equal;
+  using node_type = typename _UDBase::node_type;
+  using insert_return_type = typename _UDBase::insert_return_type;
+  using value_type = typename _UDBase::value_type;
+  using allocator_type = typename _UDBase::allocator_type;
+  using size_type = typename _UDBase::size_type;
+  using difference_type = typename _UDBase::difference_type;
+  using reference = typename _UDBase::reference;
+  using const_reference = typename _UDBase::const_reference;
+  using pointer = typename _UDBase::pointer;
+  using const_pointer = typename _UDBase::const_pointer;
+  using iterator = typename _UDBase::iterator;
+  using const_iterator = typename _UDBase::const_iterator;
+  using local_iterator = typename _UDBase::local_iterator;
+  using const_local_iterator = typename _UDBase::const_local_iterator;
+
+  // Constructors
+  UsageDetector(char const* debug_name) : _UDBase(), m_debug_name(debug_name)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, libcwd::type_info_of<_UDBase>().demangled_name() << "::unordered_map() [" << debug_name << "] [" << this << "]");
+  }
+
+  // Destructor
+  ~UsageDetector()
+  {
+    m_profile.print_summary(m_debug_name);
+    m_threads.print_summary(m_debug_name);
+    m_hash.print_summary(m_debug_name, *static_cast<_UDBase const*>(this));
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, libcwd::type_info_of<_UDBase>().demangled_name() << "::~unordered_map() [" << m_debug_name << "] [" << this << "]");
+  }
+
+  UsageDetector& operator=(UsageDetector const& other) = delete;
+
+  allocator_type get_allocator() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".get_allocator() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::get_allocator();
+  }
+
+  iterator begin() noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".begin() [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::begin();
+  }
+
+  const_iterator begin() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".begin() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::begin();
+  }
+
+  const_iterator cbegin() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".cbegin() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::cbegin();
+  }
+
+  iterator end() noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".end() [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::end();
+  }
+
+  const_iterator end() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".end() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::end();
+  }
+
+  const_iterator cend() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".cend() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::cend();
+  }
+
+  [[nodiscard]] bool empty() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".empty() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::empty();
+  }
+
+  size_type size() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".size() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::size();
+  }
+
+  size_type max_size() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".max_size() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::max_size();
+  }
+
+  void clear() noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".clear() [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    _UDBase::clear();
+  }
+
+  _ibp_t insert(value_type const& value)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(value.first);
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    return _UDBase::insert(value);
+  }
+
+  _ibp_t insert(value_type&& value)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(value.first);
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    return _UDBase::insert(std::move(value));
+  }
+
+  template<class P>
   _ibp_t insert(P&& value)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".insert(" << value << ") [" << this << "]");
-    return _UDBase::insert(std::move(value));
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    auto const result = _UDBase::insert(std::forward<P>(value));
+    m_profile.write(result.first->first);
+    return result;
+  }
+
+  iterator insert(const_iterator hint, value_type const& value)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << hint << ", " << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(value.first);
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    return _UDBase::insert(hint, value);
+  }
+
+  iterator insert(const_iterator hint, value_type&& value)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << hint << ", " << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(value.first);
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    return _UDBase::insert(hint, std::move(value));
+  }
+
+  template<class P>
+  iterator insert(const_iterator hint, P&& value)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << hint << ", " << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    iterator const result = _UDBase::insert(hint, std::forward<P>(value));
+    m_profile.write(result->first);
+    return result;
+  }
+
+  template<class InputIt>
+  void insert(InputIt first, InputIt last)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << first << ", " << last << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    // Insert one by one (with the same hint as the range insert uses), so that each key can be recorded.
+    for (; first != last; ++first)
+      m_profile.write(_UDBase::insert(_UDBase::cend(), *first)->first);
+  }
+
+  void insert(std::initializer_list<value_type> ilist)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << ilist << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    for (value_type const& value : ilist)
+      m_profile.write(value.first);
+    _UDBase::insert(ilist);
+  }
+
+  insert_return_type insert(node_type&& nh)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << nh << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    insert_return_type result = _UDBase::insert(std::move(nh));
+    if (result.position != _UDBase::end())     // nh was empty.
+      m_profile.write(result.position->first);
+    return result;
+  }
+
+  iterator insert(const_iterator hint, node_type&& nh)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << hint << ", " << nh << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    iterator const result = _UDBase::insert(hint, std::move(nh));
+    if (result != _UDBase::end())               // nh was empty.
+      m_profile.write(result->first);
+    return result;
+  }
+
+  template<class M>
+  _ibp_t insert_or_assign(Key const& k, M&& obj)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert_or_assign(" << k << ", " << obj << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(k);
+    m_hash.lookup(*static_cast<_UDBase const*>(this), k);
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    return _UDBase::insert_or_assign(k, std::forward<M>(obj));
+  }
+
+  template<class M>
+  _ibp_t insert_or_assign(Key&& k, M&& obj)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert_or_assign(" << k << ", " << obj << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(k);
+    m_hash.lookup(*static_cast<_UDBase const*>(this), k);
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    return _UDBase::insert_or_assign(std::move(k), std::forward<M>(obj));
+  }
+
+  template<class M>
+  iterator insert_or_assign(const_iterator hint, Key const& k, M&& obj)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert_or_assign(" << hint << ", " << k << ", " << obj << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(k);
+    m_hash.lookup(*static_cast<_UDBase const*>(this), k);
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    return _UDBase::insert_or_assign(hint, k, std::forward<M>(obj));
+  }
+
+  template<class M>
+  iterator insert_or_assign(const_iterator hint, Key&& k, M&& obj)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert_or_assign(" << hint << ", " << k << ", " << obj << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(k);
+    m_hash.lookup(*static_cast<_UDBase const*>(this), k);
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    return _UDBase::insert_or_assign(hint, std::move(k), std::forward<M>(obj));
+  }
+
+  template<class... Args>
+  _ibp_t emplace(Args&&... args)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".emplace(" << join(", ", args...) << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    auto const result = _UDBase::emplace(std::forward<Args>(args)...);
+    m_profile.write(result.first->first);
+    return result;
+  }
+
+  template<class... Args>
+  iterator emplace_hint(const_iterator hint, Args&&... args)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".emplace_hint(" << hint << ", " << join(", ", args...) << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    iterator const result = _UDBase::emplace_hint(hint, std::forward<Args>(args)...);
+    m_profile.write(result->first);
+    return result;
+  }
+
+  template<class... Args>
+  _ibp_t try_emplace(Key const& k, Args&&... args)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".try_emplace(" << k << ", " << join(", ", args...) << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(k);
+    m_hash.lookup(*static_cast<_UDBase const*>(this), k);
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    return _UDBase::try_emplace(k, std::forward<Args>(args)...);
+  }
+
+  template<class... Args>
+  _ibp_t try_emplace(Key&& k, Args&&... args)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".try_emplace(" << k << ", " << join(", ", args...) << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(k);
+    m_hash.lookup(*static_cast<_UDBase const*>(this), k);
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    return _UDBase::try_emplace(std::move(k), std::forward<Args>(args)...);
+  }
+
+  template<class... Args>
+  iterator try_emplace(const_iterator hint, Key const& k, Args&&... args)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".try_emplace(" << hint << ", " << k << ", " << join(", ", args...) << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(k);
+    m_hash.lookup(*static_cast<_UDBase const*>(this), k);
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    return _UDBase::try_emplace(hint, k, std::forward<Args>(args)...);
+  }
+
+  template<class... Args>
+  iterator try_emplace(const_iterator hint, Key&& k, Args&&... args)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".try_emplace(" << hint << ", " << k << ", " << join(", ", args...) << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(k);
+    m_hash.lookup(*static_cast<_UDBase const*>(this), k);
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    return _UDBase::try_emplace(hint, std::move(k), std::forward<Args>(args)...);
+  }
+
+  iterator erase(iterator pos)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".erase(" << pos << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(pos->first);
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    return _UDBase::erase(pos);
+  }
+
+  iterator erase(const_iterator pos)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".erase(" << pos << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(pos->first);
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    return _UDBase::erase(pos);
+  }
+
+  iterator erase(const_iterator first, const_iterator last)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".erase(" << first << ", " << last << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    for (const_iterator element = first; element != last; ++element)
+      m_profile.write(element->first);
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    return _UDBase::erase(first, last);
+  }
+
+  size_type erase(Key const& key)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".erase(" << key << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(key);
+    m_hash.lookup(*static_cast<_UDBase const*>(this), key);
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    return _UDBase::erase(key);
+  }
+
+  void swap(UsageDetector& other) noexcept(std::allocator_traits<Allocator>::is_always_equal::value &&
+      std::is_nothrow_swappable<Hash>::value && std::is_nothrow_swappable<KeyEqual>::value)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".swap(" << other << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    _UDBase::swap(other);
+  }
+
+  node_type extract(const_iterator position)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".extract(" << position << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(position->first);
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    return _UDBase::extract(position);
+  }
+
+  node_type extract(Key const& k)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".extract(" << k << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(k);
+    m_hash.lookup(*static_cast<_UDBase const*>(this), k);
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    return _UDBase::extract(k);
+  }
+
+  template<class H2, class P2>
+  void merge(UsageDetector<std::unordered_map<Key, T, H2, P2, Allocator>>& source)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".merge(" << source << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    _UDBase::merge(static_cast<typename UsageDetector<std::unordered_map<Key, T, H2, P2, Allocator>>::_UDBase&>(source));
+  }
+
+  template<class H2, class P2>
+  void merge(UsageDetector<std::unordered_map<Key, T, H2, P2, Allocator>>&& source)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".merge(" << source << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    _UDBase::merge(static_cast<typename UsageDetector<std::unordered_map<Key, T, H2, P2, Allocator>>::_UDBase&&>(source));
+  }
+
+  T& at(Key const& key)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".at(" << key << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(key);
+    m_hash.lookup(*static_cast<_UDBase const*>(this), key);
+    return _UDBase::at(key);
+  }
+
+  T const& at(Key const& key) const
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".at(" << key << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_profile.read(key);
+    m_hash.lookup(*static_cast<_UDBase const*>(this), key);
+    return _UDBase::at(key);
+  }
+
+  T& operator[](Key const& key)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << "[" << key << "] [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(key);
+    m_hash.lookup(*static_cast<_UDBase const*>(this), key);
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    return _UDBase::operator[](key);
+  }
+
+  T& operator[](Key&& key)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << "[" << key << "] [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(key);
+    m_hash.lookup(*static_cast<_UDBase const*>(this), key);
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    return _UDBase::operator[](std::move(key));
+  }
+
+  size_type count(Key const& key) const
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".count(" << key << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_profile.read(key);
+    m_hash.lookup(*static_cast<_UDBase const*>(this), key);
+    return _UDBase::count(key);
+  }
+
+  template<class K>
+  size_type count(K const& x) const
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".count(" << x << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::count(x);
+  }
+
+  iterator find(Key const& key)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".find(" << key << ") [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
+    m_profile.read(key);
+    m_hash.lookup(*static_cast<_UDBase const*>(this), key);
+    return _UDBase::find(key);
+  }
+
+  const_iterator find(Key const& key) const
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".find(" << key << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_profile.read(key);
+    m_hash.lookup(*static_cast<_UDBase const*>(this), key);
+    return _UDBase::find(key);
+  }
+
+  template<class K>
+  iterator find(K const& x)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".find(" << x << ") [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::find(x);
+  }
+
+  template<class K>
+  const_iterator find(K const& x) const
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".find(" << x << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::find(x);
+  }
+
+  bool contains(Key const& key) const
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".contains(" << key << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_profile.read(key);
+    m_hash.lookup(*static_cast<_UDBase const*>(this), key);
+    return _UDBase::contains(key);
+  }
+
+  template<class K>
+  bool contains(K const& x) const
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".contains(" << x << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::contains(x);
+  }
+
+  std::pair<iterator,iterator> equal_range(Key const& key)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".equal_range(" << key << ") [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
+    m_profile.read(key);
+    m_hash.lookup(*static_cast<_UDBase const*>(this), key);
+    return _UDBase::equal_range(key);
+  }
+
+  std::pair<const_iterator,const_iterator> equal_range(Key const& key) const
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".equal_range(" << key << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_profile.read(key);
+    m_hash.lookup(*static_cast<_UDBase const*>(this), key);
+    return _UDBase::equal_range(key);
+  }
+
+  template<class K>
+  std::pair<iterator,iterator> equal_range(K const& x)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".equal_range(" << x << ") [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::equal_range(x);
+  }
+
+  template<class K>
+  std::pair<const_iterator,const_iterator> equal_range(K const& x) const
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".equal_range(" << x << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::equal_range(x);
+  }
+
+  local_iterator begin(size_type n)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".begin(" << n << ") [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::begin(n);
   }
 
-  _ibp_t insert(value_type&& value)
+  const_local_iterator begin(size_type n) const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".insert(" << value << ") [" << this << "]");
-    return _UDBase::insert(std::move(value));
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".begin(" << n << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::begin(n);
   }
 
-  iterator insert(const_iterator pos, value_type const& value)
+  const_local_iterator cbegin(size_type n) const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << value << ") [" << this << "]");
-    return _UDBase::insert(pos, value);
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".cbegin(" << n << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::cbegin(n);
   }
 
-  template<class P>
-  iterator insert(const_iterator pos, P&& value)
+  local_iterator end(size_type n)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << value << ") [" << this << "]");
-    return _UDBase::insert(pos, std::move(value));
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".end(" << n << ") [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::end(n);
   }
 
-  iterator insert(const_iterator pos, value_type&& value)
+  const_local_iterator end(size_type n) const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << value << ") [" << this << "]");
-    return _UDBase::insert(pos, std::move(value));
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".end(" << n << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::end(n);
   }
 
-  template<class InputIt>
-  void insert(InputIt first, InputIt last)
+  const_local_iterator cend(size_type n) const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".insert(" << first << ", " << last << ") [" << this << "]");
-    _UDBase::insert(first, last);
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".cend(" << n << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::cend(n);
   }
 
-  void insert(std::initializer_list<value_type> ilist)
+  size_type bucket_count() const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".insert(" << ilist << ") [" << this << "]");
-    _UDBase::insert(ilist);
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".bucket_count() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::bucket_count();
   }
 
-  insert_return_type insert(node_type&& nh)
+  size_type max_bucket_count() const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".insert(" << nh << ") [" << this << "]");
-    return _UDBase::insert(std::move(nh));
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".max_bucket_count() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::max_bucket_count();
   }
 
-  iterator insert(const_iterator pos, node_type&& nh)
+  size_type bucket_size(size_type n) const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << nh << ") [" << this << "]");
-    return _UDBase::insert(pos, std::move(nh));
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".bucket_size(" << n << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::bucket_size(n);
   }
 
-  template<class M>
-  _ibp_t insert_or_assign(Key const& k, M&& obj)
+  size_type bucket(Key const& key) const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".insert_or_assign(" << k << ", " << obj << ") [" << this << "]");
-    return _UDBase::insert_or_assign(k, std::move(obj));
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".bucket(" << key << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::bucket(key);
   }
 
-  template<class M>
-  _ibp_t insert_or_assign(Key&& k, M&& obj)
+  float load_factor() const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".insert_or_assign(" << k << ", " << obj << ") [" << this << "]");
-    return _UDBase::insert_or_assign(std::move(k), std::move(obj));
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".load_factor() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::load_factor();
   }
 
-  template<class M>
-  iterator insert_or_assign(const_iterator hint, Key const& k, M&& obj)
+  float max_load_factor() const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".insert_or_assign(" << hint << ", " << k << ", " << obj << ") [" << this << "]");
-    return _UDBase::insert_or_assign(hint, k, std::move(obj));
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".max_load_factor() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::max_load_factor();
   }
 
-  template<class M>
-  iterator insert_or_assign(const_iterator hint, Key&& k, M&& obj)
+  void max_load_factor(float ml)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".insert_or_assign(" << hint << ", " << k << ", " << obj << ") [" << this << "]");
-    return _UDBase::insert_or_assign(hint, std::move(k), std::move(obj));
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".max_load_factor(" << ml << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    _UDBase::max_load_factor(ml);
   }
 
-  template<class... Args>
-  _ibp_t emplace(Args&&... args)
+  void rehash(size_type count)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".emplace(" << join(", ", args...) << ") [" << this << "]");
-    return _UDBase::emplace(std::forward<Args>(args)...);
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".rehash(" << count << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    _UDBase::rehash(count);
   }
 
-  template<class... Args>
-  iterator emplace_hint(const_iterator hint, Args&&... args)
+  void reserve(size_type count)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".emplace_hint(" << hint << ", " << join(", ", args...) << ") [" << this << "]");
-    return _UDBase::emplace_hint(hint, std::forward<Args>(args)...);
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".reserve(" << count << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const hash_scope = m_hash.scope(*static_cast<_UDBase const*>(this));
+    _UDBase::reserve(count);
   }
 
-  template<class... Args>
-  _ibp_t try_emplace(Key const& k, Args&&... args)
+  hasher hash_function() const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".try_emplace(" << k << ", " << join(", ", args...) << ") [" << this << "]");
-    return _UDBase::try_emplace(k, std::forward<Args>(args)...);
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".hash_function() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::hash_function();
   }
 
-  template<class... Args>
-  _ibp_t try_emplace(Key&& k, Args&&... args)
+  key_equal key_eq() const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".try_emplace(" << k << ", " << join(", ", args...) << ") [" << this << "]");
-    return _UDBase::try_emplace(std::move(k), std::forward<Args>(args)...);
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".key_eq() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::key_eq();
   }
 
-  template<class... Args>
-  iterator try_emplace(const_iterator hint, Key const& k, Args&&... args)
+  _UDBase const& base_class() const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".try_emplace(" << hint << ", " << k << ", " << join(", ", args...) << ") [" << this << "]");
-    return _UDBase::try_emplace(hint, k, std::forward<Args>(args)...);
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, "base_class() [" << m_debug_name << "] [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return *(static_cast<_UDBase const*>(this));
+  }
+
+  char const* debug_name() const
+  {
+    return m_debug_name;
+  }
+};
+
+template<class Key, class T, class Hash, class KeyEqual, class Alloc>
+void swap(UsageDetector<std::unordered_map<Key, T, Hash, KeyEqual, Alloc>>& lhs,
+          UsageDetector<std::unordered_map<Key, T, Hash, KeyEqual, Alloc>>& rhs) noexcept(noexcept(lhs.swap(rhs)))
+{
+  DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, "swap(" << lhs.debug_name() << " [" << &lhs << "], " << rhs.debug_name() << " [" << &rhs << "])");
+  lhs.swap(rhs);
+}
+
+template<class Key, class T, class Hash, class KeyEqual, class Alloc, class Pred>
+typename std::unordered_map<Key, T, Hash, KeyEqual, Alloc>::size_type erase_if(UsageDetector<std::unordered_map<Key, T, Hash, KeyEqual, Alloc>>& c, Pred pred)
+{
+  DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, "erase_if(" << c.debug_name() << " [" << &c << "], pred)");
+  typename std::unordered_map<Key, T, Hash, KeyEqual, Alloc>::size_type const old_size = c.size();
+  for (auto i = c.begin(); i != c.end();)
+  {
+    if (pred(*i))
+      i = c.erase(i);
+    else
+      ++i;
+  }
+  return old_size - c.size();
+}
+
+// Specialization for std::set.
+template<class Key, class Compare, class Allocator>
+class UsageDetector<std::set<Key, Compare, Allocator>> : protected std::set<Key, Compare, Allocator>
+{
+ private:
+  using _UDBase = std::set<Key, Compare, Allocator>;
+  using _ibp_t = IbpMap<typename _UDBase::iterator>;
+
+  template<typename> friend class UsageDetector;      // For merge.
+
+  char const* m_debug_name;
+  [[no_unique_address]] mutable ThreadProfile m_threads;                 // Only used in profile mode.
+  [[no_unique_address]] mutable UsageProfile<Key, Compare> m_profile;     // Only used in profile mode.
+
+ public:
+  using key_type = typename _UDBase::key_type;
+  using value_type = typename _UDBase::value_type;
+  using key_compare = typename _UDBase::key_compare;
+  using value_compare = typename _UDBase::value_compare;
+  using node_type = typename _UDBase::node_type;
+  using insert_return_type = typename _UDBase::insert_return_type;
+  using allocator_type = typename _UDBase::allocator_type;
+  using size_type = typename _UDBase::size_type;
+  using difference_type = typename _UDBase::difference_type;
+  using reference = typename _UDBase::reference;
+  using const_reference = typename _UDBase::const_reference;
+  using pointer = typename _UDBase::pointer;
+  using const_pointer = typename _UDBase::const_pointer;
+  using iterator = typename _UDBase::iterator;
+  using const_iterator = typename _UDBase::const_iterator;
+  using reverse_iterator = typename _UDBase::reverse_iterator;
+  using const_reverse_iterator = typename _UDBase::const_reverse_iterator;
+
+  // Constructors
+  UsageDetector(char const* debug_name) : _UDBase(), m_debug_name(debug_name)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, libcwd::type_info_of<_UDBase>().demangled_name() << "::set() [" << debug_name << "] [" << this << "]");
+  }
+
+  // Destructor
+  ~UsageDetector()
+  {
+    m_profile.print_summary(m_debug_name);
+    m_threads.print_summary(m_debug_name);
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, libcwd::type_info_of<_UDBase>().demangled_name() << "::~set() [" << m_debug_name << "] [" << this << "]");
+  }
+
+  UsageDetector& operator=(UsageDetector const& other) = delete;
+
+  allocator_type get_allocator() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".get_allocator() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::get_allocator();
+  }
+
+  iterator begin() noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".begin() [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::begin();
+  }
+
+  const_iterator begin() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".begin() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::begin();
+  }
+
+  const_iterator cbegin() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".cbegin() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::cbegin();
+  }
+
+  iterator end() noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".end() [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::end();
+  }
+
+  const_iterator end() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".end() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::end();
+  }
+
+  const_iterator cend() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".cend() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::cend();
+  }
+
+  reverse_iterator rbegin() noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".rbegin() [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::rbegin();
+  }
+
+  const_reverse_iterator rbegin() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".rbegin() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::rbegin();
+  }
+
+  const_reverse_iterator crbegin() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".crbegin() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::crbegin();
+  }
+
+  reverse_iterator rend() noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".rend() [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::rend();
+  }
+
+  const_reverse_iterator rend() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".rend() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::rend();
+  }
+
+  const_reverse_iterator crend() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".crend() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::crend();
+  }
+
+  [[nodiscard]] bool empty() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".empty() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::empty();
+  }
+
+  size_type size() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".size() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::size();
+  }
+
+  size_type max_size() const noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".max_size() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::max_size();
+  }
+
+  void clear() noexcept
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".clear() [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    _UDBase::clear();
+  }
+
+  _ibp_t insert(value_type const& value)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(value);
+    return _UDBase::insert(value);
+  }
+
+  _ibp_t insert(value_type&& value)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(value);
+    return _UDBase::insert(std::move(value));
+  }
+
+  iterator insert(const_iterator pos, value_type const& value)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(value);
+    return _UDBase::insert(pos, value);
+  }
+
+  iterator insert(const_iterator pos, value_type&& value)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << value << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(value);
+    return _UDBase::insert(pos, std::move(value));
+  }
+
+  template<class InputIt>
+  void insert(InputIt first, InputIt last)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << first << ", " << last << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    // Insert one by one (with the same hint as the range insert uses), so that each key can be recorded.
+    for (; first != last; ++first)
+      m_profile.write(*_UDBase::insert(_UDBase::cend(), *first));
+  }
+
+  void insert(std::initializer_list<value_type> ilist)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << ilist << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    for (value_type const& value : ilist)
+      m_profile.write(value);
+    _UDBase::insert(ilist);
+  }
+
+  insert_return_type insert(node_type&& nh)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << nh << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    insert_return_type result = _UDBase::insert(std::move(nh));
+    if (result.position != _UDBase::end())     // nh was empty.
+      m_profile.write(*result.position);
+    return result;
+  }
+
+  iterator insert(const_iterator pos, node_type&& nh)
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".insert(" << pos << ", " << nh << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    iterator const result = _UDBase::insert(pos, std::move(nh));
+    if (result != _UDBase::end())               // nh was empty.
+      m_profile.write(*result);
+    return result;
   }
 
   template<class... Args>
-  iterator try_emplace(const_iterator hint, Key&& k, Args&&... args)
+  _ibp_t emplace(Args&&... args)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".try_emplace(" << hint << ", " << k << ", " << join(", ", args...) << ") [" << this << "]");
-    return _UDBase::try_emplace(hint, k, std::forward<Args>(args)...);
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".emplace(" << join(", ", args...) << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    auto const result = _UDBase::emplace(std::forward<Args>(args)...);
+    m_profile.write(*result.first);
+    return result;
   }
 
-  iterator erase(iterator pos)
+  template<class... Args>
+  iterator emplace_hint(const_iterator hint, Args&&... args)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".erase(" << pos << ") [" << this << "]");
-    return _UDBase::erase(pos);
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".emplace_hint(" << hint << ", " << join(", ", args...) << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    iterator const result = _UDBase::emplace_hint(hint, std::forward<Args>(args)...);
+    m_profile.write(*result);
+    return result;
   }
 
+  // For std::set, iterator and const_iterator are the same type.
   iterator erase(const_iterator pos)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".erase(" << pos << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".erase(" << pos << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(*pos);
     return _UDBase::erase(pos);
   }
 
   iterator erase(const_iterator first, const_iterator last)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".erase(" << first << ", " << last << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".erase(" << first << ", " << last << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    for (const_iterator element = first; element != last; ++element)
+      m_profile.write(*element);
     return _UDBase::erase(first, last);
   }
 
   size_type erase(Key const& key)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".erase(" << key << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".erase(" << key << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(key);
     return _UDBase::erase(key);
   }
 
   void swap(UsageDetector& other) noexcept(std::allocator_traits<Allocator>::is_always_equal::value && std::is_nothrow_swappable<Compare>::value)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".swap(" << other << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".swap(" << other << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
     _UDBase::swap(other);
   }
 
   node_type extract(const_iterator position)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".extract(" << position << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".extract(" << position << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(*position);
     return _UDBase::extract(position);
   }
 
   node_type extract(Key const& k)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".extract(" << k << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".extract(" << k << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    m_profile.write(k);
     return _UDBase::extract(k);
   }
 
   template<class C2>
-  void merge(UsageDetector<std::map<Key, T, C2, Allocator>>& source)
-  {
-    DoutEntering(dc::usage_detector, m_debug_name << ".merge(" << source << ") [" << this << "]");
-    _UDBase::merge(source.base_class());
-  }
-
-  template<class C2>
-  void merge(UsageDetector<std::map<Key, T, C2, Allocator>>&& source)
-  {
-    DoutEntering(dc::usage_detector, m_debug_name << ".merge(" << source << ") [" << this << "]");
-    _UDBase::merge(std::move(source).base_class());
-  }
-
-#if 0
-  template<class C2>
-  void merge(std::multimap<Key, T, C2, Allocator>& source)
+  void merge(UsageDetector<std::set<Key, C2, Allocator>>& source)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << "merge(" << source << ") [" << this << "]");
-    _UDBase::merge(source);
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".merge(" << source << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    _UDBase::merge(static_cast<typename UsageDetector<std::set<Key, C2, Allocator>>::_UDBase&>(source));
   }
 
   template<class C2>
-  void merge(std::multimap<Key, T, C2, Allocator>&& source)
+  void merge(UsageDetector<std::set<Key, C2, Allocator>>&& source)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".merge(" << source << ") [" << this << "]");
-    _UDBase::merge(std::move(source));
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".merge(" << source << ") [" << this << "]");
+    auto const thread_scope = m_threads.write_scope();
+    _UDBase::merge(static_cast<typename UsageDetector<std::set<Key, C2, Allocator>>::_UDBase&&>(source));
   }
-#endif
 
   size_type count(Key const& key) const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".count(" << key << ") [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".count(" << key << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_profile.read(key);
     return _UDBase::count(key);
   }
 
   template<class K>
   size_type count(K const& x) const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".count(" << x << ") [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".count(" << x << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::count(x);
   }
 
   iterator find(Key const& key)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".find(" << key << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".find(" << key << ") [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
+    m_profile.read(key);
     return _UDBase::find(key);
   }
 
   const_iterator find(Key const& key) const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".find(" << key << ") [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".find(" << key << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_profile.read(key);
     return _UDBase::find(key);
   }
 
   template<class K>
   iterator find(K const& x)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".find(" << x << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".find(" << x << ") [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::find(x);
   }
 
   template<class K>
   const_iterator find(K const& x) const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".find(" << x << ") [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".find(" << x << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::find(x);
   }
 
   bool contains(Key const& key) const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".contains(" << key << ") [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".contains(" << key << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    m_profile.read(key);
     return _UDBase::contains(key);
   }
 
   template<class K>
   bool contains(K const& x) const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".contains(" << x << ") [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".contains(" << x << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::contains(x);
   }
 
   std::pair<iterator,iterator> equal_range(Key const& key)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".equal_range(" << key << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".equal_range(" << key << ") [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::equal_range(key);
   }
 
   std::pair<const_iterator,const_iterator> equal_range(Key const& key) const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".equal_range(" << key << ") [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".equal_range(" << key << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::equal_range(key);
   }
 
   template<class K>
   std::pair<iterator,iterator> equal_range(K const& x)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".equal_range(" << x << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".equal_range(" << x << ") [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::equal_range(x);
   }
 
   template<class K>
   std::pair<const_iterator,const_iterator> equal_range(K const& x) const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".equal_range(" << x << ") [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".equal_range(" << x << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::equal_range(x);
   }
 
   iterator lower_bound(Key const& key)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".lower_bound(" << key << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".lower_bound(" << key << ") [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::lower_bound(key);
   }
 
   const_iterator lower_bound(Key const& key) const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".lower_bound(" << key << ") [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".lower_bound(" << key << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::lower_bound(key);
   }
 
   template<class K>
   iterator lower_bound(K const& x)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".lower_bound(" << x << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".lower_bound(" << x << ") [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::lower_bound(x);
   }
 
   template<class K>
   const_iterator lower_bound(K const& x) const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".lower_bound(" << x << ") [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".lower_bound(" << x << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::lower_bound(x);
   }
 
   iterator upper_bound(Key const& key)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".upper_bound(" << key << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".upper_bound(" << key << ") [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::upper_bound(key);
   }
 
   const_iterator upper_bound(Key const& key) const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".upper_bound(" << key << ") [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".upper_bound(" << key << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::upper_bound(key);
   }
 
   template<class K>
   iterator upper_bound(K const& x)
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".upper_bound(" << x << ") [" << this << "]");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".upper_bound(" << x << ") [" << this << "]");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::upper_bound(x);
   }
 
   template<class K>
   const_iterator upper_bound(K const& x) const
   {
-    DoutEntering(dc::usage_detector, m_debug_name << ".upper_bound(" << x << ") [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".upper_bound(" << x << ") [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return _UDBase::upper_bound(x);
   }
 
+  key_compare key_comp() const
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".key_comp() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::key_comp();
+  }
+
+  value_compare value_comp() const
+  {
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, m_debug_name << ".value_comp() [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
+    return _UDBase::value_comp();
+  }
+
   _UDBase const& base_class() const
   {
-    DoutEntering(dc::usage_detector, "base_class() [" << m_debug_name << "] [" << this << "] READ-ACCESS");
+    DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, "base_class() [" << m_debug_name << "] [" << this << "] READ-ACCESS");
+    auto const thread_scope = m_threads.read_scope();
     return *(static_cast<_UDBase const*>(this));
   }
 
@@ -1454,19 +4537,27 @@ class UsageDetector<std::map<Key, T, Compare, Allocator>> : protected std::map<K
   }
 };
 
-template<class Key, class T, class Compare, class Alloc>
-void swap(UsageDetector<std::map<Key, T, Compare, Alloc>>& lhs,
-          UsageDetector<std::map<Key, T, Compare, Alloc>>& rhs) noexcept(noexcept(lhs.swap(rhs)))
+template<class Key, class Compare, class Alloc>
+void swap(UsageDetector<std::set<Key, Compare, Alloc>>& lhs,
+          UsageDetector<std::set<Key, Compare, Alloc>>& rhs) noexcept(noexcept(lhs.swap(rhs)))
 {
-  DoutEntering(dc::usage_detector, "swap(" << lhs.debug_name() << " [" << &lhs << "], " << rhs.debug_name() << " [" << &rhs << "])");
-  std::swap(lhs.base_class(), rhs.base_class());
+  DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, "swap(" << lhs.debug_name() << " [" << &lhs << "], " << rhs.debug_name() << " [" << &rhs << "])");
+  lhs.swap(rhs);
 }
 
-template<class Key, class T, class Compare, class Alloc, class Pred>
-typename std::map<Key, T, Compare, Alloc>::size_type erase_if(UsageDetector<std::map<Key, T, Compare, Alloc>>& c, Pred pred)
+template<class Key, class Compare, class Alloc, class Pred>
+typename std::set<Key, Compare, Alloc>::size_type erase_if(UsageDetector<std::set<Key, Compare, Alloc>>& c, Pred pred)
 {
-  DoutEntering(dc::usage_detector, "erase_if(" << c.debug_name() << " [" << &c << "], pred)");
-  return std::erase_if(c.base_class(), pred);
+  DoutEnteringIf(CWDS_USAGE_DETECTOR_TRACE, dc::usage_detector, "erase_if(" << c.debug_name() << " [" << &c << "], pred)");
+  typename std::set<Key, Compare, Alloc>::size_type const old_size = c.size();
+  for (auto i = c.begin(); i != c.end();)
+  {
+    if (pred(*i))
+      i = c.erase(i);
+    else
+      ++i;
+  }
+  return old_size - c.size();
 }
 
 NAMESPACE_DEBUG_END
@@ -12,7 +12,10 @@
 #include "benchmark.h"
 #include "debug.h"
 #include "FrequencyCounter.h"
+#include <algorithm>
+#include <array>
 #include <cstring>
+#include <ctime>
 #include <pthread.h>
 #include <sys/syscall.h>
 #include <stdexcept>
@@ -26,7 +29,7 @@ void* Stopwatch::operator new(size_t size)
 {
   void* ptr;
   // Use storage that is aligned with a cache line.
-  if (int err_num = posix_memalign(&ptr, cache_line_size, size))
+  if (int err_num = posix_memalign(&ptr, std::max(cache_line_size, CpuTopology::instance().cache_line_size()), size))
   {
     if (err_num == ENOMEM)      // There was insufficient memory to fulfill the allocation request.
       throw std::bad_alloc{};
@@ -42,6 +45,7 @@ Stopwatch::Stopwatch(unsigned int cpu_nr)
   int err_num;
 
   std::memset((void*)this, 0, sizeof(Stopwatch));
+  unsigned int const number_of_cpus = CpuTopology::instance().number_of_cpus();
   do
   {
     // Pin main thread to a cpu 'cpu_nr'.
@@ -62,6 +66,13 @@ Stopwatch::Stopwatch(unsigned int cpu_nr)
       cpu_nr = cpu;
     }
 
+    if (cpu_nr >= number_of_cpus)
+    {
+      err_str = "Stopwatch: cpu_nr out of range";
+      err_num = EINVAL;
+      break;
+    }
+
     size_t const cpu_set_size = CPU_ALLOC_SIZE(number_of_cpus);
     m_cpuset = CPU_ALLOC(number_of_cpus);
     ASSERT(m_cpuset != nullptr);
@@ -96,6 +107,8 @@ Stopwatch::Stopwatch(unsigned int cpu_nr)
       break;
 
     // Success.
+    m_cpu_nr = cpu_nr;
+    tsc_frequency();            // Calibrate the TSC frequency, if that wasn't done already.
     prefetch();
     return;
   }
@@ -107,16 +120,40 @@ Stopwatch::Stopwatch(unsigned int cpu_nr)
 
 Stopwatch::~Stopwatch()
 {
+  delete m_perf_events;
   if (m_cpuset)
   {
     // Restore CPU affinity.
-    size_t const cpu_set_size = CPU_ALLOC_SIZE(number_of_cpus);
+    size_t const cpu_set_size = CPU_ALLOC_SIZE(CpuTopology::instance().number_of_cpus());
     CWDEBUG_ONLY(int err_num =) pthread_setaffinity_np(pthread_self(), cpu_set_size, m_cpuset);
     Dout(dc::warning(err_num), "Failed to restore cpu affinity.");
     CPU_FREE(m_cpuset);
   }
 }
 
+void Stopwatch::enable_perf_counters()
+{
+  if (m_perf_events)
+    return;
+  m_perf_events = new PerfEventGroup;
+  // Measure what the counters count for an empty region: the instructions of start() and stop()
+  // and the user space part of reading the counters. These are subtracted from every measurement.
+  PerfEventGroup::values_type overhead;
+  overhead.fill(std::numeric_limits<uint64_t>::max());
+  for (int i = 0; i < 1000; ++i)
+  {
+    m_perf_events->start();
+    start();
+    stop();
+    m_perf_events->stop();
+    PerfEventGroup::values_type const counts = m_perf_events->last();
+    for (int j = 0; j < number_of_perf_counters; ++j)
+      overhead[j] = std::min(overhead[j], counts[j]);
+  }
+  m_perf_events->set_overhead(overhead);
+  Dout(dc::notice, "Perf counter overhead: " << overhead[perf_cycles] << " cycles, " << overhead[perf_instructions] << " instructions.");
+}
+
 void Stopwatch::calibrate_overhead(size_t iterations, size_t minimum_of)
 {
   static int volatile v;
@@ -177,10 +214,73 @@ void Stopwatch::calibrate_overhead(size_t iterations, size_t minimum_of)
   }
 }
 
+namespace {
+
+[[gnu::always_inline]] inline uint64_t read_tsc()
+{
+  uint32_t low, high;
+  asm volatile ("rdtsc" : "=a" (low), "=d" (high));
+  return (uint64_t)high << 32 | low;
+}
+
+// Return a pair of the nanoseconds of CLOCK_MONOTONIC_RAW and the TSC, read at (nearly) the same moment.
+std::pair<int64_t, uint64_t> read_clock_and_tsc()
+{
+  std::pair<int64_t, uint64_t> best;
+  uint64_t best_width = std::numeric_limits<uint64_t>::max();
+  // Read the TSC before and after reading the clock and use the attempt where that took the least time.
+  for (int attempt = 0; attempt < 16; ++attempt)
+  {
+    timespec ts;
+    uint64_t tsc_before = read_tsc();
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    uint64_t tsc_after = read_tsc();
+    if (tsc_after - tsc_before < best_width)
+    {
+      best_width = tsc_after - tsc_before;
+      best.first = int64_t{ts.tv_sec} * 1000000000 + ts.tv_nsec;
+      best.second = tsc_before + best_width / 2;
+    }
+  }
+  return best;
+}
+
+double calibrate_tsc_frequency()
+{
+#ifdef CWDEBUG
+  CpuTopology const& topology = CpuTopology::instance();
+  Dout(dc::warning(!topology.has_flag("constant_tsc") || !topology.has_flag("nonstop_tsc")),
+      "The TSC of this CPU is not invariant (constant_tsc and nonstop_tsc are not both set): results in nanoseconds are unreliable.");
+#endif
+  // Measure three intervals of 50 ms and use the median.
+  std::array<double, 3> frequencies;
+  for (auto& frequency : frequencies)
+  {
+    auto [ns_start, tsc_start] = read_clock_and_tsc();
+    std::pair<int64_t, uint64_t> end;
+    do
+      end = read_clock_and_tsc();
+    while (end.first - ns_start < 50000000);
+    frequency = (end.second - tsc_start) * 1e9 / (end.first - ns_start);
+  }
+  std::sort(frequencies.begin(), frequencies.end());
+  Dout(dc::notice, "The TSC frequency was calibrated at " << (frequencies[1] * 1e-9) << " GHz.");
+  return frequencies[1];
+}
+
+} // namespace
+
+//static
+double Stopwatch::tsc_frequency()
+{
+  static double const s_tsc_frequency = calibrate_tsc_frequency();
+  return s_tsc_frequency;
+}
+
 std::ostream& operator<<(std::ostream& os, Stopwatch const& stopwatch)
 {
   uint64_t diff_cycles = stopwatch.diff_cycles();
-  os << (diff_cycles / 3612059.050) << " ms";
+  os << (diff_cycles * 1e3 / Stopwatch::tsc_frequency()) << " ms";
   return os;
 }
 
@@ -11,10 +11,13 @@
 #pragma once
 
 #include "FrequencyCounter.h"
+#include "CpuTopology.h"
+#include "PerfEventGroup.h"
 #include <sched.h>
 #include <cstdint>
 #include <cstdlib>
 #include <limits>
+#include <map>
 
 #if defined(BENCHMARK_UNSUPPORTED)
 // Do not #include <benchmark.h> when BENCHMARK_UNSUPPORTED is defined.
@@ -27,12 +30,15 @@
 
 // Usage example
 //
-// cpu_frequency is 1 / delta_t where delta_t is the time between
-// two clock ticks as measured with rdtsc / rdtscp. It should be
-// the cpu clock frequency.
+// The frequency of the time stamp counter (as read with rdtsc / rdtscp)
+// is calibrated once per process against CLOCK_MONOTONIC_RAW; see
+// Stopwatch::tsc_frequency(). The results returned by measure() can
+// therefore be converted to nanoseconds with nanoseconds().
 //
 // cpu is a number from 0 till N, where N is the number of cores
-// you have (see: grep '^processor' /proc/cpuinfo).
+// you have (see: grep '^processor' /proc/cpuinfo). Use
+// benchmark::CpuTopology::instance() to find out which CPUs
+// are physical cores, SMT siblings or on which NUMA node.
 //
 // loopsize is the size of the loop around the test code.
 // It should be such that the result (in clock cycles)
@@ -72,7 +78,6 @@
 #include "cwds/benchmark.h"
 //#include "iacaMarks.h"        // Optionally include to define IACA_START and IACA_STOP.
 
-double const cpu_frequency = 3612059050.0;        // In cycles per second.
 int const cpu = 0;                                // The CPU to run on.
 size_t const loopsize = 1000;                     // We'll be measing the number of clock cylces needed for this many iterations of the test code.
 size_t const minimum_of = 3;                      // All but the fastest measurement of this many measurements are thrown away (3 is normally enough).
@@ -106,15 +111,34 @@ int main()
       //IACA_END                        // Optional; needed when you want to analyse the generated assembly code with IACA.
   }, minimum_of);
 
-  std::cout << "Result: " << (result / cpu_frequency * 1e9 / loopsize) << " ns [measured " << result << " clocks]." << std::endl;
+  std::cout << "Result: " << (result.nanoseconds() / loopsize) << " ns [measured " << result << " clocks]." << std::endl;
+  // Only when stopwatch.enable_perf_counters() was called:
+  std::cout << "Counters: " << result.m_perf << std::endl;
 }
 
 #endif // EXAMPLE_CODE
 
 namespace benchmark {
 
-unsigned int constexpr cache_line_size = 64;    // grep cache_alignment /proc/cpuinfo
-unsigned int constexpr number_of_cpus = 32;     // See /proc/cpuinfo
+// The result of Stopwatch::measure, including the context in which it was measured.
+struct MeasureResult : eda::FrequencyCounterResult
+{
+  unsigned int m_iterations = 0;        // The number of calls to the functor per measurement.
+  unsigned int m_minimum_of = 0;        // The number of measurements that the minimum was taken of.
+  int m_nk = 0;                         // The number of FrequencyCounter buckets that could be averaged over.
+  int m_stopwatch_overhead = 0;         // The start()/stop() overhead that was subtracted, in clock cycles.
+  uint32_t m_iterations_overhead = 0;   // The loop overhead that was subtracted, in clock cycles.
+  unsigned int m_cpu = 0;               // The CPU that the Stopwatch was pinned to.
+  std::map<int, size_t> m_histogram;    // How often each (overhead corrected) minimum was measured.
+  PerfCounters m_perf;                  // Only valid if the Stopwatch has perf counters enabled.
+
+  MeasureResult() = default;
+  MeasureResult(eda::FrequencyCounterResult const& result) : eda::FrequencyCounterResult(result) { }
+};
+
+// The cache line size that is assumed at compile time (for alignas).
+// Use CpuTopology::instance().cache_line_size() for the actual value.
+unsigned int constexpr cache_line_size = 64;
 
 // For this to work reliably, grep '^flags' /proc/cpuinfo must contain rdtscp, constant_tsc and nonstop_tsc.
 // You should also turn off all power optimization, Intel Hyper-Threading technology, frequency scaling and
@@ -127,6 +151,8 @@ class Stopwatch
   uint32_t cycles_end_high;
   uint32_t cycles_end_low;
   cpu_set_t* m_cpuset;
+  unsigned int m_cpu_nr;                // The CPU that this thread is pinned to.
+  PerfEventGroup* m_perf_events;        // Hardware performance counters, or nullptr if not enabled.
 
   unsigned int calibrated_iterations;   // The iterations value last passed to calibrate_overhead().
   uint32_t iterations_overhead;         // The overhead when using calibrated_iterations, in clock cycles.
@@ -135,14 +161,27 @@ class Stopwatch
   static int s_stopwatch_overhead;      // The overhead of calling start()/stop(), in clock cycles.
 
  public:
-  static constexpr unsigned int cpu_any = 0xffffffff;  // This value means: keep running on whatever cpu this thread is running.
+  static constexpr unsigned int cpu_any = CpuTopology::cpu_any;  // This value means: keep running on whatever cpu this thread is running.
 
   Stopwatch(unsigned int cpu_nr = cpu_any);
   ~Stopwatch();
 
+  // The destructor restores the CPU affinity of the thread (m_cpuset) and deletes m_perf_events.
+  Stopwatch(Stopwatch const&) = delete;
+  Stopwatch& operator=(Stopwatch const&) = delete;
+
   void* operator new(size_t size);
   void operator delete(void* ptr) { free(ptr); }
 
+  // Open a group of hardware performance counters for the calling thread.
+  // After this call, measure() also returns IPC and misses per iteration.
+  // Throws std::system_error if perf_event_open(2) fails (see /proc/sys/kernel/perf_event_paranoid).
+  void enable_perf_counters();
+  bool has_perf_counters() const { return m_perf_events; }
+
+  // The CPU that the thread was pinned to by the constructor.
+  unsigned int cpu() const { return m_cpu_nr; }
+
   void prefetch()
   {
     __builtin_prefetch(this, 1);
@@ -222,8 +261,45 @@ class Stopwatch
     return ((uint64_t)(cycles_end_high - cycles_start_high) << 32) + cycles_end_low - cycles_start_low;
   }
 
+  // Accessors for the values determined by calibrate_overhead().
+  unsigned int get_calibrated_iterations() const { return calibrated_iterations; }
+  uint32_t get_iterations_overhead() const { return iterations_overhead; }
+
+  // Use the loop overhead that was determined by calibrate_overhead() of another Stopwatch.
+  // This requires s_stopwatch_overhead to be initialized already.
+  void set_iterations_overhead(unsigned int iterations, uint32_t overhead)
+  {
+    ASSERT(s_stopwatch_overhead != 0);
+    calibrated_iterations = iterations;
+    iterations_overhead = overhead;
+  }
+
+  // Correct a result that was measured with `iterations` calls per measurement for loop and stopwatch overhead.
+  // Also sets the TSC frequency of result.
+  void subtract_overhead(eda::FrequencyCounterResult& result, unsigned int iterations) const
+  {
+    result.m_cycles -= overhead(iterations);
+    if (result.m_cycles < 0)
+      result.m_cycles = 0;
+    result.m_tsc_frequency = tsc_frequency();
+  }
+
+  // The total overhead of a measurement of `iterations` calls, in clock cycles.
+  int overhead(unsigned int iterations) const
+  {
+    return s_stopwatch_overhead + (iterations == calibrated_iterations ? iterations_overhead : 0);
+  }
+
+  // Return the frequency of the time stamp counter in Hz.
+  // The first call calibrates the TSC against CLOCK_MONOTONIC_RAW (this takes about 150 ms);
+  // subsequent calls return the cached value. The constructor of Stopwatch calls this.
+  static double tsc_frequency();
+
   // Measure the number of clock cycles that it takes to run functor() iterations times
   // and return to smallest value of doing that minimum_of times.
+  //
+  // If perf counters are enabled then they are read just outside the timed region
+  // and the counts belonging to the smallest measurement are added to the group.
   template<class T>
   uint64_t get_minimum_of(unsigned int const iterations, T const functor, unsigned int const minimum_of)
   {
@@ -231,33 +307,53 @@ class Stopwatch
     T benchmark_code = functor;
     for (unsigned int i = 0; i < minimum_of; ++i)
     {
+      if (m_perf_events) [[unlikely]]
+        m_perf_events->start();
       start();
       for (unsigned int j = 0; j < iterations; ++j)
         benchmark_code();
       stop();
+      if (m_perf_events) [[unlikely]]
+        m_perf_events->stop();
       uint64_t ncycles = diff_cycles();
       if (ncycles < cycles)
+      {
         cycles = ncycles;
+        if (m_perf_events) [[unlikely]]
+          m_perf_events->keep();
+      }
     }
+    if (m_perf_events) [[unlikely]]
+      m_perf_events->add_minimum();
     return cycles;
   }
 
   // Same as above but correct for loop and stopwatch overhead (call calibrate_overhead() first!),
   // as well as repeat calling get_minimum_of() until we are 99.9% sure what measurement occurs
   // most often (to get something that will reproduce extremely well).
+  // The perf counters (if enabled) are averaged over all calls to get_minimum_of().
   template<int nk = 3, class T>
-  eda::FrequencyCounterResult measure(unsigned int iterations, T const functor, unsigned int minimum_of = 3)
+  MeasureResult measure(unsigned int iterations, T const functor, unsigned int minimum_of = 3)
   {
     eda::FrequencyCounter<int, nk> fc;
+    if (m_perf_events)
+      m_perf_events->reset();
     while (!fc.add(get_minimum_of(iterations, functor, minimum_of)))
       ;
-    eda::FrequencyCounterResult result = fc.result();
+    MeasureResult result = fc.result();
     Dout(dc::notice, "Measured with overhead: " << result.m_cycles);
-    result.m_cycles -= s_stopwatch_overhead;
-    if (iterations == calibrated_iterations)
-      result.m_cycles -= iterations_overhead;
-    if (result.m_cycles < 0)
-      result.m_cycles = 0;
+    subtract_overhead(result, iterations);
+    result.m_iterations = iterations;
+    result.m_minimum_of = minimum_of;
+    result.m_nk = nk;
+    result.m_stopwatch_overhead = s_stopwatch_overhead;
+    result.m_iterations_overhead = iterations == calibrated_iterations ? iterations_overhead : 0;
+    result.m_cpu = m_cpu_nr;
+    int const total_overhead = overhead(iterations);
+    for (auto [cycles, count] : fc.counters())
+      result.m_histogram.emplace_hint(result.m_histogram.end(), cycles - total_overhead, count);
+    if (m_perf_events)
+      result.m_perf = m_perf_events->result(iterations);
     return result;
   }
 
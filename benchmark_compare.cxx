@@ -0,0 +1,77 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief Compare two sets of benchmark results, as written by ResultSink.
+ *
+ * Usage: benchmark_compare [--threshold <percentage>] <baseline> <candidate>
+ *
+ * The exit code is 0 when there are no regressions, 1 when at least one
+ * benchmark is (probably) slower and 2 on error.
+ */
+
+#include "sys.h"
+#include "ResultComparator.h"
+#include "debug.h"
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+void usage(char const* argv0)
+{
+  std::cerr << "Usage: " << argv0 << " [--threshold <percentage>] <baseline> <candidate>\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  Debug(NAMESPACE_DEBUG::init());
+
+  double threshold = 0.0;
+  int arg = 1;
+  if (arg + 1 < argc && std::strcmp(argv[arg], "--threshold") == 0)
+  {
+    std::string const percentage = argv[arg + 1];
+    try
+    {
+      size_t end;
+      threshold = std::stod(percentage, &end) / 100.0;
+      if (end != percentage.size())
+        throw std::invalid_argument("trailing characters");
+    }
+    catch (std::logic_error const&)   // std::invalid_argument or std::out_of_range.
+    {
+      std::cerr << argv[0] << ": invalid threshold \"" << percentage << "\".\n";
+      usage(argv[0]);
+      return 2;
+    }
+    arg += 2;
+  }
+  if (argc - arg != 2)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  try
+  {
+    benchmark::ResultComparator comparator(threshold);
+    comparator.load_baseline(argv[arg]);
+    comparator.load_candidate(argv[arg + 1]);
+    auto comparisons = comparator.compare();
+    comparator.print_report(std::cout, comparisons);
+    return comparator.has_regression(comparisons) ? 1 : 0;
+  }
+  catch (std::exception const& error)
+  {
+    std::cerr << argv[0] << ": " << error.what() << std::endl;
+    return 2;
+  }
+}
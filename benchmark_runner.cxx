@@ -0,0 +1,141 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief The main() of AICxx::benchmark_runner; runs the benchmarks registered with REGISTER_BENCHMARK.
+ */
+
+#include "sys.h"
+#include "BenchmarkRegistry.h"
+#include "ResultSink.h"
+#include "debug.h"
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <regex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+namespace {
+
+void usage(char const* argv0)
+{
+  std::cerr << "Usage: " << argv0 << " [--list] [--filter <regex>] [--cpu <nr>] [--output <file>] [--perf]\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  Debug(NAMESPACE_DEBUG::init());
+
+  bool list = false;
+  bool perf = false;
+  std::string filter = ".*";
+  unsigned int cpu = benchmark::Stopwatch::cpu_any;
+  std::string output;
+  for (int arg = 1; arg < argc; ++arg)
+  {
+    bool const has_value = arg + 1 < argc;
+    if (std::strcmp(argv[arg], "--list") == 0)
+      list = true;
+    else if (std::strcmp(argv[arg], "--perf") == 0)
+      perf = true;
+    else if (std::strcmp(argv[arg], "--filter") == 0 && has_value)
+      filter = argv[++arg];
+    else if (std::strcmp(argv[arg], "--cpu") == 0 && has_value)
+    {
+      std::string const cpu_nr = argv[++arg];
+      try
+      {
+        size_t end;
+        unsigned long const value = std::stoul(cpu_nr, &end);
+        if (end != cpu_nr.size())
+          throw std::invalid_argument("trailing characters");
+        if (value >= benchmark::Stopwatch::cpu_any)     // This includes negative numbers.
+          throw std::out_of_range("cpu number too large");
+        cpu = value;
+      }
+      catch (std::logic_error const&)   // std::invalid_argument or std::out_of_range.
+      {
+        std::cerr << argv[0] << ": invalid cpu number \"" << cpu_nr << "\".\n";
+        usage(argv[0]);
+        return 2;
+      }
+    }
+    else if (std::strcmp(argv[arg], "--output") == 0 && has_value)
+      output = argv[++arg];
+    else
+    {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  auto const& benchmarks = benchmark::BenchmarkRegistry::benchmarks();
+  if (list)
+  {
+    for (auto&& registered : benchmarks)
+      std::cout << registered.m_name << '\n';
+    return 0;
+  }
+
+  try
+  {
+    std::regex const regex(filter);
+    std::unique_ptr<benchmark::ResultSink> sink;
+    if (!output.empty())
+      sink = std::make_unique<benchmark::ResultSink>(output);
+
+    benchmark::Stopwatch stopwatch(cpu);
+    if (perf)
+    {
+      try
+      {
+        stopwatch.enable_perf_counters();
+      }
+      catch (std::system_error const& error)
+      {
+        std::cerr << "Warning: could not enable perf counters: " << error.what() << std::endl;
+      }
+    }
+
+    // The loop overhead per (iterations, minimum_of) pair.
+    std::map<std::pair<unsigned int, unsigned int>, uint32_t> calibrations;
+    for (auto&& registered : benchmarks)
+    {
+      if (!std::regex_search(registered.m_name, regex))
+        continue;
+      auto key = std::make_pair(registered.m_iterations, registered.m_minimum_of);
+      auto calibration = calibrations.find(key);
+      if (calibration == calibrations.end())
+      {
+        stopwatch.calibrate_overhead(registered.m_iterations, registered.m_minimum_of);
+        calibrations.emplace(key, stopwatch.get_iterations_overhead());
+      }
+      else
+        stopwatch.set_iterations_overhead(registered.m_iterations, calibration->second);
+
+      benchmark::MeasureResult result = registered.m_measure(stopwatch);
+      std::cout << registered.m_name << ": " << (static_cast<double>(result.m_cycles) / registered.m_iterations) <<
+        " cycles, " << (result.nanoseconds() / registered.m_iterations) << " ns per iteration";
+      if (!result.is_t999())
+        std::cout << " (" << benchmark::ResultSink::type_name(result.m_type) << ')';
+      if (result.m_perf.m_valid)
+        std::cout << ' ' << result.m_perf;
+      std::cout << std::endl;
+      if (sink)
+        sink->write(registered.m_name, result);
+    }
+  }
+  catch (std::exception const& error)
+  {
+    std::cerr << argv[0] << ": " << error.what() << std::endl;
+    return 1;
+  }
+}
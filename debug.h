@@ -21,6 +21,8 @@
 #define Debug(...) do { } while(0)
 #define Dout(a, ...) do { } while(0)
 #define DoutEntering(a, ...)
+#define DoutIf(enabled, a, ...) do { } while(0)
+#define DoutEnteringIf(enabled, a, ...)
 #define DoutFatal(a, ...) LibcwDoutFatal(::std, , a, __VA_ARGS__)
 #define ForAllDebugChannels(...)
 #define ForAllDebugObjects(...)
@@ -100,6 +102,42 @@ void operator<<(std::same_as<MakeLIBCWD_USING_OSTREAM_PRELUDEHappy> auto, int);
 #include <libcwd/debug.h>
 #include <libcwd/char2str.h>
 
+#if __has_include(<cwds/config.h>)
+#include <cwds/config.h>        // CWDS_CHANNEL_*, CWDS_USAGE_DETECTOR_PROFILE
+#endif
+
+// The cwds channels that are compiled in (see CwdsDisabledChannels in CMakeLists.txt).
+#ifndef CWDS_CHANNEL_TRACKED
+#define CWDS_CHANNEL_TRACKED 1
+#endif
+#ifndef CWDS_CHANNEL_USAGE_DETECTOR
+#define CWDS_CHANNEL_USAGE_DETECTOR 1
+#endif
+// Whether UsageDetector counts accesses instead of printing them (see CwdsUsageDetectorProfile in CMakeLists.txt).
+#ifndef CWDS_USAGE_DETECTOR_PROFILE
+#define CWDS_USAGE_DETECTOR_PROFILE 0
+#endif
+
+/// Compile-time channel filtering.
+//
+// Usage:
+//
+//   DoutIf(CWDS_CHANNEL_TRACKED, dc::tracked, "Hello");
+//   DoutEnteringIf(CWDS_CHANNEL_TRACKED, dc::tracked, "f()");
+//
+// where the first argument is a macro that expands to 0 or 1.
+// If it is 0 then no code at all is generated, not even the runtime check if the channel is on.
+#define DoutIf(enabled, ...) CWDS_DOUT_IF(enabled, __VA_ARGS__)
+#define DoutEnteringIf(enabled, ...) CWDS_DOUT_ENTERING_IF(enabled, __VA_ARGS__)
+/// @cond Doxygen_Suppress
+#define CWDS_DOUT_IF(enabled, ...) CWDS_DOUT_IF_##enabled(__VA_ARGS__)
+#define CWDS_DOUT_IF_0(...) do { } while(0)
+#define CWDS_DOUT_IF_1(...) Dout(__VA_ARGS__)
+#define CWDS_DOUT_ENTERING_IF(enabled, ...) CWDS_DOUT_ENTERING_IF_##enabled(__VA_ARGS__)
+#define CWDS_DOUT_ENTERING_IF_0(...)
+#define CWDS_DOUT_ENTERING_IF_1(...) DoutEntering(__VA_ARGS__)
+/// @endcond
+
 /// Debug specific code.
 NAMESPACE_DEBUG_START
 
@@ -110,6 +148,14 @@ bool being_traced();
 
 void ignore_being_traced();
 
+// Let a background thread write the debug output (see AsyncDebugStreamBuf.h).
+void start_async_output();
+void stop_async_output();
+
+// Write the debug output to a memory mapped circular buffer (see MmapDebugStreamBuf.h).
+void start_mmap_output(std::string const& filename, size_t capacity = 8 << 20);
+void stop_mmap_output();
+
 #if __cplusplus >= 202002L      // Only add this when C++20 is supported.
 
 template <typename T>
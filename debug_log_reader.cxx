@@ -0,0 +1,44 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief Print the debug output in a file written by MmapDebugStreamBuf.
+ *
+ * Usage: debug_log_reader <file>
+ *
+ * Prints the contents of the circular buffer, oldest line first.
+ * The exit code is 0 on success and 2 on error.
+ */
+
+#include "sys.h"
+#include "MmapDebugStreamBuf.h"
+#include "debug.h"
+#include <iostream>
+#include <stdexcept>
+
+int main(int argc, char* argv[])
+{
+  if (argc != 2)
+  {
+    std::cerr << "Usage: " << argv[0] << " <file>\n";
+    return 2;
+  }
+
+#ifdef CWDEBUG
+  try
+  {
+    NAMESPACE_DEBUG::MmapDebugStreamBuf::read_tail(argv[1], std::cout);
+    return 0;
+  }
+  catch (std::exception const& error)
+  {
+    std::cerr << argv[0] << ": " << error.what() << std::endl;
+  }
+#else
+  std::cerr << argv[0] << ": debug log files are only written when compiled with CWDEBUG." << std::endl;
+#endif
+  return 2;
+}
@@ -148,10 +148,10 @@ class PlotHistogram : public Plot
  public:
   PlotHistogram(std::string title, std::string xlabel, std::string ylabel, double bucket_width = 1) : Plot(title, xlabel, ylabel), m_bucket_width(bucket_width) { }
 
-  template<typename T>
-  void show(FrequencyCounter<T> const& frequence_counter, char const* key = "data")
+  template<typename T, int nk, int window>
+  void show(FrequencyCounter<T, nk, window> const& frequence_counter, char const* key = "data")
   {
-    auto const& counters = frequence_counter.counters();
+    auto const counters = frequence_counter.counters();
     for (auto&& e : counters)
       add_data_point(e.first, e.second, key);
     show();
@@ -10,117 +10,410 @@
 
 #include "sys.h"
 #include "signal_safe_printf.h"
-#include <cassert>
-//#include <cstdio>
+#include <cerrno>
+#include <cstdint>
 #include <cstring>
-#include <type_traits>
-#include <unistd.h>
 
-template<typename T>
-char* signal_safe_write_int(char* buf, unsigned int base, T val)
+namespace {
+
+// "00" "01" ... "99": converting two decimal digits at a time halves the number of divisions.
+constexpr char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+constexpr char lower_hex_digits[] = "0123456789abcdef";
+constexpr char upper_hex_digits[] = "0123456789ABCDEF";
+
+// Write the digits of val in the given base so that they end at end. Returns a pointer to the first digit.
+// Writes nothing when val is zero.
+char* format_unsigned(char* end, unsigned long long val, unsigned int base, bool upper)
 {
-    if (val < 0)
+    char* p = end;
+    if (base == 10)
+    {
+        while (val >= 100)
+        {
+            unsigned int const pair = (val % 100) * 2;
+            val /= 100;
+            p -= 2;
+            std::memcpy(p, digit_pairs + pair, 2);
+        }
+        if (val >= 10)
+        {
+            p -= 2;
+            std::memcpy(p, digit_pairs + val * 2, 2);
+        }
+        else if (val > 0)
+            *--p = '0' + val;
+    }
+    else if (base == 16)
     {
-        buf[0] = '-';
-        return signal_safe_write_int(buf + 1, base, (typename std::make_unsigned<T>::type(-val)));
+        char const* digits = upper ? upper_hex_digits : lower_hex_digits;
+        for (; val > 0; val >>= 4)
+            *--p = digits[val & 0xf];
     }
-    char tmp[64];
-    char* p = tmp + sizeof(tmp);
-    do
+    else // base == 8
     {
-        int digit = val % base;
-        val /= base;
-        *--p = (digit > 9 ? 'a' - 10 : '0') + digit;
+        for (; val > 0; val >>= 3)
+            *--p = '0' + (val & 7);
     }
-    while (val > 0);
-    int size = tmp + sizeof(tmp) - p;
-    std::memcpy(buf, p, size);
-    return buf + size;
+    return p;
 }
 
-void signal_safe_printf(char const* fmt, ...)
+} // namespace
+
+struct iovec* SignalSafeWriter::add_iovec()
+{
+    if (m_iovcnt == max_iovecs)
+        flush();
+    return &m_iov[m_iovcnt++];
+}
+
+void SignalSafeWriter::write(char const* data, size_t len)
+{
+    while (len > 0)
+    {
+        if (m_size == m_capacity)
+            flush();
+        char* const dest = m_buffer + m_size;
+        // Extend the last iovec if it ends where we are going to write.
+        bool const extend = m_iovcnt > 0 && static_cast<char*>(m_iov[m_iovcnt - 1].iov_base) + m_iov[m_iovcnt - 1].iov_len == dest;
+        if (!extend && m_iovcnt == max_iovecs)
+        {
+            flush();
+            continue;
+        }
+        size_t const n = len < m_capacity - m_size ? len : m_capacity - m_size;
+        std::memcpy(dest, data, n);
+        m_size += n;
+        if (extend)
+            m_iov[m_iovcnt - 1].iov_len += n;
+        else
+        {
+            struct iovec* iov = add_iovec();
+            iov->iov_base = dest;
+            iov->iov_len = n;
+        }
+        data += n;
+        len -= n;
+    }
+}
+
+void SignalSafeWriter::write_ref(char const* data, size_t len)
+{
+    if (len == 0)
+        return;
+    struct iovec* iov = add_iovec();
+    iov->iov_base = const_cast<char*>(data);
+    iov->iov_len = len;
+}
+
+void SignalSafeWriter::put(char c, size_t count)
+{
+    char chunk[32];
+    std::memset(chunk, c, sizeof(chunk));
+    while (count > 0)
+    {
+        size_t const n = count < sizeof(chunk) ? count : sizeof(chunk);
+        write(chunk, n);
+        count -= n;
+    }
+}
+
+bool SignalSafeWriter::write_iovecs(struct iovec* iov, int iovcnt)
+{
+    while (iovcnt > 0)
+    {
+        ssize_t written = ::writev(m_fd, iov, iovcnt);
+        if (written == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        // Skip what was written.
+        while (iovcnt > 0 && static_cast<size_t>(written) >= iov->iov_len)
+        {
+            written -= iov->iov_len;
+            ++iov;
+            --iovcnt;
+        }
+        if (iovcnt > 0)
+        {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+            iov->iov_len -= written;
+        }
+    }
+    return true;
+}
+
+bool SignalSafeWriter::flush()
+{
+    int const saved_errno = errno;
+    if (m_iovcnt > 0 && !m_error)
+        m_error = !write_iovecs(m_iov, m_iovcnt);
+    m_iovcnt = 0;
+    m_size = 0;
+    errno = saved_errno;
+    return !m_error;
+}
+
+void SignalSafeWriter::printf(char const* fmt, ...)
 {
-    char buf[512];
     va_list args;
     va_start(args, fmt);
-    char* out = buf;
+    vprintf(fmt, args);
+    va_end(args);
+}
+
+void SignalSafeWriter::vprintf(char const* fmt, va_list args)
+{
     char const* p = fmt;
     while (*p)
     {
-        if (*p == '%')
+        if (*p != '%')
+        {
+            char const* literal = p;
+            while (*p && *p != '%')
+                ++p;
+            write(literal, p - literal);
+            continue;
+        }
+        char const* const spec = p++;
+
+        // Flags.
+        bool left = false, zero = false, plus = false, space = false, alternate = false;
+        for (;; ++p)
+        {
+            if (*p == '-') left = true;
+            else if (*p == '0') zero = true;
+            else if (*p == '+') plus = true;
+            else if (*p == ' ') space = true;
+            else if (*p == '#') alternate = true;
+            else break;
+        }
+
+        // Width.
+        size_t width = 0;
+        if (*p == '*')
         {
-            switch (*++p)
+            ++p;
+            int const arg = va_arg(args, int);
+            // A negative width is taken as a '-' flag followed by a positive width.
+            // Negate as unsigned: -INT_MIN doesn't fit in an int.
+            if (arg < 0)
+                left = true;
+            width = arg < 0 ? 0u - static_cast<unsigned int>(arg) : static_cast<unsigned int>(arg);
+        }
+        else
+            while (*p >= '0' && *p <= '9')
             {
-                case '%':           // %%
-                {
-                    ++p;
-                    *out++ = '%';
-                    break;
-                }
-                case 'c':           // %c
-                {
-                    ++p;
-                    char arg = va_arg(args, int);
-                    *out++ = arg;
-                    break;
-                }
-                case 'd':           // %d
+                if (width <= max_width)
+                    width = width * 10 + (*p - '0');
+                ++p;
+            }
+        if (width > max_width)
+            width = max_width;
+
+        // Precision.
+        int precision = -1;
+        if (*p == '.')
+        {
+            ++p;
+            if (*p == '*')
+            {
+                ++p;
+                precision = va_arg(args, int);
+            }
+            else
+            {
+                precision = 0;
+                while (*p >= '0' && *p <= '9')
                 {
+                    if (precision <= static_cast<int>(max_width))
+                        precision = precision * 10 + (*p - '0');
                     ++p;
-                    int arg = va_arg(args, int);
-                    out = signal_safe_write_int(out, 10, arg);
-                    break;
                 }
-                case 'l':
+            }
+            if (precision > static_cast<int>(max_width))
+                precision = max_width;
+        }
+
+        // Length modifier.
+        enum { length_int, length_char, length_short, length_long, length_long_long, length_size, length_intmax, length_ptrdiff } length = length_int;
+        if (*p == 'h')
+        {
+            ++p;
+            length = length_short;
+            if (*p == 'h') { ++p; length = length_char; }
+        }
+        else if (*p == 'l')
+        {
+            ++p;
+            length = length_long;
+            if (*p == 'l') { ++p; length = length_long_long; }
+        }
+        else if (*p == 'z') { ++p; length = length_size; }
+        else if (*p == 'j') { ++p; length = length_intmax; }
+        else if (*p == 't') { ++p; length = length_ptrdiff; }
+
+        char const conversion = *p;
+        if (conversion == '\0')
+        {
+            // Incomplete conversion specification at the end of the format string.
+            write(spec, p - spec);
+            break;
+        }
+        ++p;
+
+        switch (conversion)
+        {
+            case '%':
+                write("%", 1);
+                break;
+            case 'c':
+            {
+                char c = va_arg(args, int);
+                if (!left && width > 1)
+                    put(' ', width - 1);
+                write(&c, 1);
+                if (left && width > 1)
+                    put(' ', width - 1);
+                break;
+            }
+            case 's':
+            {
+                char const* str = va_arg(args, char const*);
+                if (!str)
+                    str = "(null)";
+                size_t len = 0;
+                while (str[len] && (precision < 0 || len < static_cast<size_t>(precision)))
+                    ++len;
+                if (!left && width > len)
+                    put(' ', width - len);
+                write(str, len);
+                if (left && width > len)
+                    put(' ', width - len);
+                break;
+            }
+            case 'd':
+            case 'i':
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o':
+            case 'p':
+            {
+                unsigned long long magnitude;
+                bool negative = false;
+                unsigned int base = conversion == 'o' ? 8 : (conversion == 'x' || conversion == 'X' || conversion == 'p') ? 16 : 10;
+                if (conversion == 'p')
                 {
-                    ++p;
-                    if (*p == 'u' || *p == 'x') // %lu and %lx
+                    magnitude = reinterpret_cast<uintptr_t>(va_arg(args, void*));
+                    if (magnitude == 0)
                     {
-                        int base = (*p == 'u') ? 10 : 16;
-                        unsigned long arg = va_arg(args, unsigned long);
-                        out = signal_safe_write_int(out, base, arg);
+                        // Same as glibc.
+                        char const* nil = "(nil)";
+                        if (!left && width > 5)
+                            put(' ', width - 5);
+                        write(nil, 5);
+                        if (left && width > 5)
+                            put(' ', width - 5);
                         break;
                     }
-                    else if (*p == 'd')         // %ld
-                    {
-                        long arg = va_arg(args, long);
-                        out = signal_safe_write_int(out, 10, arg);
-                        break;
-                    }
-                    *out++ = 'l';
-                    break;
+                    alternate = true;
                 }
-                case 's':       // %s
+                else if (conversion == 'd' || conversion == 'i')
                 {
-                    ++p;
-                    char const* str = va_arg(args, char const*);
-                    while (*str) *out++ = *str++;
-                    break;
+                    long long val;
+                    switch (length)
+                    {
+                        case length_char: val = static_cast<signed char>(va_arg(args, int)); break;
+                        case length_short: val = static_cast<short>(va_arg(args, int)); break;
+                        case length_long: val = va_arg(args, long); break;
+                        case length_long_long: val = va_arg(args, long long); break;
+                        case length_size: val = va_arg(args, ssize_t); break;
+                        case length_intmax: val = va_arg(args, intmax_t); break;
+                        case length_ptrdiff: val = va_arg(args, ptrdiff_t); break;
+                        default: val = va_arg(args, int); break;
+                    }
+                    negative = val < 0;
+                    magnitude = negative ? -static_cast<unsigned long long>(val) : val;
                 }
-                case 'u':       // %u
+                else
                 {
-                    ++p;
-                    unsigned int arg = va_arg(args, unsigned int);
-                    out = signal_safe_write_int(out, 10, arg);
-                    break;
+                    switch (length)
+                    {
+                        case length_char: magnitude = static_cast<unsigned char>(va_arg(args, unsigned int)); break;
+                        case length_short: magnitude = static_cast<unsigned short>(va_arg(args, unsigned int)); break;
+                        case length_long: magnitude = va_arg(args, unsigned long); break;
+                        case length_long_long: magnitude = va_arg(args, unsigned long long); break;
+                        case length_size: magnitude = va_arg(args, size_t); break;
+                        case length_intmax: magnitude = va_arg(args, uintmax_t); break;
+                        case length_ptrdiff: magnitude = va_arg(args, ptrdiff_t); break;
+                        default: magnitude = va_arg(args, unsigned int); break;
+                    }
                 }
-                case 'x':       // %x
+
+                char digits[24];        // Enough for 2^64 in octal (22 digits).
+                char* const end = digits + sizeof(digits);
+                char* first = format_unsigned(end, magnitude, base, conversion == 'X');
+                size_t num_digits = end - first;
+                // The default precision is 1; printf("%.0d", 0) prints nothing.
+                size_t const min_digits = precision < 0 ? 1 : precision;
+                size_t leading_zeros = num_digits < min_digits ? min_digits - num_digits : 0;
+                if (base == 8 && alternate && leading_zeros == 0)
+                    leading_zeros = 1;
+
+                char prefix[2];
+                size_t prefix_len = 0;
+                if (negative)
+                    prefix[prefix_len++] = '-';
+                else if ((conversion == 'd' || conversion == 'i') && plus)
+                    prefix[prefix_len++] = '+';
+                else if ((conversion == 'd' || conversion == 'i') && space)
+                    prefix[prefix_len++] = ' ';
+                else if (base == 16 && alternate && magnitude != 0)
                 {
-                    ++p;
-                    int arg = va_arg(args, int);
-                    out = signal_safe_write_int(out, 16, arg);
-                    break;
+                    prefix[prefix_len++] = '0';
+                    prefix[prefix_len++] = conversion == 'X' ? 'X' : 'x';
                 }
-                default:
-                    break;
+
+                size_t const len = prefix_len + leading_zeros + num_digits;
+                size_t const padding = width > len ? width - len : 0;
+                // The '0' flag is ignored when a precision is given or together with '-'.
+                if (zero && !left && precision < 0)
+                    leading_zeros += padding;
+                else if (!left)
+                    put(' ', padding);
+                write(prefix, prefix_len);
+                put('0', leading_zeros);
+                write(first, num_digits);
+                if (left)
+                    put(' ', padding);
+                break;
             }
+            default:
+                // Unsupported conversion: copy it verbatim.
+                write(spec, p - spec);
+                break;
         }
-        else
-            *out++ = *p++;
     }
+}
+
+void signal_safe_printf(char const* fmt, ...)
+{
+    SignalSafeBufferedWriter<512> out(STDOUT_FILENO);
+    va_list args;
+    va_start(args, fmt);
+    out.vprintf(fmt, args);
     va_end(args);
-    size_t s = out - buf;
-    assert(s <= sizeof(buf));
-    [[maybe_unused]] size_t wlen = write(STDOUT_FILENO, buf, s);
-    assert(wlen == s);
 }
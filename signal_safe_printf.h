@@ -11,5 +11,83 @@
 #pragma once
 
 #include <cstdarg>
+#include <cstddef>
+#include <sys/uio.h>
+#include <unistd.h>
 
-void signal_safe_printf(char const* fmt, ...);
+// Async-signal-safe, bounded printf.
+//
+// Supported conversions: %d, %i, %u, %x, %X, %o, %c, %s, %p and %%,
+// with the flags '-', '0', '+', ' ' and '#', a width and a precision (both may be '*')
+// and the length modifiers hh, h, l, ll, z, j and t. A width or precision larger than
+// SignalSafeWriter::max_width is reduced to max_width.
+//
+// Output never overflows the buffer: if it is full then it is flushed first.
+
+// Write formatted output to a file descriptor, batched with writev(2).
+//
+// Usage (for example in a signal handler):
+//
+//   SignalSafeBufferedWriter<4096> out(STDERR_FILENO);
+//   out.printf("Caught signal %d at %p\n", signum, address);
+//   out.write_ref(big_table, big_table_size);     // Not copied; must stay valid until flush().
+//   out.printf("%zu entries\n", count);
+//   // The destructor calls flush(), which does a single writev.
+//
+class SignalSafeWriter
+{
+ public:
+  static constexpr int max_iovecs = 16;         // The maximum number of buffers that are written with a single writev.
+  static constexpr size_t max_width = 4096;     // The maximum width and precision of a conversion.
+
+ private:
+  int m_fd;
+  char* m_buffer;               // Storage for formatted output.
+  size_t m_capacity;            // The size of m_buffer.
+  size_t m_size;                // The number of bytes used in m_buffer.
+  struct iovec m_iov[max_iovecs];
+  int m_iovcnt;                 // The number of used entries in m_iov.
+  bool m_error;                 // Set when writev failed.
+
+ public:
+  SignalSafeWriter(char* buffer, size_t capacity, int fd = STDOUT_FILENO) :
+    m_fd(fd), m_buffer(buffer), m_capacity(capacity), m_size(0), m_iovcnt(0), m_error(false) { }
+  virtual ~SignalSafeWriter() { flush(); }
+
+  SignalSafeWriter(SignalSafeWriter const&) = delete;
+  SignalSafeWriter& operator=(SignalSafeWriter const&) = delete;
+
+  [[gnu::format(printf, 2, 3)]] void printf(char const* fmt, ...);
+  void vprintf(char const* fmt, va_list args);
+
+  // Copy len bytes of data into the buffer.
+  void write(char const* data, size_t len);
+  // Add data as a separate buffer to the next writev, without copying it. Data must stay valid until flush().
+  void write_ref(char const* data, size_t len);
+
+  // Write everything with writev(2). Returns false if that failed (for example because m_fd was closed).
+  bool flush();
+
+ protected:
+  // Write iovcnt buffers; called by flush(). Returns false on failure.
+  // Derived classes that override this must call flush() from their destructor.
+  virtual bool write_iovecs(struct iovec* iov, int iovcnt);
+
+ private:
+  void put(char c, size_t count);
+  struct iovec* add_iovec();
+};
+
+template<size_t size>
+class SignalSafeBufferedWriter : public SignalSafeWriter
+{
+ private:
+  char m_storage[size];
+
+ public:
+  SignalSafeBufferedWriter(int fd = STDOUT_FILENO) : SignalSafeWriter(m_storage, size, fd) { }
+  ~SignalSafeBufferedWriter() { flush(); }      // Flush while m_storage still exists.
+};
+
+// Write formatted output to STDOUT_FILENO (with one system call for up to 512 bytes of output).
+[[gnu::format(printf, 1, 2)]] void signal_safe_printf(char const* fmt, ...);
@@ -0,0 +1,235 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief This file contains the definition of signal_safe_trace.
+ */
+
+#include "sys.h"
+#include "signal_safe_trace.h"
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <sys/syscall.h>
+
+namespace {
+
+struct TraceBuffer
+{
+  std::atomic<pid_t> m_tid;             // The thread that owns this buffer, or 0 when it is free.
+  std::atomic<uint64_t> m_written;      // The total number of bytes reserved.
+  std::atomic<uint64_t> m_committed;    // The total number of bytes reserved and copied into m_data.
+  std::atomic<int> m_writers;           // The number of (nested) writers that are copying into m_data.
+  std::atomic<uint64_t> m_flushed;      // The value of m_committed at the last flush.
+  char* m_data;                         // The circular buffer.
+};
+
+size_t s_capacity;                      // The size of each circular buffer; a power of two.
+int s_max_threads;
+TraceBuffer* s_buffers;                 // Array of s_max_threads TraceBuffer's.
+int s_fatal_fd = STDERR_FILENO;
+
+// Initial-exec, so that accessing it from a signal handler never allocates.
+[[gnu::tls_model("initial-exec")]] thread_local TraceBuffer* t_buffer;
+[[gnu::tls_model("initial-exec")]] thread_local bool t_no_buffer;       // Set if there was no free buffer.
+
+TraceBuffer* claim_buffer()
+{
+  if (t_buffer || t_no_buffer || !s_buffers)
+    return t_buffer;
+  pid_t const tid = ::syscall(SYS_gettid);
+  for (int i = 0; i < s_max_threads; ++i)
+  {
+    pid_t expected = 0;
+    if (s_buffers[i].m_tid.compare_exchange_strong(expected, tid, std::memory_order_acq_rel))
+    {
+      t_buffer = &s_buffers[i];
+      return t_buffer;
+    }
+  }
+  t_no_buffer = true;
+  return nullptr;
+}
+
+// A SignalSafeWriter that appends to the circular buffer of the calling thread.
+//
+// The output of one signal_safe_trace is collected in m_record and appended to the
+// circular buffer with a single reservation, so that the output of another writer
+// (a signal handler that interrupts us) can't end up in the middle of it. Output
+// beyond max_record bytes is truncated.
+class TraceWriter : public SignalSafeWriter
+{
+ public:
+  static constexpr size_t max_record = 1024;
+
+ private:
+  TraceBuffer* m_trace_buffer;
+  char m_storage[256];
+  char m_record[max_record];
+  size_t m_record_size;
+  bool m_truncated;
+
+ public:
+  TraceWriter(TraceBuffer* trace_buffer) :
+    SignalSafeWriter(m_storage, sizeof(m_storage), -1), m_trace_buffer(trace_buffer), m_record_size(0), m_truncated(false) { }
+  ~TraceWriter() { flush(); commit(); }
+
+ protected:
+  bool write_iovecs(struct iovec* iov, int iovcnt) override
+  {
+    for (int i = 0; i < iovcnt; ++i)
+    {
+      size_t n = iov[i].iov_len;
+      if (n > max_record - m_record_size)
+      {
+        n = max_record - m_record_size;
+        m_truncated = true;
+      }
+      std::memcpy(m_record + m_record_size, iov[i].iov_base, n);
+      m_record_size += n;
+    }
+    return true;
+  }
+
+ private:
+  void commit()
+  {
+    if (m_truncated)
+    {
+      // Mark the truncation and end the line.
+      static constexpr char marker[] = "...\n";
+      std::memcpy(m_record + max_record - (sizeof(marker) - 1), marker, sizeof(marker) - 1);
+    }
+    size_t const len = m_record_size;
+    if (len == 0)
+      return;
+    // Reserve len bytes at once, so that output of a signal handler that interrupts us can't end up in the middle.
+    m_trace_buffer->m_writers.fetch_add(1, std::memory_order_relaxed);
+    uint64_t pos = m_trace_buffer->m_written.fetch_add(len, std::memory_order_relaxed);
+    char const* data = m_record;
+    size_t n = len;
+    while (n > 0)
+    {
+      size_t const offset = pos & (s_capacity - 1);
+      size_t const chunk = n < s_capacity - offset ? n : s_capacity - offset;
+      std::memcpy(m_trace_buffer->m_data + offset, data, chunk);
+      pos += chunk;
+      data += chunk;
+      n -= chunk;
+    }
+    // Only the owning thread (and signal handlers that interrupt it) write to the buffer, so writers are
+    // nested: when the outer most writer is done, everything that was reserved has been copied.
+    if (m_trace_buffer->m_writers.fetch_sub(1, std::memory_order_relaxed) == 1)
+    {
+      uint64_t const written = m_trace_buffer->m_written.load(std::memory_order_relaxed);
+      // A signal handler that interrupts us here might already have committed more.
+      uint64_t committed = m_trace_buffer->m_committed.load(std::memory_order_relaxed);
+      while (committed < written && !m_trace_buffer->m_committed.compare_exchange_weak(committed, written, std::memory_order_release))
+        ;
+    }
+  }
+};
+
+void fatal_signal_handler(int signum)
+{
+  signal_safe_trace_flush(s_fatal_fd);          // Preserves errno.
+  // SA_RESETHAND restored the default action.
+  ::raise(signum);
+}
+
+} // namespace
+
+void signal_safe_trace_init(size_t bytes_per_thread, int max_threads)
+{
+  assert(!s_buffers && max_threads > 0 && bytes_per_thread > 0);
+  size_t capacity = 1;
+  while (capacity < bytes_per_thread)
+    capacity <<= 1;
+  s_capacity = capacity;
+  s_max_threads = max_threads;
+  TraceBuffer* buffers = new TraceBuffer[max_threads];
+  for (int i = 0; i < max_threads; ++i)
+  {
+    buffers[i].m_tid = 0;
+    buffers[i].m_written = 0;
+    buffers[i].m_committed = 0;
+    buffers[i].m_writers = 0;
+    buffers[i].m_flushed = 0;
+    buffers[i].m_data = new char[capacity];
+  }
+  s_buffers = buffers;
+}
+
+bool signal_safe_trace_register_thread()
+{
+  return claim_buffer() != nullptr;
+}
+
+void signal_safe_trace(char const* fmt, ...)
+{
+  TraceBuffer* buffer = claim_buffer();
+  if (!buffer)
+    return;
+  TraceWriter out(buffer);
+  va_list args;
+  va_start(args, fmt);
+  out.vprintf(fmt, args);
+  va_end(args);
+}
+
+void signal_safe_trace_flush(int fd)
+{
+  if (!s_buffers)
+    return;
+  // We might be called from a signal handler; write(2) can change errno.
+  int const saved_errno = errno;
+  SignalSafeBufferedWriter<128> out(fd);
+  for (int i = 0; i < s_max_threads; ++i)
+  {
+    TraceBuffer& buffer = s_buffers[i];
+    pid_t const tid = buffer.m_tid.load(std::memory_order_acquire);
+    if (tid == 0)
+      continue;
+    // Only write what was copied completely; bytes that are reserved but not copied yet contain garbage.
+    uint64_t const committed = buffer.m_committed.load(std::memory_order_acquire);
+    uint64_t begin = buffer.m_flushed.exchange(committed, std::memory_order_acq_rel);
+    if (begin >= committed)
+      continue;
+    // The oldest committed bytes are overwritten by reservations beyond committed.
+    uint64_t const written = buffer.m_written.load(std::memory_order_relaxed);
+    if (written - begin > s_capacity)
+    {
+      out.printf("--- thread %d: %llu bytes lost ---\n", tid, static_cast<unsigned long long>(written - begin - s_capacity));
+      begin = written - s_capacity;
+      if (begin >= committed)
+        continue;
+    }
+    out.printf("--- thread %d ---\n", tid);
+    size_t const offset = begin & (s_capacity - 1);
+    size_t const len = committed - begin;
+    size_t const first = len < s_capacity - offset ? len : s_capacity - offset;
+    out.write_ref(buffer.m_data + offset, first);
+    out.write_ref(buffer.m_data, len - first);
+    out.flush();
+  }
+  errno = saved_errno;
+}
+
+void signal_safe_trace_install_fatal_handlers(int fd)
+{
+  s_fatal_fd = fd;
+  struct sigaction action;
+  std::memset(&action, 0, sizeof(action));
+  action.sa_handler = fatal_signal_handler;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESETHAND | SA_ONSTACK;
+  for (int signum : { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT })
+    ::sigaction(signum, &action, nullptr);
+}
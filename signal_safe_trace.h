@@ -0,0 +1,61 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief This file contains the declaration of signal_safe_trace.
+ */
+
+#pragma once
+
+#include "signal_safe_printf.h"
+#include <cstddef>
+#include <unistd.h>
+
+// An in-memory, per-thread trace buffer that can be written to from signal handlers.
+//
+// Usage:
+//
+//   signal_safe_trace_init(1 << 20);                   // Once, before any tracing.
+//   signal_safe_trace_install_fatal_handlers();        // Optional: dump the traces on SIGSEGV, SIGABRT, etc.
+//   signal_safe_trace_register_thread();               // Optional, in each thread; see below.
+//
+//   void sigprof_handler(int, siginfo_t* info, void* context)
+//   {
+//     signal_safe_trace("sample %p\n", pc_of(context));        // No system calls.
+//   }
+//   ...
+//   signal_safe_trace_flush(STDERR_FILENO);            // Write everything that wasn't flushed before.
+//
+// signal_safe_trace formats like signal_safe_printf (see signal_safe_printf.h), but
+// appends the result to a circular buffer of the calling thread instead of calling
+// write(2). Space is reserved with a single atomic fetch_add, so a signal handler
+// that interrupts the same thread while it is tracing doesn't corrupt the buffer.
+// The output of one call is never split; output beyond 1024 bytes is truncated
+// and ends in "...\n".
+// Once a buffer is full the oldest output is overwritten.
+//
+// A thread claims one of the preallocated buffers the first time it traces (lock-free).
+// That does one gettid system call; call signal_safe_trace_register_thread() from
+// the thread to do that up front. A buffer is never released, so that the trace
+// of a thread that exited can still be flushed. When all buffers are in use, the
+// output of new threads is dropped.
+
+// Allocate max_threads buffers of bytes_per_thread bytes (rounded up to a power of two). Not async-signal-safe.
+void signal_safe_trace_init(size_t bytes_per_thread = 64 * 1024, int max_threads = 64);
+
+// Claim a buffer for the calling thread. Returns false if there is no free buffer.
+bool signal_safe_trace_register_thread();
+
+// Append formatted output to the buffer of the calling thread. Async-signal-safe; does not do system calls.
+[[gnu::format(printf, 1, 2)]] void signal_safe_trace(char const* fmt, ...);
+
+// Write all output that was not flushed before, per thread, to fd. Async-signal-safe; preserves errno.
+// Output that is still being written (by a thread that is interrupted, or running concurrently) isn't included.
+void signal_safe_trace_flush(int fd = STDERR_FILENO);
+
+// Install handlers for SIGSEGV, SIGBUS, SIGILL, SIGFPE and SIGABRT that call
+// signal_safe_trace_flush(fd) and then re-raise the signal with the default action.
+void signal_safe_trace_install_fatal_handlers(int fd = STDERR_FILENO);
@@ -0,0 +1,51 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief Test that ScalingBenchmark::measure returns when one thread throws.
+ *
+ * The functor throws the first time that it is called, on one of the threads,
+ * after all threads started measuring. measure() must rethrow that exception
+ * instead of waiting forever for the thread to converge.
+ * The exit code is 0 on success and 1 on failure.
+ */
+
+#include "sys.h"
+#include "ScalingBenchmark.h"
+#include "debug.h"
+#include <atomic>
+#include <iostream>
+#include <sched.h>
+#include <stdexcept>
+
+int main()
+{
+  Debug(NAMESPACE_DEBUG::init());
+
+  benchmark::ScalingBenchmark scaling;
+  if (scaling.max_threads() < 2)
+  {
+    // Run both threads on the only CPU that we may use.
+    unsigned int const cpu = sched_getcpu();
+    scaling = benchmark::ScalingBenchmark({cpu, cpu});
+  }
+  scaling.calibrate_overhead(100, 3);
+
+  std::atomic<bool> thrown{false};
+  try
+  {
+    scaling.measure(2, 100, [&thrown](){
+      if (!thrown.exchange(true))
+        throw std::runtime_error("functor failed");
+    });
+  }
+  catch (std::runtime_error const&)
+  {
+    return 0;
+  }
+  std::cerr << "FAILED: measure() did not rethrow the exception of the functor." << std::endl;
+  return 1;
+}
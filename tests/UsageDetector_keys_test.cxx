@@ -0,0 +1,154 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief Test UsageDetector with keys that are not indices into a sequence.
+ *
+ * The integral keys of a std::map or std::set (negative, huge or ordered by
+ * a custom Compare) must be counted per key in profile mode, and at() with an
+ * out of range index must throw before anything is recorded. Every modifying
+ * member function (emplace, the hinted insert, erase(iterator), extract, ...)
+ * must record the key that it modifies. The number of keys that is counted is
+ * bounded, while the hottest key is still counted exactly.
+ *
+ * This file is compiled twice: once as is, and once with CWDS_USAGE_DETECTOR_PROFILE=1,
+ * in which case the printed summaries are captured and the counts are checked too.
+ * The exit code is 0 on success and 1 on failure.
+ */
+
+#include "sys.h"
+#include "UsageDetector.h"
+#include "debug.h"
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, char const* what)
+{
+  if (!ok)
+  {
+    std::cerr << "FAILED: " << what << std::endl;
+    ++failures;
+  }
+}
+
+#if CWDS_USAGE_DETECTOR_PROFILE
+// The output of dc::usage_detector.
+std::ostringstream captured;
+
+void check_output(char const* expected)
+{
+  if (captured.str().find(expected) == std::string::npos)
+  {
+    std::cerr << "FAILED: missing \"" << expected << "\" in the profile output." << std::endl;
+    ++failures;
+  }
+}
+#endif
+
+} // namespace
+
+int main()
+{
+  Debug(NAMESPACE_DEBUG::init());
+#if CWDS_USAGE_DETECTOR_PROFILE
+  std::ostream* original_ostream = libcwd::libcw_do.get_ostream();
+  Debug(libcw_do.set_ostream(&captured));
+  Debug(if (!dc::usage_detector.is_on()) dc::usage_detector.on());
+#endif
+
+  {
+    NAMESPACE_DEBUG::UsageDetector<std::map<int, int>> map("map");
+    map[-1] = 1;
+    map[1000000000] = 2;
+    map[-1000000000] = 3;
+    check(map.at(-1) == 1, "map.at(-1)");
+    check(map.find(-7) == map.end(), "map.find(-7)");
+    check(map.count(1000000000) == 1, "map.count(1000000000)");
+  }
+
+  {
+    NAMESPACE_DEBUG::UsageDetector<std::map<long, int, std::greater<long>>> map("map_greater");
+    map[-5] = 1;
+    map[5] = 2;
+    check(map.begin()->first == 5, "std::greater map order");
+  }
+
+#if CWDS_USAGE_DETECTOR_PROFILE
+  // Not in trace mode: there the member functions that take an iterator print it, which requires an operator<<.
+  {
+    NAMESPACE_DEBUG::UsageDetector<std::map<int, int>> map("map_emplace");
+    for (int i = 0; i < 10; ++i)
+      map.emplace(i, i);
+    map.erase(map.begin());
+    map.emplace_hint(map.end(), 20, 1);
+    map.insert(map.end(), std::pair<int, int>{21, 1});
+    auto node = map.extract(map.begin());
+    map.insert(std::move(node));
+    check(map.size() == 11, "map_emplace.size()");
+  }
+
+  {
+    // Looking up many different keys that are not in the container must not make the profile grow without bound.
+    NAMESPACE_DEBUG::UsageDetector<std::unordered_map<int, int>> map("unordered_map");
+    map[0] = 0;
+    for (int i = 1; i <= 100000; ++i)
+    {
+      check(map.find(i) == map.end(), "unordered_map.find(i)");
+      check(map.find(0) != map.end(), "unordered_map.find(0)");
+    }
+  }
+#endif
+
+  {
+    NAMESPACE_DEBUG::UsageDetector<std::set<int>> set("set");
+    set.insert(-1);
+    set.insert(-1000000000);
+    set.insert(1000000000);
+    check(set.contains(-1), "set.contains(-1)");
+    check(!set.contains(-2), "!set.contains(-2)");
+    check(set.size() == 3, "set.size()");
+  }
+
+  {
+    NAMESPACE_DEBUG::UsageDetector<std::vector<int>> vector("vector");
+    vector.push_back(42);
+    bool thrown = false;
+    try
+    {
+      vector.at(1000000000) = 0;
+    }
+    catch (std::out_of_range const&)
+    {
+      thrown = true;
+    }
+    check(thrown, "vector.at(1000000000) throws");
+    check(vector.at(0) == 42, "vector.at(0)");
+  }
+
+#if CWDS_USAGE_DETECTOR_PROFILE
+  Debug(libcw_do.set_ostream(original_ostream));
+  // operator[] and the non-const at() are writes; find, count and contains are reads.
+  // The out of range vector.at() is not recorded.
+  check_output("map: 2 reads, 4 writes");
+  check_output("[-1000000000] 0r/1w");
+  check_output("[-7] 1r/0w");
+  check_output("map_greater: 0 reads, 2 writes");
+  check_output("map_emplace: 0 reads, 15 writes");
+  check_output("[1] 0r/3w");
+  check_output("set: 2 reads, 3 writes");
+  check_output("[-2] 1r/0w");
+  check_output("vector: 0 reads, 2 writes");
+#endif
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+// SPDX-FileCopyrightText: 2026 Carlo Wood
+// SPDX-License-Identifier: MIT
+
+/**
+ * cwds -- Application-side libcwd support code.
+ *
+ * @file
+ * @brief Test the conversions of SignalSafeWriter::printf against snprintf.
+ *
+ * Every format is printed with a SignalSafeBufferedWriter (that writes into a
+ * string instead of a file descriptor) and with snprintf, and the results must
+ * be the same. Widths beyond SignalSafeWriter::max_width, including a '*' width
+ * of INT_MIN, must be reduced to max_width.
+ * The exit code is 0 on success and 1 on failure.
+ */
+
+#include "sys.h"
+#include "signal_safe_printf.h"
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+namespace {
+
+int failures = 0;
+
+// A SignalSafeBufferedWriter that appends to a string.
+class StringWriter : public SignalSafeBufferedWriter<64>
+{
+ private:
+  std::string& m_output;
+
+ public:
+  StringWriter(std::string& output) : SignalSafeBufferedWriter<64>(-1), m_output(output) { }
+  ~StringWriter() { flush(); }
+
+ protected:
+  bool write_iovecs(struct iovec* iov, int iovcnt) override
+  {
+    for (int i = 0; i < iovcnt; ++i)
+      m_output.append(static_cast<char const*>(iov[i].iov_base), iov[i].iov_len);
+    return true;
+  }
+};
+
+template<typename... Args>
+std::string signal_safe_format(char const* fmt, Args... args)
+{
+  std::string output;
+  {
+    StringWriter out(output);
+    out.printf(fmt, args...);
+  }
+  return output;
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#pragma GCC diagnostic ignored "-Wformat-security"
+template<typename... Args>
+void check(char const* fmt, Args... args)
+{
+  char expected[256];
+  std::snprintf(expected, sizeof(expected), fmt, args...);
+  std::string const result = signal_safe_format(fmt, args...);
+  if (result != expected)
+  {
+    std::cerr << "FAILED: format \"" << fmt << "\": got \"" << result << "\", expected \"" << expected << "\"." << std::endl;
+    ++failures;
+  }
+}
+#pragma GCC diagnostic pop
+
+} // namespace
+
+int main()
+{
+  // Integers.
+  check("%d %d %d", 0, 42, -42);
+  check("%d %d", INT_MIN, INT_MAX);
+  check("%i %u", -7, 4000000000u);
+  check("%hhd %hd %hhu %hu", 300, 70000, 300, 70000);
+  check("%ld %lu", LONG_MIN, ULONG_MAX);
+  check("%lld %llx", LLONG_MIN, ULLONG_MAX);
+  check("%zu %zd %jd %td", static_cast<size_t>(123), static_cast<ssize_t>(-123), static_cast<intmax_t>(-5), static_cast<ptrdiff_t>(-6));
+  check("%x %X %o", 0xbeefu, 0xbeefu, 8u);
+
+  // Flags.
+  check("[%5d] [%-5d] [%05d] [%-05d]", 42, 42, 42, 42);
+  check("[%+d] [%+d] [% d] [% d] [%+ d]", 42, -42, 42, -42, 42);
+  check("[%#x] [%#X] [%#o] [%#x] [%#o]", 255u, 255u, 8u, 0u, 0u);
+  check("[%08x] [%#08x] [%+05d] [%05d]", 255u, 255u, 42, -42);
+
+  // Precision.
+  check("[%.3d] [%8.3d] [%-8.3d] [%08.3d]", 42, 42, -42, 42);
+  check("[%.0d] [%.0x] [%5.0d] [%#.0o]", 0, 0u, 0, 0u);
+  check("[%.5x] [%#.5x]", 255u, 255u);
+
+  // Characters and strings.
+  check("[%c] [%3c] [%-3c]", 'a', 'b', 'c');
+  check("[%s] [%10s] [%-10s] [%.2s] [%5.1s]", "abc", "abc", "abc", "abc", "abc");
+  check("[%s]", static_cast<char const*>(nullptr));
+  check("[%%]");
+
+  // '*' width and precision.
+  check("[%*d] [%*d] [%-*d]", 5, 42, -5, 42, 5, 42);
+  check("[%.*d] [%.*d] [%.*s] [%*.*s]", 4, 42, -1, 42, 3, "abcdef", 6, 2, "abcdef");
+
+  // Pointers.
+  int object;
+  check("[%p] [%20p] [%-20p]", static_cast<void*>(&object), static_cast<void*>(&object), static_cast<void*>(&object));
+  check("[%p] [%8p]", static_cast<void*>(nullptr), static_cast<void*>(nullptr));
+
+  // Widths that are too large.
+  std::string const int_min_width = signal_safe_format("%*d|", INT_MIN, 42);
+  if (int_min_width != "42" + std::string(SignalSafeWriter::max_width - 2, ' ') + '|')
+  {
+    std::cerr << "FAILED: a '*' width of INT_MIN wasn't reduced to max_width." << std::endl;
+    ++failures;
+  }
+  std::string const huge_width = signal_safe_format("%99999999999999999999999d|", 42);
+  if (huge_width != std::string(SignalSafeWriter::max_width - 2, ' ') + "42|")
+  {
+    std::cerr << "FAILED: a huge width wasn't reduced to max_width." << std::endl;
+    ++failures;
+  }
+
+  return failures == 0 ? 0 : 1;
+}
@@ -4,17 +4,18 @@
 #pragma once
 
 #include <debug.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
 #include <new>
 #include <ostream>
+#include <unordered_map>
 #include <vector>
 
-// boost is optional for cwds; but you want to use this header in your project then boost needs to be installed.
-#ifdef HAVE_LIBBOOST
-#include <boost/range/adaptor/reversed.hpp>
-#else
-#error "Cannot use cwds/tracked.h without having libboost installed."
-#endif
-
 NAMESPACE_DEBUG_CHANNELS_START
 extern Channel tracked;
 NAMESPACE_DEBUG_CHANNELS_END
@@ -27,6 +28,154 @@ NAMESPACE_DEBUG_CHANNELS_END
 
 namespace tracked {
 
+// The maximum number of destructed entries that are kept per tracked type; zero means no limit.
+inline std::atomic<std::size_t> s_max_dead_entries{0};
+
+// The entries of all tracked objects of one type.
+//
+// The registry is sharded by the address of the object, each shard with its own mutex,
+// so that threads that create and destroy different objects rarely contend.
+// Entries are never moved, so pointers to them stay valid. By default entries are
+// never removed either; see limit_history() for the bounded-memory mode, in which
+// the storage of the oldest destructed entries is reused.
+template<typename Entry>
+class Registry
+{
+ public:
+  static constexpr int shard_bits = 4;
+  static constexpr std::size_t number_of_shards = std::size_t{1} << shard_bits;
+
+ private:
+  struct Shard
+  {
+    std::mutex m_mutex;
+    std::deque<Entry> m_entries;
+    std::unordered_map<void const*, Entry*> m_by_address;       // The last Entry of each address; for the lookup of a single object.
+    std::map<void const*, Entry*> m_by_range;                   // The same, ordered by address; for the lookup of all objects in a deleted range.
+    std::deque<Entry*> m_dead;                                  // Destructed entries, oldest first (only in bounded-memory mode).
+    std::vector<Entry*> m_free;                                 // Recycled entries that can be reused.
+  };
+
+  std::array<Shard, number_of_shards> m_shards;
+  std::atomic<std::ptrdiff_t> m_next_id{0};
+
+  Shard& shard_of(void const* address)
+  {
+    // Fibonacci hashing, so that consecutive (small) objects end up in different shards.
+    return m_shards[(reinterpret_cast<std::uintptr_t>(address) * UINT64_C(0x9e3779b97f4a7c15)) >> (64 - shard_bits)];
+  }
+
+ public:
+  // Add a new Entry for address. The Entry gets the next id.
+  // Returns the id of the previous Entry of address if that object was never destructed (it leaked), or -1.
+  template<typename... Args>
+  std::ptrdiff_t add(void const* address, Args&&... args)
+  {
+    Shard& shard = shard_of(address);
+    std::lock_guard<std::mutex> lock(shard.m_mutex);
+    std::ptrdiff_t leaked = -1;
+    if (auto iter = shard.m_by_address.find(address); iter != shard.m_by_address.end() && !iter->second->status_destructed())
+      leaked = iter->second->id();
+    Entry* slot;
+    if (shard.m_free.empty())
+      slot = &shard.m_entries.emplace_back(m_next_id++, std::forward<Args>(args)...);
+    else
+    {
+      slot = shard.m_free.back();
+      shard.m_free.pop_back();
+      slot->~Entry();
+      new (slot) Entry(m_next_id++, std::forward<Args>(args)...);
+    }
+    Entry& entry = *slot;
+    shard.m_by_address[address] = &entry;
+    shard.m_by_range[address] = &entry;
+    return leaked;
+  }
+
+  // Called once when entry was destructed. In bounded-memory mode, recycle the oldest
+  // destructed entries of the shard once there are more than its share of s_max_dead_entries.
+  void retire(Entry* entry)
+  {
+    std::size_t const max_dead_entries = s_max_dead_entries.load(std::memory_order_relaxed);
+    if (max_dead_entries == 0)
+      return;
+    std::size_t const limit = (max_dead_entries + number_of_shards - 1) / number_of_shards;
+    void const* const address = entry->address();
+    Shard& shard = shard_of(address);
+    std::lock_guard<std::mutex> lock(shard.m_mutex);
+    shard.m_dead.push_back(entry);
+    while (shard.m_dead.size() > limit)
+    {
+      Entry* oldest = shard.m_dead.front();
+      shard.m_dead.pop_front();
+      // Only remove it from the indices if no newer object took its address.
+      if (auto iter = shard.m_by_address.find(oldest->address()); iter != shard.m_by_address.end() && iter->second == oldest)
+      {
+        shard.m_by_address.erase(iter);
+        shard.m_by_range.erase(oldest->address());
+      }
+      shard.m_free.push_back(oldest);
+    }
+  }
+
+  // Return the last Entry of address, or nullptr if there is none.
+  Entry* find(void const* address)
+  {
+    Shard& shard = shard_of(address);
+    std::lock_guard<std::mutex> lock(shard.m_mutex);
+    auto iter = shard.m_by_address.find(address);
+    return iter == shard.m_by_address.end() ? nullptr : iter->second;
+  }
+
+  // A snapshot of an Entry, taken while holding the lock of its shard.
+  struct Found
+  {
+    void const* address;
+    Entry* entry;
+    std::ptrdiff_t id;          // The id of entry at the time it was found; entry might be recycled afterwards.
+
+    bool operator<(Found const& found) const { return address < found.address; }
+  };
+
+  // Return the last Entry of every address in [begin, end), ordered by address.
+  std::vector<Found> range(void const* begin, void const* end)
+  {
+    std::vector<Found> result;
+    for (Shard& shard : m_shards)
+    {
+      std::lock_guard<std::mutex> lock(shard.m_mutex);
+      for (auto iter = shard.m_by_range.lower_bound(begin); iter != shard.m_by_range.end() && iter->first < end; ++iter)
+        result.push_back({ iter->first, iter->second, iter->second->id() });
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+  }
+
+  // Call update(*found.entry) while holding the lock of its shard, unless the entry was recycled.
+  // Returns the result of update, or false if the entry was recycled.
+  template<typename F>
+  bool update(Found const& found, F update)
+  {
+    Shard& shard = shard_of(found.address);
+    std::lock_guard<std::mutex> lock(shard.m_mutex);
+    return found.entry->id() == found.id && update(*found.entry);
+  }
+
+  // Merge the entries of all shards, ordered by id.
+  std::vector<Entry*> all()
+  {
+    std::vector<Entry*> result;
+    for (Shard& shard : m_shards)
+    {
+      std::lock_guard<std::mutex> lock(shard.m_mutex);
+      for (Entry& entry : shard.m_entries)
+        result.push_back(&entry);
+    }
+    std::sort(result.begin(), result.end(), [](Entry const* e1, Entry const* e2){ return e1->id() < e2->id(); });
+    return result;
+  }
+};
+
 // Usage:
 //
 // DECLARE_TRACKED(B);
@@ -38,6 +187,9 @@ namespace tracked {
 // One may use tracked::mute() and tracked::unmute() to
 // verbosely turn dc::tracked on and off.
 //
+// For long running programs, call tracked::limit_history(n)
+// to bound the memory that is used for destructed objects.
+//
 // To track an existing class Foo, derive it from Tracked:
 //
 // extern char const* name_Foo;
@@ -65,11 +217,13 @@ template<char const* const* NAME>
 struct Tracked {
   struct Entry {
    private:
+    std::ptrdiff_t m_id;
     Tracked const* p;
 
    public:
-    enum Status { fresh, pillaged, destructed, deleted } status;
-    Entry(Tracked const* t) : p(t), status(fresh) { }
+    enum Status { fresh, pillaged, destructed, deleted };
+    std::atomic<Status> status;
+    Entry(std::ptrdiff_t id, Tracked const* t) : m_id(id), p(t), status(fresh) { }
 
     void set_status(Status st) { status = st; }
 
@@ -78,10 +232,10 @@ struct Tracked {
     bool status_below(Status st) const { return status < st; }
     bool operator==(Tracked const* t) const { return p == t; }
     bool operator<(void const* vp) const { return p < vp; }
+    void const* address() const { return p; }
 
-    using Entries = std::vector<Entry>;
-    static Entries& entries();
-    std::ptrdiff_t id() const { return this - &entries().front(); }
+    static Registry<Entry>& registry();
+    std::ptrdiff_t id() const { return m_id; }
 
     friend std::ostream& operator<<(std::ostream& os, Entry const& e) { return os << *NAME << e.id(); }
   };
@@ -89,53 +243,57 @@ struct Tracked {
   Tracked()
   {
     make_entry();
-    Dout(dc::tracked, *this << "* [" << this << ']');
+    DoutIf(CWDS_CHANNEL_TRACKED, dc::tracked, *this << "* [" << this << ']');
   }
 
   Tracked(Tracked const& lvalue)
   {
     lvalue.assert_status_below(Entry::pillaged, "copy");
     make_entry();
-    Dout(dc::tracked, *this << "*(" << lvalue << ") [" << this << ']');
+    DoutIf(CWDS_CHANNEL_TRACKED, dc::tracked, *this << "*(" << lvalue << ") [" << this << ']');
   }
 
   Tracked(Tracked&& rvalue)
   {
     rvalue.assert_status_below(Entry::pillaged, "move");
     make_entry();
-    Dout(dc::tracked, rvalue << "=>" << *this << "* [" << this << ']');
-    rvalue.entry()->set_status(Entry::pillaged);
+    DoutIf(CWDS_CHANNEL_TRACKED, dc::tracked, rvalue << "=>" << *this << "* [" << this << ']');
+    rvalue.set_status(Entry::pillaged);
   }
 
   ~Tracked()
   {
     assert_status_below(Entry::destructed, "re-destruct");
-    Dout(dc::tracked, *this << "~ [" << this << ']');
-    entry()->set_status(Entry::destructed);
+    DoutIf(CWDS_CHANNEL_TRACKED, dc::tracked, *this << "~ [" << this << ']');
+    if (Entry* const e = entry(); e && !e->status_destructed())
+    {
+      e->set_status(Entry::destructed);
+      Entry::registry().retire(e);
+    }
   }
 
   void operator=(Tracked const& r)
   {
     assert_status_below(Entry::destructed, "assign to");
     r.assert_status_below(Entry::pillaged, "assign from");
-    Dout(dc::tracked, *this << '=' << r << " [" << this << ']');
-    entry()->set_status(Entry::fresh);
+    DoutIf(CWDS_CHANNEL_TRACKED, dc::tracked, *this << '=' << r << " [" << this << ']');
+    set_status(Entry::fresh);
   }
 
   void operator=(Tracked&& r)
   {
     assert_status_below(Entry::destructed, "move-assign to");
     r.assert_status_below(Entry::pillaged, "move");
-    entry()->set_status(Entry::fresh);
-    Dout(dc::tracked, r << "=>" << *this << " [" << this << ']');
-    r.entry()->set_status(Entry::pillaged);
+    set_status(Entry::fresh);
+    DoutIf(CWDS_CHANNEL_TRACKED, dc::tracked, r << "=>" << *this << " [" << this << ']');
+    r.set_status(Entry::pillaged);
   }
 
   void refresh()
   {
     assert_status_below(Entry::destructed, "refresh");
-    entry()->set_status(Entry::fresh);
-    Dout(dc::tracked, "Revived " << *this << " [" << this << ']');
+    set_status(Entry::fresh);
+    DoutIf(CWDS_CHANNEL_TRACKED, dc::tracked, "Revived " << *this << " [" << this << ']');
   }
 
   void* operator new(std::size_t const s)
@@ -177,6 +335,7 @@ struct Tracked {
 
   void make_entry() const;
   Entry* entry() const;
+  void set_status(typename Entry::Status status) const;
 
   static void atexit();
 
@@ -185,56 +344,64 @@ struct Tracked {
   void op_delete(void* const p, std::size_t const s);
   void op_array_delete(void* const p, std::size_t const s);
 
-  friend std::ostream& operator<<(std::ostream& os, Tracked const& t) { return os << *t.entry(); }
+  friend std::ostream& operator<<(std::ostream& os, Tracked const& t)
+  {
+    if (Entry const* e = t.entry())
+      return os << *e;
+    return os << *NAME << "?";       // Its entry was recycled.
+  }
 };
 
 //static
 template<char const* const* NAME>
-typename Tracked<NAME>::Entry::Entries& Tracked<NAME>::Entry::entries()
+Registry<typename Tracked<NAME>::Entry>& Tracked<NAME>::Entry::registry()
 {
-  static Entries* p = nullptr;
-  if (!p)
-  {
-    p = new Entries;
-    std::atexit(&atexit);
-  }
+  // Thread-safe initialization; never destructed so that it can still be used from atexit().
+  static Registry<Entry>* p = [](){ std::atexit(&atexit); return new Registry<Entry>; }();
   return *p;
 }
 
 template<char const* const* NAME>
 void Tracked<NAME>::make_entry() const
 {
-  if (Entry* const e = entry())
-    if (!e->status_destructed())
-      Dout(dc::tracked, "leaked: " << e << " [" << this << ']');
-  Entry::entries().emplace_back(this);
+  if (std::ptrdiff_t const leaked = Entry::registry().add(this, this); leaked != -1)
+    DoutIf(CWDS_CHANNEL_TRACKED, dc::tracked, "leaked: " << *NAME << leaked << " [" << this << ']');
 }
 
 template<char const* const* NAME>
 typename Tracked<NAME>::Entry* Tracked<NAME>::entry() const
 {
-  for (auto&& e : boost::adaptors::reverse(Entry::entries()))
-    if (e == this) return &e;
-  return nullptr;
+  return Entry::registry().find(this);
 }
 
+// Does nothing if the entry of this object was already recycled (see limit_history).
 template<char const* const* NAME>
-void Tracked<NAME>::assert_status_below(typename Entry::Status status, std::string const& s) const
+void Tracked<NAME>::set_status(typename Entry::Status status) const
+{
+  if (Entry* const e = entry())
+    e->set_status(status);
+}
+
+template<char const* const* NAME>
+void Tracked<NAME>::assert_status_below(typename Entry::Status status, [[maybe_unused]] std::string const& s) const
 {
   Entry* const e = entry();
   if (!e)
-    Dout(dc::tracked, "Trying to " << s << " non-existent object:");
+  {
+    DoutIf(CWDS_CHANNEL_TRACKED, dc::tracked, "Trying to " << s << " non-existent object:");
+    return;
+  }
   if (e->status_below(status))
     return;
-  Dout(dc::tracked, "Trying to " << s << (e->status_destructed() ? " destructed " : " pillaged ") << *e << ':');
+  DoutIf(CWDS_CHANNEL_TRACKED, dc::tracked, "Trying to " << s << (e->status_destructed() ? " destructed " : " pillaged ") << *e << ':');
 }
 
 template<char const* const* NAME>
-void* Tracked<NAME>::op_new(std::size_t, bool const array, void* const r)
+void* Tracked<NAME>::op_new(std::size_t, [[maybe_unused]] bool const array, void* const r)
 {
   if (!r)
     return 0;
-  Dout(dc::tracked, "new(" << *NAME << (array ? "[]" : "") << ") [" << this << "]");
+  DoutIf(CWDS_CHANNEL_TRACKED, dc::tracked, "new(" << *NAME << (array ? "[]" : "") << ") [" << this << "]");
   return r;
 }
 
@@ -248,13 +415,10 @@ _Pragma("GCC diagnostic push")
 _Pragma("GCC diagnostic ignored \"-Wuse-after-free\"")
 #endif
 
-  for (auto&& e : Entry::entries())
-    if (!(e < p) && e < static_cast<char*>(p) + s)
-    {
-      Dout(dc::tracked, "delete(" << e << ") [" << this << ']');
-      e.set_status(Entry::deleted);
-      return;
-    }
+  Registry<Entry>& registry = Entry::registry();
+  auto const found = registry.range(p, static_cast<char*>(p) + s);
+  if (!found.empty() && registry.update(found.front(), [](Entry& e){ e.set_status(Entry::deleted); return true; }))
+    DoutIf(CWDS_CHANNEL_TRACKED, dc::tracked, "delete(" << *NAME << found.front().id << ") [" << this << ']');
 
 #if defined(__GNUC__) && !defined(__clang__)
 _Pragma("GCC diagnostic push")
@@ -265,19 +429,19 @@ template<char const* const* NAME>
 void Tracked<NAME>::op_array_delete(void* const p, std::size_t const s)
 {
   ::operator delete[](p);
-  Dout(dc::tracked|continued_cf, "delete[");
+  DoutIf(CWDS_CHANNEL_TRACKED, dc::tracked|continued_cf, "delete[");
   bool first = true;
-  for (auto&& e : Entry::entries())
-    if (!e.status_deleted() && !(e < p) && e < static_cast<char*>(p) + s)
+  Registry<Entry>& registry = Entry::registry();
+  for (auto&& found : registry.range(p, static_cast<char*>(p) + s))
+    if (registry.update(found, [](Entry& e){ if (e.status_deleted()) return false; e.set_status(Entry::deleted); return true; }))
     {
       if (first)
         first = false;
       else
-        Dout(dc::continued, ", ");
-      Dout(dc::continued, e);
-      e.set_status(Entry::deleted);
+        DoutIf(CWDS_CHANNEL_TRACKED, dc::continued, ", ");
+      DoutIf(CWDS_CHANNEL_TRACKED, dc::continued, *NAME << found.id);
     }
-  Dout(dc::finish, "] [" << this << "]");
+  DoutIf(CWDS_CHANNEL_TRACKED, dc::finish, "] [" << this << "]");
 }
 
 //static
@@ -285,36 +449,46 @@ template<char const* const* NAME>
 void Tracked<NAME>::atexit()
 {
   bool first = true;
-  for (auto&& e : Entry::entries())
-    if (!e.status_destructed())
+  for (Entry* entry : Entry::registry().all())
+    if (Entry& e = *entry; !e.status_destructed())
     {
       if (first)
       {
-        Dout(dc::tracked|continued_cf, "leaked: ");
+        DoutIf(CWDS_CHANNEL_TRACKED, dc::tracked|continued_cf, "leaked: ");
         first = false;
       }
       else
-        Dout(dc::continued, ", ");
+        DoutIf(CWDS_CHANNEL_TRACKED, dc::continued, ", ");
 
-      Dout(dc::continued, e);
+      DoutIf(CWDS_CHANNEL_TRACKED, dc::continued, e);
     }
 
   if (!first)
   {
-    Dout(dc::finish, '.');
+    DoutIf(CWDS_CHANNEL_TRACKED, dc::finish, '.');
   }
 }
 
+// Enable bounded-memory mode: keep at most (about) max_dead_entries destructed
+// entries per tracked type and reuse the storage of older ones. Live objects
+// are always kept. The ids of new objects continue to increase, so an id is
+// never reused; diagnostics about an object whose entry was recycled print
+// the type name followed by a question mark. Pass zero to keep everything (the default).
+inline void limit_history(std::size_t max_dead_entries)
+{
+  s_max_dead_entries = max_dead_entries;
+}
+
 inline void mute()
 {
-  Dout(dc::tracked, "muted");
+  DoutIf(CWDS_CHANNEL_TRACKED, dc::tracked, "muted");
   Debug(dc::tracked.off());
 }
 
 inline void unmute()
 {
   Debug(dc::tracked.on());
-  Dout(dc::tracked, "unmuted");
+  DoutIf(CWDS_CHANNEL_TRACKED, dc::tracked, "unmuted");
 }
 
 } // namespace tracked;
@@ -10,6 +10,8 @@
 #include "utils/InstanceTracker.h"
 #include <boost/intrusive_ptr.hpp>
 #include <boost/core/explicit_operator_bool.hpp>
+#include <mutex>
+#include <set>
 
 // tracked::intrusive_ptr<T>
 //
@@ -37,6 +39,25 @@ DECLARE_TRACKED_BOOST_INTRUSIVE_PTR(Foo)
 //
 // to print out the tracker info of each intrusive_ptr instance.
 //
+// Sampled mode:
+//
+// Every tracked::intrusive_ptr is registered with InstanceTracker and its
+// constructors and assignment operators are not inlined, in order to record
+// the return address. When there are millions of pointers that is too slow;
+// in that case use instead
+//
+#if EXAMPLE_CODE
+#ifdef CWDEBUG
+DECLARE_SAMPLED_TRACKED_BOOST_INTRUSIVE_PTR(Foo, 1024)
+#endif
+#endif // EXAMPLE_CODE
+//
+// which only tracks one in every 1024 pointer instances (counted per thread)
+// and is otherwise inlined. Null pointers are never sampled. Because the sampled
+// constructors are inlined too, the recorded return address is the return address
+// of the function that created the pointer: it points into the caller of that function.
+// Use tracked::sampled_intrusive_ptr<Foo, 1024>::for_each_instance as above.
+//
 
 namespace tracked {
 
@@ -262,6 +283,237 @@ class intrusive_ptr : public utils::InstanceTracker<intrusive_ptr<T>>
   void* return_address;
 };
 
+// Like intrusive_ptr, but only one in every sample_period instances is tracked.
+template <class T, unsigned int sample_period>
+class sampled_intrusive_ptr
+{
+ private:
+  typedef sampled_intrusive_ptr this_type;
+
+  static inline std::mutex s_instances_mutex;
+  static inline std::set<sampled_intrusive_ptr const*> s_instances;     // The sampled instances.
+  static inline thread_local unsigned int t_counter;
+
+  [[gnu::noinline]] void start_tracking(void* ra)
+  {
+    m_sampled = true;
+    return_address = ra;
+    std::lock_guard<std::mutex> lock(s_instances_mutex);
+    s_instances.insert(this);
+  }
+
+  [[gnu::noinline]] void stop_tracking()
+  {
+    std::lock_guard<std::mutex> lock(s_instances_mutex);
+    s_instances.erase(this);
+  }
+
+  // Like the original, only non-null pointers are recorded.
+  void sample(void* ra)
+  {
+    if (px == 0 || ++t_counter < sample_period) [[likely]]
+      return;
+    t_counter = 0;
+    start_tracking(ra);
+  }
+
+  // Called after a new value was assigned.
+  void assigned(void* ra)
+  {
+    if (m_sampled) [[unlikely]]
+      return_address = ra;
+    else
+      sample(ra);
+  }
+
+  // Used for the temporaries of the assignment operators and reset, which must not be sampled.
+  struct no_sampling_t { };
+  static constexpr no_sampling_t no_sampling{};
+
+  sampled_intrusive_ptr(no_sampling_t, T* p, bool add_ref) : px(p), return_address(nullptr), m_sampled(false)
+  {
+    if (px != 0 && add_ref)
+      intrusive_ptr_add_ref(px);
+  }
+
+ public:
+  typedef T element_type;
+
+  sampled_intrusive_ptr() : px(0), return_address(nullptr), m_sampled(false) { }
+
+  sampled_intrusive_ptr(T* p, bool add_ref = true) : px(p), return_address(nullptr), m_sampled(false)
+  {
+    if (px != 0 && add_ref)
+      intrusive_ptr_add_ref(px);
+    sample(__builtin_return_address(0));
+  }
+
+  template <class U>
+  sampled_intrusive_ptr(sampled_intrusive_ptr<U, sample_period> const& rhs, typename boost::detail::sp_enable_if_convertible<U, T>::type = boost::detail::sp_empty())
+      : px(rhs.get()), return_address(nullptr), m_sampled(false)
+  {
+    if (px != 0)
+      intrusive_ptr_add_ref(px);
+    sample(__builtin_return_address(0));
+  }
+
+  sampled_intrusive_ptr(sampled_intrusive_ptr const& rhs) : px(rhs.px), return_address(nullptr), m_sampled(false)
+  {
+    if (px != 0)
+      intrusive_ptr_add_ref(px);
+    sample(__builtin_return_address(0));
+  }
+
+  sampled_intrusive_ptr(sampled_intrusive_ptr&& rhs) BOOST_SP_NOEXCEPT : px(rhs.px), return_address(nullptr), m_sampled(false)
+  {
+    rhs.px = 0;
+    sample(__builtin_return_address(0));
+  }
+
+  template <class U>
+  sampled_intrusive_ptr(sampled_intrusive_ptr<U, sample_period>&& rhs, typename boost::detail::sp_enable_if_convertible<U, T>::type = boost::detail::sp_empty())
+      : px(rhs.px), return_address(nullptr), m_sampled(false)
+  {
+    rhs.px = 0;
+    sample(__builtin_return_address(0));
+  }
+
+  ~sampled_intrusive_ptr()
+  {
+    if (px != 0) intrusive_ptr_release(px);
+    if (m_sampled) [[unlikely]]
+      stop_tracking();
+  }
+
+  // A sampled instance records the return address of the last assignment. Assigning
+  // a non-null pointer to an instance that isn't sampled counts like a construction,
+  // so that pointers that are default constructed and assigned later can be sampled.
+  template <class U>
+  sampled_intrusive_ptr& operator=(sampled_intrusive_ptr<U, sample_period> const& rhs)
+  {
+    this_type(no_sampling, rhs.get(), true).swap(*this);
+    assigned(__builtin_return_address(0));
+    return *this;
+  }
+
+  sampled_intrusive_ptr& operator=(sampled_intrusive_ptr&& rhs) BOOST_SP_NOEXCEPT
+  {
+    this_type(no_sampling, rhs.detach(), false).swap(*this);
+    assigned(__builtin_return_address(0));
+    return *this;
+  }
+
+  template <class U, unsigned int>
+  friend class sampled_intrusive_ptr;
+
+  template <class U>
+  sampled_intrusive_ptr& operator=(sampled_intrusive_ptr<U, sample_period>&& rhs) BOOST_SP_NOEXCEPT
+  {
+    this_type(no_sampling, rhs.detach(), false).swap(*this);
+    assigned(__builtin_return_address(0));
+    return *this;
+  }
+
+  sampled_intrusive_ptr& operator=(sampled_intrusive_ptr const& rhs)
+  {
+    this_type(no_sampling, rhs.px, true).swap(*this);
+    assigned(__builtin_return_address(0));
+    return *this;
+  }
+
+  sampled_intrusive_ptr& operator=(T* rhs)
+  {
+    this_type(no_sampling, rhs, true).swap(*this);
+    assigned(__builtin_return_address(0));
+    return *this;
+  }
+
+  void reset()
+  {
+    this_type(no_sampling, nullptr, false).swap(*this);
+  }
+
+  void reset(T* rhs)
+  {
+    this_type(no_sampling, rhs, true).swap(*this);
+    assigned(__builtin_return_address(0));
+  }
+
+  void reset(T* rhs, bool add_ref)
+  {
+    this_type(no_sampling, rhs, add_ref).swap(*this);
+    assigned(__builtin_return_address(0));
+  }
+
+  T* get() const BOOST_SP_NOEXCEPT
+  {
+    return px;
+  }
+
+  T* detach() BOOST_SP_NOEXCEPT
+  {
+    T* ret = px;
+    px     = 0;
+    return ret;
+  }
+
+  T& operator*() const BOOST_SP_NOEXCEPT_WITH_ASSERT
+  {
+    BOOST_ASSERT(px != 0);
+    return *px;
+  }
+
+  T* operator->() const BOOST_SP_NOEXCEPT_WITH_ASSERT
+  {
+    BOOST_ASSERT(px != 0);
+    return px;
+  }
+
+  bool operator! () const BOOST_SP_NOEXCEPT
+  {
+    return px == nullptr;
+  }
+
+  BOOST_EXPLICIT_OPERATOR_BOOL()
+
+  // Only swaps the pointers; each instance stays sampled or not.
+  void swap(sampled_intrusive_ptr& rhs) BOOST_SP_NOEXCEPT
+  {
+    T* tmp = px;
+    px     = rhs.px;
+    rhs.px = tmp;
+  }
+
+  // Call func(ptr) for each sampled instance, while holding the lock on the collection of instances.
+  template<typename F>
+  static void for_each_instance(F const& func)
+  {
+    std::lock_guard<std::mutex> lock(s_instances_mutex);
+    for (sampled_intrusive_ptr const* ptr : s_instances)
+      func(ptr);
+  }
+
+  void print_tracker_info_on(std::ostream& os) const
+  {
+    if (return_address)
+    {
+#ifdef CWDEBUG_LOCATION
+      os << libcwd::Location((char*)return_address + libcwd::builtin_return_address_offset);
+#else
+      os << return_address;
+#endif
+    }
+  }
+
+ private:
+  template<class U>
+  friend class ::boost::intrusive_ptr;
+
+  T* px;
+  void* return_address;                 // Only set for sampled instances.
+  bool m_sampled;
+};
+
 } // namespace tracked
 
 // Definition of convenience macro.
@@ -354,3 +606,26 @@ class intrusive_ptr : public utils::InstanceTracker<intrusive_ptr<T>>
     } \
   }; \
   } // namespace boost
+
+// Definition of the convenience macro for sampled mode.
+#define DECLARE_SAMPLED_TRACKED_BOOST_INTRUSIVE_PTR(T, sample_period) \
+  namespace boost { \
+  template<> \
+  class intrusive_ptr<T> : public tracked::sampled_intrusive_ptr<T, sample_period> \
+  { \
+   public: \
+    using tracked::sampled_intrusive_ptr<T, sample_period>::sampled_intrusive_ptr; \
+    using tracked::sampled_intrusive_ptr<T, sample_period>::operator=; \
+    \
+    intrusive_ptr() = default; \
+    intrusive_ptr(intrusive_ptr const&) = default; \
+    intrusive_ptr(intrusive_ptr&&) = default; \
+    intrusive_ptr& operator=(intrusive_ptr const&) = default; \
+    intrusive_ptr& operator=(intrusive_ptr&&) = default; \
+    \
+    void swap(intrusive_ptr& rhs) BOOST_SP_NOEXCEPT \
+    { \
+      tracked::sampled_intrusive_ptr<T, sample_period>::swap(rhs); \
+    } \
+  }; \
+  } // namespace boost